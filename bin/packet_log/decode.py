@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""
+Decodes a repeater's binary packet log into text lines.
+
+Input is either the raw /packet_log file, or the hex output of the 'log' CLI command
+(one record per line, other lines are ignored).
+
+  usage:  decode.py <file>      (or '-' for stdin)
+"""
+import sys
+import struct
+import datetime
+
+MAGIC = b'MCPL'
+HEADER_LEN = 8
+RECORD = struct.Struct('<IBBBBbbHBBBB4s')   # see PacketLogRecord, in examples/simple_repeater/PacketLog.h
+
+KINDS = {1: 'RX', 2: 'TX', 3: 'TX FAIL!'}
+PAYLOAD_TYPES = ['REQ', 'RESPONSE', 'TXT_MSG', 'ACK', 'ADVERT', 'GRP_TXT', 'GRP_DATA', 'ANON_REQ',
+                 'PATH', 'TRACE', 'MULTIPART', 'CONTROL', '0x0C', '0x0D', '0x0E', 'RAW_CUSTOM']
+HASHED_TYPES = (0x00, 0x01, 0x02, 0x08)   # REQ, RESPONSE, TXT_MSG, PATH
+
+
+def read_input(path):
+    data = sys.stdin.buffer.read() if path == '-' else open(path, 'rb').read()
+    if data.startswith(MAGIC):
+        return [data]   # raw file
+
+    # hex dump, possibly more than one file (ie. rotated log, then current)
+    files = []
+    for line in data.decode('ascii', 'ignore').splitlines():
+        line = line.strip()
+        try:
+            b = bytes.fromhex(line)
+        except ValueError:
+            continue   # not part of dump
+        if b.startswith(MAGIC):
+            files.append(bytearray(b))
+        elif files and len(b) == RECORD.size:
+            files[-1] += b
+    return files
+
+
+def decode(data, out):
+    if not data.startswith(MAGIC):
+        raise ValueError('not a packet log (bad magic)')
+    version, rec_size = data[4], data[5]
+    if version != 1 or rec_size != RECORD.size:
+        raise ValueError('unsupported version %d, record size %d' % (version, rec_size))
+
+    for off in range(HEADER_LEN, len(data) - rec_size + 1, rec_size):
+        (ts, kind, header, length, payload_len, snr, rssi, score,
+         path_len, dest_hash, src_hash, _, pkt_hash) = RECORD.unpack_from(data, off)
+
+        ptype = (header >> 2) & 0x0F
+        route = 'D' if (header & 0x03) in (0x02, 0x03) else 'F'
+        when = datetime.datetime.fromtimestamp(ts, datetime.timezone.utc).strftime('%H:%M:%S - %d/%m/%Y U')
+
+        line = '%s: %s, len=%d (type=%d %s, route=%s, payload_len=%d, path_len=%d)' % (
+            when, KINDS.get(kind, '?'), length, ptype, PAYLOAD_TYPES[ptype], route, payload_len, path_len)
+        if kind == 1:
+            line += ' SNR=%.2f RSSI=%d score=%d' % (snr / 4.0, rssi, score)
+        if ptype in HASHED_TYPES:
+            line += ' [%02X -> %02X]' % (src_hash, dest_hash)
+        line += ' #' + pkt_hash.hex().upper()
+        out.write(line + '\n')
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.stderr.write(__doc__)
+        sys.exit(1)
+    for data in read_input(sys.argv[1]):
+        decode(bytes(data), sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+"""
+Collects the periodic stats push frames from repeaters, and writes them out as Prometheus text, or CSV.
+
+Input is a serial port (needs pyserial), a file, or '-' for stdin. Both the 'STATS: <hex>' lines from the
+USB serial console ('set stats.push.dest serial'), and the binary frames from an RS232 bridge
+('set stats.push.dest bridge') are recognised, and can be mixed in the one stream.
+
+  usage:  collect.py [--baud N] [--prom <file>] [--csv <file>] <input>
+
+The --prom file is rewritten after each frame (eg. for the node_exporter textfile collector).
+With no --prom or --csv, CSV is written to stdout.
+"""
+import os
+import sys
+import struct
+import time
+import argparse
+
+STATS_MAGIC = b'\xC0\x5A'   # BRIDGE_STATS_MAGIC, see src/helpers/bridges/BridgeBase.h
+LINE_PREFIX = b'STATS: '
+MAX_FRAME = 64
+
+HEADER = struct.Struct('<BBH4s')   # see StatsPush.h, in examples/simple_repeater/
+CORE = struct.Struct('<BBHIHB')
+RADIO = struct.Struct('<BBhbbII')
+PACKETS = struct.Struct('<BBIIIIIII')
+DELTA = struct.Struct('<BB10HIIhbbHBH')
+
+FLAG_FULL = 0x01
+COUNTERS = ['recv', 'sent', 'flood_tx', 'direct_tx', 'flood_rx', 'direct_rx', 'recv_errors',
+            'flood_dups', 'direct_dups', 'tx_air_ms', 'rx_air_ms']
+GAUGES = ['uptime_secs', 'battery_mv', 'errors', 'queue_len', 'noise_floor', 'last_rssi', 'last_snr']
+
+
+def fletcher16(data):
+    sum1 = sum2 = 0
+    for b in data:
+        sum1 = (sum1 + b) % 255
+        sum2 = (sum2 + sum1) % 255
+    return (sum2 << 8) | sum1
+
+
+class Node:
+    def __init__(self):
+        self.totals = dict.fromkeys(COUNTERS, 0)
+        self.gauges = dict.fromkeys(GAUGES, 0)
+        self.last_seq = None
+        self.synced = False
+        self.frames = 0
+        self.missed = 0
+
+    def update(self, seq, flags, body):
+        if self.last_seq is not None and seq != (self.last_seq + 1) & 0xFFFF:
+            self.missed += (seq - self.last_seq - 1) & 0xFFFF
+        self.last_seq = seq
+        self.frames += 1
+        t, g = self.totals, self.gauges
+
+        if flags & FLAG_FULL:
+            (_, _, g['battery_mv'], g['uptime_secs'], g['errors'], g['queue_len']) = CORE.unpack_from(body, 0)
+            (_, _, g['noise_floor'], g['last_rssi'], snr, tx_air, rx_air) = RADIO.unpack_from(body, CORE.size)
+            (_, _, t['recv'], t['sent'], t['flood_tx'], t['direct_tx'], t['flood_rx'], t['direct_rx'],
+             t['recv_errors']) = PACKETS.unpack_from(body, CORE.size + RADIO.size)
+            g['last_snr'] = snr / 4.0
+            # only whole seconds in full frames, keep the finer count while it is still in the same second
+            if t['tx_air_ms'] // 1000 != tx_air:
+                t['tx_air_ms'] = tx_air * 1000
+            if t['rx_air_ms'] // 1000 != rx_air:
+                t['rx_air_ms'] = rx_air * 1000
+            self.synced = True
+            return 'full'
+
+        v = DELTA.unpack_from(body, 0)
+        interval, d = v[2], v[3:12]
+        for name, n in zip(COUNTERS[:9], d):
+            t[name] += n
+        t['tx_air_ms'] += v[12]
+        t['rx_air_ms'] += v[13]
+        (g['noise_floor'], g['last_rssi'], snr, g['battery_mv'], g['queue_len'], g['errors']) = v[14:20]
+        g['last_snr'] = snr / 4.0
+        g['uptime_secs'] += interval
+        return 'delta' if self.synced else 'delta (unsynced)'
+
+
+def frames(stream, is_serial):
+    """ yields raw push frames, from either hex lines or binary bridge framing """
+    buf = bytearray()
+    while True:
+        chunk = stream.read(256) if is_serial else stream.read1(256)
+        if not chunk:
+            if is_serial:
+                continue   # just a read timeout
+            return
+        buf += chunk
+        while True:
+            i = buf.find(LINE_PREFIX)
+            j = buf.find(STATS_MAGIC)
+            if i >= 0 and (j < 0 or i < j):
+                end = buf.find(b'\n', i)
+                if end < 0:
+                    break
+                try:
+                    yield bytes.fromhex(buf[i + len(LINE_PREFIX):end].decode('ascii').strip())
+                except ValueError:
+                    pass   # garbled line
+                del buf[:end + 1]
+            elif j >= 0:
+                if len(buf) < j + 4:
+                    break
+                n = (buf[j + 2] << 8) | buf[j + 3]
+                if n > MAX_FRAME:
+                    del buf[:j + 1]   # not a real frame, resync
+                    continue
+                if len(buf) < j + 6 + n:
+                    break
+                frame = bytes(buf[j + 4:j + 4 + n])
+                checksum = (buf[j + 4 + n] << 8) | buf[j + 5 + n]
+                if fletcher16(frame) == checksum:
+                    yield frame
+                    del buf[:j + 6 + n]
+                else:
+                    del buf[:j + 1]
+            else:
+                del buf[:max(0, len(buf) - len(LINE_PREFIX))]   # keep a possible partial prefix
+                break
+
+
+def write_prom(path, nodes):
+    lines = []
+    for name in COUNTERS:
+        lines.append('# TYPE meshcore_%s_total counter' % name)
+        for node_id, n in nodes.items():
+            lines.append('meshcore_%s_total{node="%s"} %d' % (name, node_id, n.totals[name]))
+    for name in GAUGES:
+        lines.append('# TYPE meshcore_%s gauge' % name)
+        for node_id, n in nodes.items():
+            lines.append('meshcore_%s{node="%s"} %s' % (name, node_id, n.gauges[name]))
+    lines.append('# TYPE meshcore_push_frames_missed_total counter')
+    for node_id, n in nodes.items():
+        lines.append('meshcore_push_frames_missed_total{node="%s"} %d' % (node_id, n.missed))
+
+    tmp = path + '.tmp'
+    with open(tmp, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+    os.replace(tmp, path)   # atomic, so scraper never sees partial file
+
+
+def open_input(path, baud):
+    """ returns (stream, is_serial) """
+    if path == '-':
+        return sys.stdin.buffer, False
+    if path.startswith('/dev/') or path.upper().startswith('COM'):
+        try:
+            import serial
+            return serial.Serial(path, baud, timeout=1), True
+        except ImportError:
+            sys.stderr.write('pyserial not installed, reading %s as a plain file\n' % path)
+    return open(path, 'rb'), False
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Collects repeater stats push frames.')
+    ap.add_argument('input', help='serial port, file, or - for stdin')
+    ap.add_argument('--baud', type=int, default=115200)
+    ap.add_argument('--prom', help='Prometheus text file to (re)write')
+    ap.add_argument('--csv', help='CSV file to append to')
+    args = ap.parse_args()
+
+    if args.csv:
+        csv_out = open(args.csv, 'a')
+        new_file = csv_out.tell() == 0
+    else:
+        csv_out = None if args.prom else sys.stdout
+        new_file = True
+    if csv_out and new_file:
+        csv_out.write(','.join(['time', 'node', 'seq', 'kind'] + COUNTERS + GAUGES) + '\n')
+
+    nodes = {}
+    stream, is_serial = open_input(args.input, args.baud)
+    for frame in frames(stream, is_serial):
+        if len(frame) < HEADER.size:
+            continue
+        version, flags, seq, prefix = HEADER.unpack_from(frame, 0)
+        body = frame[HEADER.size:]
+        expected = CORE.size + RADIO.size + PACKETS.size if flags & FLAG_FULL else DELTA.size
+        if version != 1 or len(body) < expected:
+            sys.stderr.write('skipping frame: version %d, len %d\n' % (version, len(frame)))
+            continue
+
+        node_id = prefix.hex().upper()
+        node = nodes.setdefault(node_id, Node())
+        kind = node.update(seq, flags, body)
+
+        if csv_out:
+            row = [time.strftime('%Y-%m-%dT%H:%M:%S'), node_id, str(seq), kind]
+            row += [str(node.totals[c]) for c in COUNTERS] + [str(node.gauges[g]) for g in GAUGES]
+            csv_out.write(','.join(row) + '\n')
+            csv_out.flush()
+        if args.prom:
+            write_prom(args.prom, nodes)
+
+
+if __name__ == '__main__':
+    main()
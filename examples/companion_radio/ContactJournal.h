@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <MeshCore.h>
+
+#ifndef CONTACT_JOURNAL_SIZE
+  #define CONTACT_JOURNAL_SIZE  32
+#endif
+
+#define JOURNAL_OP_UPDATE   0   // contact added or modified
+#define JOURNAL_OP_REMOVE   1
+
+struct JournalEntry {
+  uint32_t seq;
+  uint8_t pub_key[PUB_KEY_SIZE];
+  uint8_t op;   // one of JOURNAL_OP_*
+};
+
+/**
+ * Bounded ring of recent contact changes, so that an app can sync just the changes since its last known 'seq'.
+ * The 'epoch' is randomised each boot, as the journal is only kept in RAM.
+ */
+class ContactJournal {
+  JournalEntry entries[CONTACT_JOURNAL_SIZE];
+  uint32_t _epoch, _seq;   // _seq is that of most recent entry (zero = none)
+
+public:
+  ContactJournal() : _epoch(0), _seq(0) { memset(entries, 0, sizeof(entries)); }
+
+  void reset(uint32_t epoch) { _epoch = epoch; _seq = 0; }
+  uint32_t getEpoch() const { return _epoch; }
+  uint32_t getSeq() const { return _seq; }
+
+  void record(const uint8_t* pub_key, uint8_t op) {
+    _seq++;
+    auto e = &entries[_seq % CONTACT_JOURNAL_SIZE];
+    e->seq = _seq;
+    memcpy(e->pub_key, pub_key, PUB_KEY_SIZE);
+    e->op = op;
+  }
+
+  // true if ALL changes after 'since' are still in the journal
+  bool canReplayFrom(uint32_t epoch, uint32_t since) const {
+    return epoch == _epoch && since <= _seq && _seq - since <= CONTACT_JOURNAL_SIZE;
+  }
+
+  /**
+   * \brief  advances 'cursor' to next entry, skipping those superseded by a later change to the same contact.
+   * \returns  NULL when no more entries up to 'end_seq', or if the journal has rolled over past 'cursor' (check isLost()).
+  */
+  const JournalEntry* next(uint32_t& cursor, uint32_t end_seq) const {
+    while (cursor < end_seq) {
+      cursor++;
+      auto e = &entries[cursor % CONTACT_JOURNAL_SIZE];
+      if (e->seq != cursor) return NULL;   // rolled over!
+
+      bool superseded = false;
+      for (uint32_t s = cursor + 1; s <= _seq && !superseded; s++) {
+        superseded = memcmp(entries[s % CONTACT_JOURNAL_SIZE].pub_key, e->pub_key, PUB_KEY_SIZE) == 0;
+      }
+      if (!superseded) return e;
+    }
+    return NULL;
+  }
+
+  bool isLost(uint32_t cursor) const {
+    return cursor > 0 && cursor <= _seq && entries[cursor % CONTACT_JOURNAL_SIZE].seq != cursor;
+  }
+};
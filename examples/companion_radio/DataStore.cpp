@@ -1,12 +1,6 @@
 #include <Arduino.h>
 #include "DataStore.h"
 
-#if defined(EXTRAFS) || defined(QSPIFLASH)
-  #define MAX_BLOBRECS 100
-#else
-  #define MAX_BLOBRECS 20
-#endif
-
 DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : _fs(&fs), _fsExtra(nullptr), _clock(&clock),
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
     identity_store(fs, "")
@@ -16,6 +10,12 @@ DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : _fs(&fs), _fsExtra
     identity_store(fs, "/identity")
 #endif
 {
+  num_pending_blobs = 0;
+  blob_bytes_written = 0;
+  num_snapshot_contacts = num_log_entries = 0;
+  contacts_log_damaged = false;
+  compact_idx = -1;
+  num_blob_recs = 0;
 }
 
 #if defined(EXTRAFS) || defined(QSPIFLASH)
@@ -28,6 +28,12 @@ DataStore::DataStore(FILESYSTEM& fs, FILESYSTEM& fsExtra, mesh::RTCClock& clock)
     identity_store(fs, "/identity")
 #endif
 {
+  num_pending_blobs = 0;
+  blob_bytes_written = 0;
+  num_snapshot_contacts = num_log_entries = 0;
+  contacts_log_damaged = false;
+  compact_idx = -1;
+  num_blob_recs = 0;
 }
 #endif
 
@@ -42,6 +48,15 @@ static File openWrite(FILESYSTEM* fs, const char* filename) {
 #endif
 }
 
+// for writing at arbitrary offsets, WITHOUT truncating
+static File openUpdate(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(filename, FILE_O_WRITE);
+#else
+  return fs->open(filename, "r+");
+#endif
+}
+
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
   static uint32_t _ContactsChannelsTotalBlocks = 0;
 #endif
@@ -57,9 +72,13 @@ void DataStore::begin() {
   #if defined(EXTRAFS) || defined(QSPIFLASH)
   migrateToSecondaryFS();
   #endif
+  extendAdvBlobFile();
+  loadBlobIndex();
 #else
-  // init 'blob store' support
-  _fs->mkdir("/bl");
+  checkAdvBlobFile();
+  extendAdvBlobFile();
+  loadBlobIndex();
+  migrateBlobDir();   // NOTE: every boot, so it resumes if interrupted (eg. by power loss)
 #endif
 }
 
@@ -164,6 +183,12 @@ bool DataStore::removeFile(FILESYSTEM* fs, const char* filename) {
 }
 
 bool DataStore::formatFileSystem() {
+  // blob file is about to be erased
+  memset(blob_index, 0, sizeof(blob_index));
+  num_blob_recs = 0;
+  num_pending_blobs = 0;
+  compact_idx = -1;   // as is any part written snapshot
+
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
   if (_fsExtra == nullptr) {
     return _fs->format();
@@ -268,64 +293,235 @@ void DataStore::savePrefs(const NodePrefs& _prefs, double node_lat, double node_
   }
 }
 
+#define CONTACT_REC_SIZE   152
+#define CONTACT_LOG_ENTRY_SIZE   (1 + CONTACT_REC_SIZE + 4)   // op, record, crc32
+
+#define CONTACT_LOG_OP_UPDATE   1
+#define CONTACT_LOG_OP_REMOVE   2
+
+static File openAppend(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return fs->open(filename, "a");
+#else
+  return fs->open(filename, "a", true);
+#endif
+}
+
+// NOTE: same layout as records in /contacts3
+static void packContact(const ContactInfo& c, uint8_t dest[]) {
+  int i = 0;
+  memcpy(&dest[i], c.id.pub_key, 32); i += 32;
+  memcpy(&dest[i], c.name, 32); i += 32;
+  dest[i++] = c.type;
+  dest[i++] = c.flags;
+  dest[i++] = 0;  // unused
+  memcpy(&dest[i], &c.sync_since, 4); i += 4;
+  dest[i++] = c.out_path_len;
+  memcpy(&dest[i], &c.last_advert_timestamp, 4); i += 4;
+  memcpy(&dest[i], c.out_path, 64); i += 64;
+  memcpy(&dest[i], &c.lastmod, 4); i += 4;
+  memcpy(&dest[i], &c.gps_lat, 4); i += 4;
+  memcpy(&dest[i], &c.gps_lon, 4); i += 4;
+}
+
+static void unpackContact(const uint8_t src[], ContactInfo& c) {
+  int i = 0;
+  c.id = mesh::Identity(&src[i]); i += 32;
+  memcpy(c.name, &src[i], 32); i += 32;
+  c.type = src[i++];
+  c.flags = src[i++];
+  i++;  // unused
+  memcpy(&c.sync_since, &src[i], 4); i += 4;   // was 'reserved'
+  c.out_path_len = src[i++];
+  memcpy(&c.last_advert_timestamp, &src[i], 4); i += 4;
+  memcpy(c.out_path, &src[i], 64); i += 64;
+  memcpy(&c.lastmod, &src[i], 4); i += 4;
+  memcpy(&c.gps_lat, &src[i], 4); i += 4;
+  memcpy(&c.gps_lon, &src[i], 4); i += 4;
+}
+
+/*
+  Contacts are stored as a snapshot, /contacts3, plus a log of changes since, /contacts3.log.
+  Compaction writes a new snapshot to /contacts3.tmp, then removes the log, then replaces /contacts3.
+  So, if /contacts3.tmp exists at startup:  with a log it is incomplete, without a log it is the latest.
+  Compaction can be done in steps (a few records per loop()), so long as contacts don't change part way.
+*/
+void DataStore::recoverContactsSnapshot() {
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  if (!fs->exists("/contacts3.tmp")) return;
+
+  if (fs->exists("/contacts3.log")) {
+    fs->remove("/contacts3.tmp");   // compaction was interrupted
+  } else {
+    fs->remove("/contacts3");
+    fs->rename("/contacts3.tmp", "/contacts3");
+  }
+}
+
 void DataStore::loadContacts(DataStoreHost* host) {
-File file = openRead(_getContactsChannelsFS(), "/contacts3");
-    if (file) {
-      bool full = false;
-      while (!full) {
-        ContactInfo c;
-        uint8_t pub_key[32];
-        uint8_t unused;
-
-        bool success = (file.read(pub_key, 32) == 32);
-        success = success && (file.read((uint8_t *)&c.name, 32) == 32);
-        success = success && (file.read(&c.type, 1) == 1);
-        success = success && (file.read(&c.flags, 1) == 1);
-        success = success && (file.read(&unused, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.sync_since, 4) == 4); // was 'reserved'
-        success = success && (file.read((uint8_t *)&c.out_path_len, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-        success = success && (file.read(c.out_path, 64) == 64);
-        success = success && (file.read((uint8_t *)&c.lastmod, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lat, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lon, 4) == 4);
+  abortContactsCompaction();
+  recoverContactsSnapshot();
+  num_snapshot_contacts = num_log_entries = 0;
+  contacts_log_damaged = false;
 
-        if (!success) break; // EOF
+  uint8_t rec[CONTACT_LOG_ENTRY_SIZE];
+  File file = openRead(_getContactsChannelsFS(), "/contacts3");
+  if (file) {
+    bool full = false;
+    while (!full) {
+      if (file.read(rec, CONTACT_REC_SIZE) != CONTACT_REC_SIZE) break; // EOF
+
+      ContactInfo c;
+      unpackContact(rec, c);
+      if (!host->onContactLoaded(c)) full = true;
+      num_snapshot_contacts++;
+    }
+    file.close();
+  }
 
-        c.id = mesh::Identity(pub_key);
-        if (!host->onContactLoaded(c)) full = true;
+  // now replay the changes since the snapshot
+  file = openRead(_getContactsChannelsFS(), "/contacts3.log");
+  if (file) {
+    int n;
+    while ((n = file.read(rec, CONTACT_LOG_ENTRY_SIZE)) == CONTACT_LOG_ENTRY_SIZE) {
+      uint32_t crc;
+      memcpy(&crc, &rec[1 + CONTACT_REC_SIZE], 4);
+      if (crc != mesh::Utils::crc32(rec, 1 + CONTACT_REC_SIZE)) break;   // torn/corrupt entry
+
+      ContactInfo c;
+      unpackContact(&rec[1], c);
+      if (rec[0] == CONTACT_LOG_OP_REMOVE) {
+        host->onContactLogRemove(c.id.pub_key);
+      } else {
+        host->onContactLogUpdate(c);
       }
-      file.close();
+      num_log_entries++;
+    }
+    file.close();
+
+    if (n != 0) {   // stopped short of EOF, eg. power loss mid-append
+      MESH_DEBUG_PRINTLN("DataStore::loadContacts() - damaged log after %d entries", num_log_entries);
+      contacts_log_damaged = true;   // needs compaction, before further appends
     }
+  }
 }
 
 void DataStore::saveContacts(DataStoreHost* host) {
-  File file = openWrite(_getContactsChannelsFS(), "/contacts3");
-  if (file) {
-    uint32_t idx = 0;
-    ContactInfo c;
-    uint8_t unused = 0;
-
-    while (host->getContactForSave(idx, c)) {
-      bool success = (file.write(c.id.pub_key, 32) == 32);
-      success = success && (file.write((uint8_t *)&c.name, 32) == 32);
-      success = success && (file.write(&c.type, 1) == 1);
-      success = success && (file.write(&c.flags, 1) == 1);
-      success = success && (file.write(&unused, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.sync_since, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.out_path_len, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-      success = success && (file.write(c.out_path, 64) == 64);
-      success = success && (file.write((uint8_t *)&c.lastmod, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lat, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lon, 4) == 4);
+  if (startContactsCompaction()) {
+    stepContactsCompaction(host, 0x7FFFFFFF);   // all at once
+  }
+}
 
-      if (!success) break; // write failed
+bool DataStore::startContactsCompaction() {
+  abortContactsCompaction();
 
-      idx++;  // advance to next contact
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  if (!fs->exists("/contacts3.log")) {   // needed for recovery, see recoverContactsSnapshot()
+    File log = openWrite(fs, "/contacts3.log");
+    if (!log) return false;
+    log.close();
+  }
+  File file = openWrite(fs, "/contacts3.tmp");
+  if (!file) return false;
+  file.close();
+
+  compact_idx = 0;
+  return true;
+}
+
+bool DataStore::stepContactsCompaction(DataStoreHost* host, int max_records) {
+  if (compact_idx < 0) return false;   // not started
+
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  File file = openAppend(fs, "/contacts3.tmp");
+  if (!file) {
+    abortContactsCompaction();
+    return false;
+  }
+  ContactInfo c;
+  uint8_t rec[CONTACT_REC_SIZE];
+  bool success = true;
+  bool finished = false;
+  for (int n = 0; n < max_records; n++) {
+    if (!host->getContactForSave(compact_idx, c)) {
+      finished = true;
+      break;
     }
+    packContact(c, rec);
+    success = file.write(rec, CONTACT_REC_SIZE) == CONTACT_REC_SIZE;
+    if (!success) break; // write failed
+
+    compact_idx++;  // advance to next contact
+  }
+  file.close();
+
+  if (!success) {
+    abortContactsCompaction();   // keep existing snapshot + log
+    return false;
+  }
+  if (!finished) return false;   // more to do
+
+  fs->remove("/contacts3.log");
+  fs->remove("/contacts3");
+  fs->rename("/contacts3.tmp", "/contacts3");
+
+  num_snapshot_contacts = compact_idx;
+  num_log_entries = 0;
+  contacts_log_damaged = false;
+  compact_idx = -1;
+  return true;
+}
+
+void DataStore::abortContactsCompaction() {
+  if (compact_idx >= 0) {
+    _getContactsChannelsFS()->remove("/contacts3.tmp");
+    compact_idx = -1;
+  }
+}
+
+bool DataStore::appendContactLog(uint8_t op, const ContactInfo& contact) {
+  if (contacts_log_damaged) return false;   // caller should compact instead
+
+  uint8_t entry[CONTACT_LOG_ENTRY_SIZE];
+  entry[0] = op;
+  packContact(contact, &entry[1]);
+  uint32_t crc = mesh::Utils::crc32(entry, 1 + CONTACT_REC_SIZE);
+  memcpy(&entry[1 + CONTACT_REC_SIZE], &crc, 4);
+
+  File file = openAppend(_getContactsChannelsFS(), "/contacts3.log");
+  if (file) {
+    bool success = file.write(entry, CONTACT_LOG_ENTRY_SIZE) == CONTACT_LOG_ENTRY_SIZE;
     file.close();
+    if (success) {
+      num_log_entries++;
+    } else {
+      contacts_log_damaged = true;   // may have partially written
+    }
+    return success;
   }
+  return false;
+}
+
+bool DataStore::appendContact(const ContactInfo& contact) {
+  return appendContactLog(CONTACT_LOG_OP_UPDATE, contact);
+}
+
+bool DataStore::appendContactRemoval(const uint8_t* pub_key) {
+  ContactInfo c;
+  memset(&c, 0, sizeof(c));
+  c.id = mesh::Identity(pub_key);
+  return appendContactLog(CONTACT_LOG_OP_REMOVE, c);
+}
+
+bool DataStore::needsContactsCompaction(uint32_t num_live) const {
+  if (contacts_log_damaged) return true;
+  if (num_log_entries < CONTACTS_LOG_MIN_ENTRIES) return false;
+
+  uint32_t total = num_snapshot_contacts + num_log_entries;
+  uint32_t garbage = total > num_live ? total - num_live : 0;
+  return garbage * 100 > total * CONTACTS_LOG_GARBAGE_PCT;
 }
 
 void DataStore::loadChannels(DataStoreHost* host) {
@@ -373,10 +569,6 @@ void DataStore::saveChannels(DataStoreHost* host) {
   }
 }
 
-#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
-
-#define MAX_ADVERT_PKT_LEN   (2 + 32 + PUB_KEY_SIZE + 4 + SIGNATURE_SIZE + MAX_ADVERT_DATA_SIZE)
-
 struct BlobRec {
   uint32_t timestamp;
   uint8_t  key[7];
@@ -395,9 +587,56 @@ void DataStore::checkAdvBlobFile() {
       }
       file.close();
     }
+    memset(blob_index, 0, sizeof(blob_index));
+    num_blob_recs = MAX_BLOBRECS;
   }
 }
 
+// MAX_BLOBRECS may have been increased (eg. to match MAX_CONTACTS), so pad the file out with empty slots
+void DataStore::extendAdvBlobFile() {
+  File file = openRead(_getContactsChannelsFS(), "/adv_blobs");
+  if (!file) return;
+  uint32_t num_recs = file.size() / sizeof(BlobRec);
+  file.close();
+  if (num_recs >= MAX_BLOBRECS) return;
+
+  file = openUpdate(_getContactsChannelsFS(), "/adv_blobs");
+  if (file) {
+    BlobRec zeroes;
+    memset(&zeroes, 0, sizeof(zeroes));
+    file.seek(num_recs * sizeof(BlobRec));   // overwrite any partial record
+    while (num_recs < MAX_BLOBRECS && file.write((uint8_t *) &zeroes, sizeof(zeroes)) == sizeof(zeroes)) {
+      num_recs++;
+    }
+    file.close();
+  }
+}
+
+void DataStore::loadBlobIndex() {
+  memset(blob_index, 0, sizeof(blob_index));
+  num_blob_recs = 0;
+
+  File file = openRead(_getContactsChannelsFS(), "/adv_blobs");
+  if (file) {
+    BlobIndexEntry hdr;   // NOTE: same layout as start of BlobRec
+    while (num_blob_recs < MAX_BLOBRECS) {
+      file.seek(num_blob_recs * sizeof(BlobRec));
+      if (file.read((uint8_t *) &hdr, sizeof(hdr.timestamp) + sizeof(hdr.key)) != sizeof(hdr.timestamp) + sizeof(hdr.key)) break;
+
+      blob_index[num_blob_recs++] = hdr;
+    }
+    file.close();
+  }
+}
+
+int DataStore::findBlobSlot(const uint8_t key[]) const {
+  for (int i = 0; i < num_blob_recs; i++) {
+    if (memcmp(key, blob_index[i].key, sizeof(blob_index[i].key)) == 0) return i;  // only match by 7 byte prefix
+  }
+  return -1;  // not found
+}
+
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
 void DataStore::migrateToSecondaryFS() {
   // migrate old adv_blobs, contacts3 and channels2 files to secondary FS if they don't already exist
   if (!_fsExtra->exists("/adv_blobs")) {
@@ -505,108 +744,185 @@ void DataStore::migrateToSecondaryFS() {
     _fsExtra->remove("/new_prefs");
   }
 }
+#endif
+
+uint8_t DataStore::readBlob(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
+  int slot = findBlobSlot(key);
+  if (slot < 0) return 0;  // not found
 
-uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
   File file = openRead(_getContactsChannelsFS(), "/adv_blobs");
   uint8_t len = 0;  // 0 = not found
   if (file) {
     BlobRec tmp;
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
-        len = tmp.len;
-        memcpy(dest_buf, tmp.data, len);
-        break;
-      }
+    file.seek(slot * sizeof(BlobRec));
+    if (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp) && memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {
+      len = tmp.len;
+      memcpy(dest_buf, tmp.data, len);
     }
     file.close();
   }
   return len;
 }
 
-bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
+bool DataStore::writeBlob(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
   if (len < PUB_KEY_SIZE+4+SIGNATURE_SIZE || len > MAX_ADVERT_PKT_LEN) return false;
   checkAdvBlobFile();
-  File file = _getContactsChannelsFS()->open("/adv_blobs", FILE_O_WRITE);
-  if (file) {
-    uint32_t pos = 0, found_pos = 0;
+  // search index for matching key OR evict by oldest timestamp
+  int slot = findBlobSlot(key);
+  if (slot < 0) {
     uint32_t min_timestamp = 0xFFFFFFFF;
-
-    // search for matching key OR evict by oldest timestmap
-    BlobRec tmp;
-    file.seek(0);
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
-        found_pos = pos;
-        break;
+    for (int i = 0; i < num_blob_recs; i++) {
+      if (blob_index[i].timestamp < min_timestamp) {
+        min_timestamp = blob_index[i].timestamp;
+        slot = i;
       }
-      if (tmp.timestamp < min_timestamp) {
-        min_timestamp = tmp.timestamp;
-        found_pos = pos;
-      }
-
-      pos += sizeof(tmp);
     }
+    if (slot < 0) return false;  // file is empty?
+  }
 
+  File file = openUpdate(_getContactsChannelsFS(), "/adv_blobs");
+  if (file) {
+    BlobRec tmp;
+    memset(&tmp, 0, sizeof(tmp));
     memcpy(tmp.key, key, sizeof(tmp.key));  // just record 7 byte prefix of key
     memcpy(tmp.data, src_buf, len);
     tmp.len = len;
     tmp.timestamp = _clock->getCurrentTime();
 
-    file.seek(found_pos);
-    file.write((uint8_t *) &tmp, sizeof(tmp));
+    file.seek(slot * sizeof(BlobRec));
+    bool success = file.write((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp);
+    file.close();
+
+    if (success) {
+      blob_bytes_written += sizeof(tmp);
+      blob_index[slot].timestamp = tmp.timestamp;
+      memcpy(blob_index[slot].key, tmp.key, sizeof(tmp.key));
+    }
+    return success;
+  }
+  return false; // error
+}
+bool DataStore::removeBlob(const uint8_t key[], int key_len) {
+  int slot = findBlobSlot(key);
+  if (slot < 0) return true;  // not stored
 
+  File file = openUpdate(_getContactsChannelsFS(), "/adv_blobs");
+  if (file) {
+    BlobIndexEntry hdr;   // zero timestamp and key, so slot is next to be re-used
+    memset(&hdr, 0, sizeof(hdr));
+    file.seek(slot * sizeof(BlobRec));
+    bool success = file.write((uint8_t *) &hdr, sizeof(hdr.timestamp) + sizeof(hdr.key)) == sizeof(hdr.timestamp) + sizeof(hdr.key);
     file.close();
-    return true;
+
+    if (success) blob_index[slot] = hdr;
+    return success;
   }
   return false; // error
 }
-bool DataStore::deleteBlobByKey(const uint8_t key[], int key_len) {
-  return true; // this is just a stub on NRF52/STM32 platforms
+
+#if !defined(NRF52_PLATFORM) && !defined(STM32_PLATFORM)
+// migration from the old layout, of one file per blob, ie. "/bl/<hex of 8 byte key prefix>"
+// NOTE: each file is removed once copied, so this can just be re-run if interrupted
+void DataStore::migrateBlobDir() {
+  if (!_fs->exists("/bl")) return;   // nothing (left) to migrate
+
+  int count = 0;
+  bool done = true;
+  for (;;) {   // NOTE: re-open dir each time, as files are removed as we go
+    File dir = openRead(_fs, "/bl");
+    if (!dir) break;
+    File f = dir.openNextFile();
+    dir.close();
+    if (!f) break;
+
+    const char* name = strrchr(f.name(), '/');   // some cores return the full path
+    name = name ? name + 1 : f.name();
+    char path[40];
+    snprintf(path, sizeof(path), "/bl/%s", name);
+
+    uint8_t key[8];
+    uint8_t buf[255];
+    int len = f.isDirectory() ? 0 : f.read(buf, sizeof(buf));
+    f.close();
+    bool is_blob = len >= PUB_KEY_SIZE+4+SIGNATURE_SIZE && len <= MAX_ADVERT_PKT_LEN && mesh::Utils::fromHex(key, sizeof(key), name);
+    if (is_blob) {
+      if (!writeBlob(key, sizeof(key), buf, len)) {   // eg. blob file full, keep the rest for next boot
+        done = false;
+        break;
+      }
+      count++;
+    }   // otherwise, not a blob, so just remove it
+    if (!_fs->remove(path)) {   // avoid looping forever
+      done = false;
+      break;
+    }
+  }
+  if (done) _fs->rmdir("/bl");
+  MESH_DEBUG_PRINTLN("DataStore::migrateBlobDir() - migrated %d blobs", count);
 }
-#else
-inline void makeBlobPath(const uint8_t key[], int key_len, char* path, size_t path_size) {
-  char fname[18];
-  if (key_len > 8) key_len = 8; // just use first 8 bytes (prefix)
-  mesh::Utils::toHex(fname, key, key_len);
-  sprintf(path, "/bl/%s", fname);
+#endif
+
+// write-behind cache of advert blobs, so that bursts of adverts don't each block the loop on a flash write.
+// NOTE: pending blobs are lost on a crash/power loss, at most BLOB_WRITE_CACHE_SIZE (see test/host/test_blob_store),
+//   but they're only the raw adverts for 'Share', and the previously stored (older) advert remains intact.
+
+int DataStore::findPendingBlob(const uint8_t key[], int key_len) const {
+  if (key_len > PUB_KEY_SIZE) key_len = PUB_KEY_SIZE;
+  for (int i = 0; i < num_pending_blobs; i++) {
+    if (pending_blobs[i].key_len == key_len && memcmp(pending_blobs[i].key, key, key_len) == 0) return i;
+  }
+  return -1;  // not found
+}
+
+void DataStore::removePendingBlob(int i) {
+  num_pending_blobs--;
+  for ( ; i < num_pending_blobs; i++) {
+    pending_blobs[i] = pending_blobs[i + 1];
+  }
 }
 
 uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
-  char path[64];
-  makeBlobPath(key, key_len, path, sizeof(path));
-
-  if (_fs->exists(path)) {
-    File f = openRead(_fs, path);
-    if (f) {
-      int len = f.read(dest_buf, 255); // currently MAX 255 byte blob len supported!!
-      f.close();
-      return len;
-    }
+  int i = findPendingBlob(key, key_len);
+  if (i >= 0) {
+    memcpy(dest_buf, pending_blobs[i].data, pending_blobs[i].len);
+    return pending_blobs[i].len;
   }
-  return 0; // not found
+  return readBlob(key, key_len, dest_buf);
 }
 
 bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
-  char path[64];
-  makeBlobPath(key, key_len, path, sizeof(path));
-
-  File f = openWrite(_fs, path);
-  if (f) {
-    int n = f.write(src_buf, len);
-    f.close();
-    if (n == len) return true; // success!
-
-    _fs->remove(path); // blob was only partially written!
+  if (len > MAX_ADVERT_PKT_LEN) return false;
+  if (key_len > PUB_KEY_SIZE) key_len = PUB_KEY_SIZE;
+
+  int i = findPendingBlob(key, key_len);
+  if (i < 0) {
+    if (num_pending_blobs >= BLOB_WRITE_CACHE_SIZE) {   // cache full, write out oldest
+      writeBlob(pending_blobs[0].key, pending_blobs[0].key_len, pending_blobs[0].data, pending_blobs[0].len);
+      removePendingBlob(0);
+    }
+    i = num_pending_blobs++;
+    memcpy(pending_blobs[i].key, key, key_len);
+    pending_blobs[i].key_len = key_len;
   }
-  return false; // error
+  memcpy(pending_blobs[i].data, src_buf, len);
+  pending_blobs[i].len = len;
+  return true;
 }
 
 bool DataStore::deleteBlobByKey(const uint8_t key[], int key_len) {
-  char path[64];
-  makeBlobPath(key, key_len, path, sizeof(path));
+  int i = findPendingBlob(key, key_len);
+  if (i >= 0) removePendingBlob(i);
 
-  _fs->remove(path);
-  
-  return true; // return true even if file did not exist
+  return removeBlob(key, key_len);
+}
+
+void DataStore::flushBlobs() {
+  for (int i = 0; i < num_pending_blobs; i++) {
+    auto b = &pending_blobs[i];
+    if (!writeBlob(b->key, b->key_len, b->data, b->len)) {
+      MESH_DEBUG_PRINTLN("DataStore::flushBlobs() - write failed, len=%d", (uint32_t) b->len);
+    }
+  }
+  num_pending_blobs = 0;
+  MESH_DEBUG_PRINTLN("DataStore::flushBlobs() - total blob bytes written: %u", blob_bytes_written);
 }
-#endif
@@ -5,10 +5,41 @@
 #include <helpers/ChannelDetails.h>
 #include "NodePrefs.h"
 
+#if defined(EXTRAFS) || defined(QSPIFLASH)
+  #define MAX_BLOBRECS 100
+#elif defined(ESP32) || defined(RP2040_PLATFORM)
+  #if defined(MAX_CONTACTS) && MAX_CONTACTS > 200
+    #define MAX_BLOBRECS MAX_CONTACTS   // need at least one per contact, for export/share
+  #else
+    #define MAX_BLOBRECS 200
+  #endif
+#else
+  #define MAX_BLOBRECS 20
+#endif
+
+#define MAX_ADVERT_PKT_LEN   (2 + 32 + PUB_KEY_SIZE + 4 + SIGNATURE_SIZE + MAX_ADVERT_DATA_SIZE)
+
+#ifndef CONTACTS_LOG_MIN_ENTRIES
+  #define CONTACTS_LOG_MIN_ENTRIES  16   // don't bother compacting a short log
+#endif
+#ifndef CONTACTS_LOG_GARBAGE_PCT
+  #define CONTACTS_LOG_GARBAGE_PCT  50   // compact when more than this % of stored records are stale
+#endif
+#ifndef CONTACTS_COMPACT_STEP
+  #define CONTACTS_COMPACT_STEP     8    // records written per stepContactsCompaction(), ie. per loop()
+#endif
+
+// NOTE: so a crash/power loss loses at most this many blobs (the newest advert of each contact, the older stays)
+#ifndef BLOB_WRITE_CACHE_SIZE
+  #define BLOB_WRITE_CACHE_SIZE  4    // max advert blobs held in RAM, pending write to flash
+#endif
+
 class DataStoreHost {
 public:
   virtual bool onContactLoaded(const ContactInfo& contact) =0;
   virtual bool getContactForSave(uint32_t idx, ContactInfo& contact) =0;
+  virtual bool onContactLogUpdate(const ContactInfo& contact) =0;   // add or replace, when replaying contacts log
+  virtual void onContactLogRemove(const uint8_t* pub_key) =0;
   virtual bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) =0;
   virtual bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) =0;
 };
@@ -20,8 +51,42 @@ class DataStore {
   IdentityStore identity_store;
 
   void loadPrefsInt(const char *filename, NodePrefs& prefs, double& node_lat, double& node_lon);
-#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+
+  struct PendingBlob {
+    uint8_t key[PUB_KEY_SIZE];
+    uint8_t key_len;
+    uint8_t len;
+    uint8_t data[MAX_ADVERT_PKT_LEN];
+  };
+  PendingBlob pending_blobs[BLOB_WRITE_CACHE_SIZE];   // in order of oldest to newest
+  int num_pending_blobs;
+  uint32_t blob_bytes_written;
+
+  uint32_t num_snapshot_contacts, num_log_entries;
+  bool contacts_log_damaged;
+  int32_t compact_idx;   // next contact to write to /contacts3.tmp, or -1 if not compacting
+
+  void recoverContactsSnapshot();
+  bool appendContactLog(uint8_t op, const ContactInfo& contact);
+
+  int findPendingBlob(const uint8_t key[], int key_len) const;
+  void removePendingBlob(int i);
+  uint8_t readBlob(const uint8_t key[], int key_len, uint8_t dest_buf[]);
+  bool writeBlob(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len);
+  bool removeBlob(const uint8_t key[], int key_len);
+  struct BlobIndexEntry {    // in-RAM copy of each /adv_blobs record header
+    uint32_t timestamp;
+    uint8_t  key[7];
+  };
+  BlobIndexEntry blob_index[MAX_BLOBRECS];
+  int num_blob_recs;
+
   void checkAdvBlobFile();
+  void extendAdvBlobFile();
+  void loadBlobIndex();
+  int findBlobSlot(const uint8_t key[]) const;
+#if !defined(NRF52_PLATFORM) && !defined(STM32_PLATFORM)
+  void migrateBlobDir();
 #endif
 
 public:
@@ -36,13 +101,23 @@ public:
   void loadPrefs(NodePrefs& prefs, double& node_lat, double& node_lon);
   void savePrefs(const NodePrefs& prefs, double node_lat, double node_lon);
   void loadContacts(DataStoreHost* host);
-  void saveContacts(DataStoreHost* host);
+  void saveContacts(DataStoreHost* host);   // full rewrite, ie. compaction
+  bool appendContact(const ContactInfo& contact);
+  bool appendContactRemoval(const uint8_t* pub_key);
+  bool needsContactsCompaction(uint32_t num_live) const;
+  bool startContactsCompaction();
+  bool stepContactsCompaction(DataStoreHost* host, int max_records);   // true once finished, and snapshot replaced
+  void abortContactsCompaction();
+  bool isCompactingContacts() const { return compact_idx >= 0; }
   void loadChannels(DataStoreHost* host);
   void saveChannels(DataStoreHost* host);
   void migrateToSecondaryFS();
   uint8_t getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]);
   bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len);
   bool deleteBlobByKey(const uint8_t key[], int key_len);
+  bool hasPendingBlobs() const { return num_pending_blobs > 0; }
+  void flushBlobs();
+  uint32_t getBlobBytesWritten() const { return blob_bytes_written; }
   File openRead(const char* filename);
   File openRead(FILESYSTEM* fs, const char* filename);
   bool removeFile(const char* filename);
@@ -57,6 +57,8 @@
 #define CMD_SET_AUTOADD_CONFIG        58
 #define CMD_GET_AUTOADD_CONFIG        59
 #define CMD_GET_ALLOWED_REPEAT_FREQ   60
+#define CMD_GET_NEAREST_CONTACTS      61
+#define CMD_SYNC_CONTACTS             62   // with optional epoch + seq (for delta sync)
 
 // Stats sub-types for CMD_GET_STATS
 #define STATS_TYPE_CORE               0
@@ -90,12 +92,17 @@
 #define RESP_CODE_STATS               24   // v8+, second byte is stats type
 #define RESP_CODE_AUTOADD_CONFIG      25
 #define RESP_ALLOWED_REPEAT_FREQ      26
+#define RESP_CODE_NEAREST_CONTACTS    27   // reply to CMD_GET_NEAREST_CONTACTS
+#define RESP_CODE_CONTACTS_SYNC_START 28   // first reply to CMD_SYNC_CONTACTS
+#define RESP_CODE_CONTACT_REMOVED     29   // multiple of these (after CMD_SYNC_CONTACTS), interleaved with RESP_CODE_CONTACT
+#define RESP_CODE_CONTACTS_SYNC_END   30   // last reply to CMD_SYNC_CONTACTS
 
 #define SEND_TIMEOUT_BASE_MILLIS        500
 #define FLOOD_SEND_TIMEOUT_FACTOR       16.0f
 #define DIRECT_SEND_PERHOP_FACTOR       6.0f
 #define DIRECT_SEND_PERHOP_EXTRA_MILLIS 250
 #define LAZY_CONTACTS_WRITE_DELAY       5000
+#define LAZY_BLOBS_WRITE_DELAY          30000
 
 #define PUBLIC_GROUP_PSK                "izOH6cXN6mrJ5e26oRXNcg=="
 
@@ -177,6 +184,27 @@ void MyMesh::writeContactRespFrame(uint8_t code, const ContactInfo &contact) {
   _serial->writeFrame(out_frame, i);
 }
 
+void MyMesh::writeSyncStartFrame(bool is_full) {
+  int i = 0;
+  out_frame[i++] = RESP_CODE_CONTACTS_SYNC_START;
+  uint32_t epoch = _journal.getEpoch();
+  memcpy(&out_frame[i], &epoch, 4); i += 4;
+  memcpy(&out_frame[i], &_sync_end_seq, 4); i += 4;
+  out_frame[i++] = is_full ? 1 : 0;   // if full, app should remove any contacts NOT sent
+  _serial->writeFrame(out_frame, i);
+}
+
+void MyMesh::startFullContactsSync() {
+  _sync_end_seq = _journal.getSeq();  // any changes during dump will be re-sent next sync
+  writeSyncStartFrame(true);
+
+  _iter = startContactsIterator();
+  _iter_started = true;
+  _iter_is_sync = true;
+  _iter_filter_since = 0;
+  _most_recent_lastmod = 0;
+}
+
 void MyMesh::updateContactFromFrame(ContactInfo &contact, uint32_t& last_mod, const uint8_t *frame, int len) {
   int i = 0;
   uint8_t code = frame[i++]; // eg. CMD_ADD_UPDATE_CONTACT
@@ -202,46 +230,23 @@ void MyMesh::updateContactFromFrame(ContactInfo &contact, uint32_t& last_mod, co
   }
 }
 
-bool MyMesh::Frame::isChannelMsg() const {
-  return buf[0] == RESP_CODE_CHANNEL_MSG_RECV || buf[0] == RESP_CODE_CHANNEL_MSG_RECV_V3;
-}
-
 void MyMesh::addToOfflineQueue(const uint8_t frame[], int len) {
-  if (offline_queue_len >= OFFLINE_QUEUE_SIZE) {
+  bool is_channel_msg = frame[0] == RESP_CODE_CHANNEL_MSG_RECV || frame[0] == RESP_CODE_CHANNEL_MSG_RECV_V3;
+  if (!_offline.add(frame, len, is_channel_msg)) {
     MESH_DEBUG_PRINTLN("WARN: offline_queue is full!");
-    int pos = 0;
-    while (pos < offline_queue_len) {
-      if (offline_queue[pos].isChannelMsg()) {
-        for (int i = pos; i < offline_queue_len - 1; i++) { // delete oldest channel msg from queue
-          offline_queue[i] = offline_queue[i + 1];
-        }
-        MESH_DEBUG_PRINTLN("INFO: removed oldest channel message from queue.");
-        offline_queue[offline_queue_len - 1].len = len;
-        memcpy(offline_queue[offline_queue_len - 1].buf, frame, len);
-        return;
-      }
-      pos++;
-    }
-    MESH_DEBUG_PRINTLN("INFO: no channel messages to remove from queue.");
-  } else {
-    offline_queue[offline_queue_len].len = len;
-    memcpy(offline_queue[offline_queue_len].buf, frame, len);
-    offline_queue_len++;
   }
 }
 
 int MyMesh::getFromOfflineQueue(uint8_t frame[]) {
-  if (offline_queue_len > 0) {         // check offline queue
-    size_t len = offline_queue[0].len; // take from top of queue
-    memcpy(frame, offline_queue[0].buf, len);
+  return _offline.get(frame);
+}
 
-    offline_queue_len--;
-    for (int i = 0; i < offline_queue_len; i++) { // delete top item from queue
-      offline_queue[i] = offline_queue[i + 1];
-    }
-    return len;
-  }
-  return 0; // queue is empty
+void MyMesh::writeMsgWaitingFrame() {
+  uint16_t depth = _offline.count();
+  uint8_t frame[3];
+  frame[0] = PUSH_CODE_MSG_WAITING; // send push 'tickle'
+  memcpy(&frame[1], &depth, 2);     // num messages now waiting
+  _serial->writeFrame(frame, 3);
 }
 
 float MyMesh::getAirtimeBudgetFactor() const {
@@ -310,6 +315,7 @@ bool MyMesh::shouldOverwriteWhenFull() const {
 
 void MyMesh::onContactOverwrite(const uint8_t* pub_key) {
     _store->deleteBlobByKey(pub_key, PUB_KEY_SIZE); // delete from storage
+  _journal.record(pub_key, JOURNAL_OP_REMOVE);
   if (_serial->isConnected()) {
     out_frame[0] = PUSH_CODE_CONTACT_DELETED;
     memcpy(&out_frame[1], pub_key, PUB_KEY_SIZE);
@@ -361,7 +367,10 @@ void MyMesh::onDiscoveredContact(ContactInfo &contact, bool is_new, uint8_t path
     memcpy(p->path, path, p->path_len);
   }
 
-  if (!is_new) dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY); // only schedule lazy write for contacts that are in contacts[]
+  if (!is_new) {   // only schedule lazy write for contacts that are in contacts[]
+    _journal.record(contact.id.pub_key, JOURNAL_OP_UPDATE);
+    dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
+  }
 }
 
 static int sort_by_recent(const void *a, const void *b) {
@@ -383,6 +392,7 @@ void MyMesh::onContactPathUpdated(const ContactInfo &contact) {
   memcpy(&out_frame[1], contact.id.pub_key, PUB_KEY_SIZE);
   _serial->writeFrame(out_frame, 1 + PUB_KEY_SIZE); // NOTE: app may not be connected
 
+  _journal.record(contact.id.pub_key, JOURNAL_OP_UPDATE);
   dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
 }
 
@@ -434,16 +444,14 @@ void MyMesh::queueMessage(const ContactInfo &from, uint8_t txt_type, mesh::Packe
   addToOfflineQueue(out_frame, i);
 
   if (_serial->isConnected()) {
-    uint8_t frame[1];
-    frame[0] = PUSH_CODE_MSG_WAITING; // send push 'tickle'
-    _serial->writeFrame(frame, 1);
+    writeMsgWaitingFrame();
   }
 
 #ifdef DISPLAY_CLASS
   // we only want to show text messages on display, not cli data
   bool should_display = txt_type == TXT_TYPE_PLAIN || txt_type == TXT_TYPE_SIGNED_PLAIN;
   if (should_display && _ui) {
-    _ui->newMsg(path_len, from.name, text, offline_queue_len);
+    _ui->newMsg(path_len, from.name, text, _offline.count());
     if (!_serial->isConnected()) {
       _ui->notify(UIEventType::contactMessage);
     }
@@ -500,6 +508,7 @@ void MyMesh::onSignedMessageRecv(const ContactInfo &from, mesh::Packet *pkt, uin
                                  const uint8_t *sender_prefix, const char *text) {
   markConnectionActive(from);
   // from.sync_since change needs to be persisted
+  _journal.record(from.id.pub_key, JOURNAL_OP_UPDATE);
   dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
   queueMessage(from, TXT_TYPE_SIGNED_PLAIN, pkt, sender_timestamp, sender_prefix, 4, text);
 }
@@ -532,9 +541,7 @@ void MyMesh::onChannelMessageRecv(const mesh::GroupChannel &channel, mesh::Packe
   addToOfflineQueue(out_frame, i);
 
   if (_serial->isConnected()) {
-    uint8_t frame[1];
-    frame[0] = PUSH_CODE_MSG_WAITING; // send push 'tickle'
-    _serial->writeFrame(frame, 1);
+    writeMsgWaitingFrame();
   } else {
 #ifdef DISPLAY_CLASS
     if (_ui) _ui->notify(UIEventType::channelMessage);
@@ -547,7 +554,7 @@ void MyMesh::onChannelMessageRecv(const mesh::GroupChannel &channel, mesh::Packe
   if (getChannel(channel_idx, channel_details)) {
     channel_name = channel_details.name;
   }
-  if (_ui) _ui->newMsg(path_len, channel_name, text, offline_queue_len);
+  if (_ui) _ui->newMsg(path_len, channel_name, text, _offline.count());
 #endif
 }
 
@@ -787,13 +794,18 @@ MyMesh::MyMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMe
     : BaseChatMesh(radio, *new ArduinoMillis(), rng, rtc, *new StaticPoolPacketManager(16), tables),
       _serial(NULL), telemetry(MAX_PACKET_PAYLOAD - 4), _store(&store), _ui(ui) {
   _iter_started = false;
+  _iter_is_sync = false;
+  _delta_started = false;
+  _saved_seq = 0;
   _cli_rescue = false;
-  offline_queue_len = 0;
   app_target_ver = 0;
   clearPendingReqs();
   next_ack_idx = 0;
   sign_data = NULL;
   dirty_contacts_expiry = 0;
+  dirty_blobs_expiry = 0;
+  next_compact_check = 0;
+  _compact_seq = 0;
   memset(advert_paths, 0, sizeof(advert_paths));
   memset(send_scope.key, 0, sizeof(send_scope.key));
 
@@ -814,6 +826,11 @@ MyMesh::MyMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMe
 void MyMesh::begin(bool has_display) {
   BaseChatMesh::begin();
 
+  uint32_t epoch;
+  getRNG()->random((uint8_t *) &epoch, sizeof(epoch));
+  _journal.reset(epoch);
+  _saved_seq = 0;
+
   if (!_store->loadMainIdentity(self_id)) {
     self_id = radio_new_identity(); // create new random identity
     int count = 0;
@@ -870,6 +887,7 @@ void MyMesh::begin(bool has_display) {
   resetContacts();
   _store->loadContacts(this);
   bootstrapRTCfromContacts();
+  _offline.begin(_store->getSecondaryFS() ? _store->getSecondaryFS() : _store->getPrimaryFS());
   addChannel("Public", PUBLIC_GROUP_PSK); // pre-configure Andy's public channel
   _store->loadChannels(this);
 
@@ -938,6 +956,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     MESH_DEBUG_PRINTLN("App %s connected", app_name);
 
     _iter_started = false; // stop any left-over ContactsIterator
+    _delta_started = false;
     int i = 0;
     out_frame[i++] = RESP_CODE_SELF_INFO;
     out_frame[i++] = ADV_TYPE_CHAT; // what this node Advert identifies as (maybe node's pronouns too?? :-)
@@ -1039,7 +1058,7 @@ void MyMesh::handleCmdFrame(size_t len) {
       }
     }
   } else if (cmd_frame[0] == CMD_GET_CONTACTS) { // get Contact list
-    if (_iter_started) {
+    if (_iter_started || _delta_started) {
       writeErrFrame(ERR_CODE_BAD_STATE); // iterator is currently busy
     } else {
       if (len >= 5) { // has optional 'since' param
@@ -1057,8 +1076,27 @@ void MyMesh::handleCmdFrame(size_t len) {
       // start iterator
       _iter = startContactsIterator();
       _iter_started = true;
+      _iter_is_sync = false;
       _most_recent_lastmod = 0;
     }
+  } else if (cmd_frame[0] == CMD_SYNC_CONTACTS) {
+    if (_iter_started || _delta_started) {
+      writeErrFrame(ERR_CODE_BAD_STATE); // iterator is currently busy
+    } else {
+      uint32_t epoch = 0, since = 0;
+      if (len >= 9) { // has optional epoch + seq, from app's previous sync
+        memcpy(&epoch, &cmd_frame[1], 4);
+        memcpy(&since, &cmd_frame[5], 4);
+      }
+      _sync_end_seq = _journal.getSeq();
+      if (len >= 9 && _journal.canReplayFrom(epoch, since)) {
+        writeSyncStartFrame(false);
+        _sync_cursor = since;
+        _delta_started = true;
+      } else {
+        startFullContactsSync();  // journal has rolled over (or rebooted), need to send everything
+      }
+    }
   } else if (cmd_frame[0] == CMD_SET_ADVERT_NAME && len >= 2) {
     int nlen = len - 1;
     if (nlen > sizeof(_prefs.node_name) - 1) nlen = sizeof(_prefs.node_name) - 1; // max len
@@ -1120,6 +1158,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if (recipient) {
       recipient->out_path_len = -1;
       // recipient->lastmod = ??   shouldn't be needed, app already has this version of contact
+      _journal.record(pub_key, JOURNAL_OP_UPDATE);
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
       writeOKFrame();
     } else {
@@ -1132,6 +1171,8 @@ void MyMesh::handleCmdFrame(size_t len) {
     if (recipient) {
       updateContactFromFrame(*recipient, last_mod, cmd_frame, len);
       recipient->lastmod = last_mod;
+      onContactUpdated(*recipient);
+      _journal.record(pub_key, JOURNAL_OP_UPDATE);
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
       writeOKFrame();
     } else {
@@ -1140,6 +1181,7 @@ void MyMesh::handleCmdFrame(size_t len) {
       contact.lastmod = last_mod;
       contact.sync_since = 0;
       if (addContact(contact)) {
+        _journal.record(pub_key, JOURNAL_OP_UPDATE);
         dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
         writeOKFrame();
       } else {
@@ -1151,6 +1193,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     ContactInfo *recipient = lookupContactByPubKey(pub_key, PUB_KEY_SIZE);
     if (recipient && removeContact(*recipient)) {
       _store->deleteBlobByKey(pub_key, PUB_KEY_SIZE);
+      _journal.record(pub_key, JOURNAL_OP_REMOVE);
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
       writeOKFrame();
     } else {
@@ -1217,7 +1260,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if ((out_len = getFromOfflineQueue(out_frame)) > 0) {
       _serial->writeFrame(out_frame, out_len);
 #ifdef DISPLAY_CLASS
-      if (_ui) _ui->msgRead(offline_queue_len);
+      if (_ui) _ui->msgRead(_offline.count());
 #endif
     } else {
       out_frame[0] = RESP_CODE_NO_MORE_MESSAGES;
@@ -1304,9 +1347,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     savePrefs();
     writeOKFrame();
   } else if (cmd_frame[0] == CMD_REBOOT && memcmp(&cmd_frame[1], "reboot", 6) == 0) {
-    if (dirty_contacts_expiry) { // is there are pending dirty contacts write needed?
-      saveContacts();
-    }
+    flushPendingWrites();
     board.reboot();
   } else if (cmd_frame[0] == CMD_GET_BATT_AND_STORAGE) {
     uint8_t reply[11];
@@ -1782,6 +1823,36 @@ void MyMesh::handleCmdFrame(size_t len) {
       memcpy(&out_frame[i], &r->upper_freq, 4); i += 4;
     }
     _serial->writeFrame(out_frame, i);
+  } else if (cmd_frame[0] == CMD_GET_NEAREST_CONTACTS && len >= 7) {
+    // format: type (0 = any), max_results, max_dist (metres, 0 = unlimited), optional: lat, lon (default is self location)
+    uint8_t type = cmd_frame[1];
+    int max_results = cmd_frame[2];
+    uint32_t max_dist;
+    memcpy(&max_dist, &cmd_frame[3], 4);
+    int32_t lat, lon;
+    if (len >= 15) {
+      memcpy(&lat, &cmd_frame[7], 4);
+      memcpy(&lon, &cmd_frame[11], 4);
+    } else {
+      lat = (int32_t)(sensors.node_lat * 1000000.0);
+      lon = (int32_t)(sensors.node_lon * 1000000.0);
+    }
+    if (lat == 0 && lon == 0) {
+      writeErrFrame(ERR_CODE_BAD_STATE);  // no location to search from
+    } else {
+      ContactInfo* results[MAX_NEAREST_RESULTS];
+      uint32_t dists[MAX_NEAREST_RESULTS];
+      int n = findNearestContacts(lat, lon, type, max_dist, results, dists, max_results);
+
+      int i = 0;
+      out_frame[i++] = RESP_CODE_NEAREST_CONTACTS;
+      out_frame[i++] = n;
+      for (int k = 0; k < n; k++) {
+        memcpy(&out_frame[i], results[k]->id.pub_key, 6); i += 6;
+        memcpy(&out_frame[i], &dists[k], 4); i += 4;
+      }
+      _serial->writeFrame(out_frame, i);
+    }
   } else {
     writeErrFrame(ERR_CODE_UNSUPPORTED_CMD);
     MESH_DEBUG_PRINTLN("ERROR: unknown command: %02X", cmd_frame[0]);
@@ -1957,6 +2028,7 @@ void MyMesh::checkCLIRescueCmd() {
       }
 
     } else if (strcmp(cli_command, "reboot") == 0) {
+      flushPendingWrites();
       board.reboot();  // doesn't return
     } else {
       Serial.println("  Error: unknown command");
@@ -1981,6 +2053,14 @@ void MyMesh::checkSerialInterface() {
           _most_recent_lastmod = contact.lastmod; // save for the RESP_CODE_END_OF_CONTACTS frame
         }
       }
+    } else if (_iter_is_sync) { // EOF of full sync
+      int i = 0;
+      out_frame[i++] = RESP_CODE_CONTACTS_SYNC_END;
+      uint32_t epoch = _journal.getEpoch();
+      memcpy(&out_frame[i], &epoch, 4); i += 4;
+      memcpy(&out_frame[i], &_sync_end_seq, 4); i += 4;
+      _serial->writeFrame(out_frame, i);
+      _iter_started = false;
     } else { // EOF
       out_frame[0] = RESP_CODE_END_OF_CONTACTS;
       memcpy(&out_frame[1], &_most_recent_lastmod,
@@ -1988,6 +2068,30 @@ void MyMesh::checkSerialInterface() {
       _serial->writeFrame(out_frame, 5);
       _iter_started = false;
     }
+  } else if (_delta_started && !_serial->isWriteBusy()) {
+    auto e = _journal.next(_sync_cursor, _sync_end_seq);
+    if (e) {
+      ContactInfo* contact = e->op == JOURNAL_OP_UPDATE ? lookupContactByPubKey(e->pub_key, PUB_KEY_SIZE) : NULL;
+      if (contact) {
+        writeContactRespFrame(RESP_CODE_CONTACT, *contact);
+      } else {   // removed (or since overwritten)
+        out_frame[0] = RESP_CODE_CONTACT_REMOVED;
+        memcpy(&out_frame[1], e->pub_key, PUB_KEY_SIZE);
+        _serial->writeFrame(out_frame, 1 + PUB_KEY_SIZE);
+      }
+    } else {
+      _delta_started = false;
+      if (_journal.isLost(_sync_cursor)) {
+        startFullContactsSync();   // journal rolled over during streaming, app must restart as full sync
+      } else {
+        int i = 0;
+        out_frame[i++] = RESP_CODE_CONTACTS_SYNC_END;
+        uint32_t epoch = _journal.getEpoch();
+        memcpy(&out_frame[i], &epoch, 4); i += 4;
+        memcpy(&out_frame[i], &_sync_end_seq, 4); i += 4;
+        _serial->writeFrame(out_frame, i);
+      }
+    }
   //} else if (!_serial->isWriteBusy()) {
   //  checkConnections();    // TODO - deprecate the 'Connections' stuff
   }
@@ -2004,8 +2108,24 @@ void MyMesh::loop() {
 
   // is there are pending dirty contacts write needed?
   if (dirty_contacts_expiry && millisHasNowPassed(dirty_contacts_expiry)) {
-    saveContacts();
+    persistContacts();
     dirty_contacts_expiry = 0;
+  } else if (_store->isCompactingContacts()) {
+    // a few records per loop(), rather than stall on a full rewrite
+    if (_journal.getSeq() != _compact_seq) {
+      _store->abortContactsCompaction();   // contacts changed part way (indexes may have shifted), try again later
+    } else {
+      _store->stepContactsCompaction(this, CONTACTS_COMPACT_STEP);
+    }
+  } else if (!dirty_contacts_expiry && millisHasNowPassed(next_compact_check)) {
+    if (_store->needsContactsCompaction(getNumContacts()) && _store->startContactsCompaction()) {
+      _compact_seq = _journal.getSeq();   // all changes are in the log by now (not dirty)
+    }
+    next_compact_check = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
+  }
+  if (dirty_blobs_expiry && millisHasNowPassed(dirty_blobs_expiry)) {
+    _store->flushBlobs();
+    dirty_blobs_expiry = 0;
   }
 
 #ifdef DISPLAY_CLASS
@@ -2013,6 +2133,63 @@ void MyMesh::loop() {
 #endif
 }
 
+bool MyMesh::onContactLogUpdate(const ContactInfo& contact) {
+  ContactInfo* existing = lookupContactByPubKey(contact.id.pub_key, PUB_KEY_SIZE);
+  if (existing == NULL) return addContact(contact);
+
+  *existing = contact;
+  onContactUpdated(*existing);
+  return true;
+}
+
+void MyMesh::onContactLogRemove(const uint8_t* pub_key) {
+  ContactInfo* existing = lookupContactByPubKey(pub_key, PUB_KEY_SIZE);
+  if (existing) removeContact(*existing);
+}
+
+// append just the contacts changed since last persist, or rewrite all if journal has rolled over
+void MyMesh::persistContacts() {
+  uint32_t cursor = _saved_seq;
+  uint32_t end_seq = _journal.getSeq();
+  if (!_journal.canReplayFrom(_journal.getEpoch(), cursor)) {
+    saveContacts();
+    return;
+  }
+
+  bool success = true;
+  const JournalEntry* e;
+  while (success && (e = _journal.next(cursor, end_seq)) != NULL) {
+    ContactInfo* c = e->op == JOURNAL_OP_REMOVE ? NULL : lookupContactByPubKey(e->pub_key, PUB_KEY_SIZE);
+    if (c) {
+      success = _store->appendContact(*c);
+    } else {
+      success = _store->appendContactRemoval(e->pub_key);
+    }
+  }
+  if (success && !_journal.isLost(cursor)) {
+    _saved_seq = end_seq;
+  } else {
+    saveContacts();  // fallback to full rewrite
+  }
+}
+
+bool MyMesh::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) {
+  dirty_blobs_expiry = futureMillis(LAZY_BLOBS_WRITE_DELAY);   // write-behind, flushed once idle
+  return _store->putBlobByKey(key, key_len, src_buf, len);
+}
+
+void MyMesh::flushPendingWrites() {
+  if (dirty_contacts_expiry) { // is there are pending dirty contacts write needed?
+    persistContacts();
+    dirty_contacts_expiry = 0;
+  }
+  if (_store->hasPendingBlobs()) {
+    _store->flushBlobs();
+  }
+  dirty_blobs_expiry = 0;
+  _offline.flush();   // so that waiting messages survive the reboot
+}
+
 bool MyMesh::advert() {
   mesh::Packet* pkt;
   if (_prefs.advert_loc_policy == ADVERT_LOC_NONE) {
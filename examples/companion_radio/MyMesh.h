@@ -25,6 +25,8 @@
 
 #include "DataStore.h"
 #include "NodePrefs.h"
+#include "ContactJournal.h"
+#include "OfflineQueue.h"
 
 #include <RTClib.h>
 #include <helpers/ArduinoHelpers.h>
@@ -59,10 +61,6 @@
 #define MAX_CONTACTS 100
 #endif
 
-#ifndef OFFLINE_QUEUE_SIZE
-#define OFFLINE_QUEUE_SIZE 16
-#endif
-
 #ifndef BLE_NAME_PREFIX
 #define BLE_NAME_PREFIX "MeshCore-"
 #endif
@@ -150,6 +148,8 @@ protected:
   // DataStoreHost methods
   bool onContactLoaded(const ContactInfo& contact) override { return addContact(contact); }
   bool getContactForSave(uint32_t idx, ContactInfo& contact) override { return getContactByIdx(idx, contact); }
+  bool onContactLogUpdate(const ContactInfo& contact) override;
+  void onContactLogRemove(const uint8_t* pub_key) override;
   bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) override { return setChannel(channel_idx, ch); }
   bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) override { return getChannel(channel_idx, ch); }
 
@@ -159,21 +159,23 @@ protected:
 
 public:
   void savePrefs() { _store->savePrefs(_prefs, sensors.node_lat, sensors.node_lon); }
+  void flushPendingWrites();   // call before reboot or power off
 
 private:
   void writeOKFrame();
   void writeErrFrame(uint8_t err_code);
   void writeDisabledFrame();
   void writeContactRespFrame(uint8_t code, const ContactInfo &contact);
+  void writeSyncStartFrame(bool is_full);
+  void startFullContactsSync();
   void updateContactFromFrame(ContactInfo &contact, uint32_t& last_mod, const uint8_t *frame, int len);
   void addToOfflineQueue(const uint8_t frame[], int len);
   int getFromOfflineQueue(uint8_t frame[]);
+  void writeMsgWaitingFrame();
   int getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) override { 
     return _store->getBlobByKey(key, key_len, dest_buf);
   }
-  bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) override {
-    return _store->putBlobByKey(key, key_len, src_buf, len);
-  }
+  bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) override;
 
   void checkCLIRescueCmd();
   void checkSerialInterface();
@@ -181,7 +183,8 @@ private:
 
   // helpers, short-cuts
   void saveChannels() { _store->saveChannels(this); }
-  void saveContacts() { _store->saveContacts(this); }
+  void saveContacts() { _store->saveContacts(this); _saved_seq = _journal.getSeq(); }
+  void persistContacts();
 
   DataStore* _store;
   NodePrefs _prefs;
@@ -195,6 +198,11 @@ private:
   ContactsIterator _iter;
   uint32_t _iter_filter_since;
   uint32_t _most_recent_lastmod;
+  ContactJournal _journal;
+  uint32_t _sync_cursor, _sync_end_seq;
+  uint32_t _saved_seq;   // journal seq of last change persisted to contacts store
+  bool _iter_is_sync;    // full dump for CMD_SYNC_CONTACTS
+  bool _delta_started;
   uint32_t _active_ble_pin;
   bool _iter_started;
   bool _cli_rescue;
@@ -203,6 +211,9 @@ private:
   uint8_t *sign_data;
   uint32_t sign_data_len;
   unsigned long dirty_contacts_expiry;
+  unsigned long dirty_blobs_expiry;
+  unsigned long next_compact_check;
+  uint32_t _compact_seq;   // journal seq when compaction started
 
   TransportKey send_scope;
 
@@ -210,14 +221,7 @@ private:
   uint8_t out_frame[MAX_FRAME_SIZE + 1];
   CayenneLPP telemetry;
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-
-    bool isChannelMsg() const;
-  };
-  int offline_queue_len;
-  Frame offline_queue[OFFLINE_QUEUE_SIZE];
+  OfflineQueue _offline;
 
   struct AckTableEntry {
     unsigned long msg_sent;
@@ -0,0 +1,265 @@
+#include "OfflineQueue.h"
+#include <MeshCore.h>
+
+#define SPILL_MAGIC       0x3251464F    // "OFQ2"
+#define SPILL_HDR_SIZE    (2 * sizeof(SpillHeader))   // two copies, written alternately
+
+struct SpillHeader {
+  uint32_t magic;
+  uint32_t taken_seq;
+  uint32_t check;     // ~taken_seq, so a torn write is ignored
+};
+
+static File openRead(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(filename, FILE_O_READ);
+#else
+  return fs->open(filename, "r");
+#endif
+}
+
+static File openWrite(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  fs->remove(filename);
+  return fs->open(filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return fs->open(filename, "w");
+#else
+  return fs->open(filename, "w", true);
+#endif
+}
+
+// for writing at arbitrary offsets, WITHOUT truncating
+static File openUpdate(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(filename, FILE_O_WRITE);
+#else
+  return fs->open(filename, "r+");
+#endif
+}
+
+#define RAM_QUEUE_SIZE   (OFFLINE_QUEUE_SIZE / 2)
+
+FrameQueue::FrameQueue(const char* filename, int num_spill, bool drop_oldest)
+  : ram_head(0), ram_count(0), _fs(NULL), _filename(filename), spill_size(num_spill), spill_head(0), spill_count(0),
+    taken_seq(0), spill_seq(0), hdr_slot(0), unsaved_pops(0), _drop_oldest(drop_oldest)
+{
+}
+
+void FrameQueue::begin(FILESYSTEM* fs) {
+  _fs = fs;
+  spill_head = spill_count = 0;
+  taken_seq = spill_seq = 0;
+  hdr_slot = unsaved_pops = 0;
+
+  uint32_t file_size = SPILL_HDR_SIZE + spill_size * sizeof(QueuedFrame);
+  File file = openRead(_fs, _filename);
+  if (file) {
+    bool valid = file.size() == file_size && loadSpill(file);
+    file.close();
+    if (valid) return;
+  }
+
+  // create new, pre-allocated to fixed size
+  spill_head = spill_count = 0;
+  taken_seq = spill_seq = 0;
+  file = openWrite(_fs, _filename);
+  if (file) {
+    SpillHeader hdr = { SPILL_MAGIC, 0, ~0u };
+    bool success = file.write((uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr)
+                && file.write((uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr);
+
+    QueuedFrame zeroes;
+    memset(&zeroes, 0, sizeof(zeroes));
+    for (int i = 0; i < spill_size && success; i++) {
+      success = file.write((uint8_t *) &zeroes, sizeof(zeroes)) == sizeof(zeroes);
+    }
+    file.close();
+    if (success) return;
+  }
+  MESH_DEBUG_PRINTLN("FrameQueue::begin() - unable to create %s, RAM only", _filename);
+  spill_size = 0;
+}
+
+static bool readSlotSeq(File& file, int slot, uint32_t& seq) {
+  file.seek(SPILL_HDR_SIZE + slot * sizeof(QueuedFrame));
+  return file.read((uint8_t *) &seq, sizeof(seq)) == sizeof(seq);
+}
+
+bool FrameQueue::loadSpill(File& file) {
+  SpillHeader hdr[2];
+  if (file.read((uint8_t *) hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+
+  bool found = false;
+  for (int i = 0; i < 2; i++) {   // the newest intact copy
+    if (hdr[i].magic == SPILL_MAGIC && hdr[i].check == ~hdr[i].taken_seq && (!found || hdr[i].taken_seq > taken_seq)) {
+      taken_seq = hdr[i].taken_seq;
+      hdr_slot = i ^ 1;   // next write goes over the other
+      found = true;
+    }
+  }
+  if (!found) return false;
+
+  // the queue is the run of frames newer than taken_seq, starting from the oldest of them
+  spill_seq = taken_seq;
+  int oldest = -1;
+  uint32_t oldest_seq = 0;
+  for (int i = 0; i < spill_size; i++) {
+    uint32_t seq;
+    if (!readSlotSeq(file, i, seq)) return false;
+    if (seq > spill_seq) spill_seq = seq;
+    if (seq > taken_seq && (oldest < 0 || seq < oldest_seq)) {
+      oldest = i;
+      oldest_seq = seq;
+    }
+  }
+  if (oldest >= 0) {
+    spill_head = oldest;
+    uint32_t prev = taken_seq, seq;
+    while (spill_count < spill_size && readSlotSeq(file, (spill_head + spill_count) % spill_size, seq) && seq > prev) {
+      prev = seq;
+      spill_count++;
+    }
+  }
+  return true;
+}
+
+bool FrameQueue::saveSpillHeader(File& file) {
+  SpillHeader hdr = { SPILL_MAGIC, taken_seq, ~taken_seq };
+  file.seek(hdr_slot * sizeof(SpillHeader));
+  if (file.write((uint8_t *) &hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+
+  hdr_slot ^= 1;
+  unsaved_pops = 0;
+  return true;
+}
+
+bool FrameQueue::spillOldestRAM() {
+  if (spill_size == 0) return false;   // no flash
+  if (spill_count >= spill_size) {
+    if (!_drop_oldest) return false;   // full
+
+    spill_head = (spill_head + 1) % spill_size;   // drop oldest in flash (its slot is written over, next)
+    spill_count--;
+  }
+
+  File file = openUpdate(_fs, _filename);
+  if (!file) return false;
+
+  // NOTE: no header write, the frame's seq (newer than taken_seq) is what puts it in the queue
+  int slot = (spill_head + spill_count) % spill_size;
+  file.seek(SPILL_HDR_SIZE + slot * sizeof(QueuedFrame));
+  bool success = file.write((uint8_t *) &ram[ram_head], sizeof(QueuedFrame)) == sizeof(QueuedFrame);
+  file.close();
+
+  if (success) {
+    spill_count++;
+    spill_seq = ram[ram_head].seq;
+    ram_head = (ram_head + 1) % RAM_QUEUE_SIZE;
+    ram_count--;
+  }
+  return success;
+}
+
+bool FrameQueue::push(uint32_t seq, const uint8_t frame[], int len) {
+  if (ram_count >= RAM_QUEUE_SIZE && !spillOldestRAM()) {
+    if (!_drop_oldest) return false;   // full
+
+    ram_head = (ram_head + 1) % RAM_QUEUE_SIZE;   // drop oldest in RAM
+    ram_count--;
+  }
+
+  auto f = &ram[(ram_head + ram_count) % RAM_QUEUE_SIZE];
+  f->seq = seq;
+  f->len = len;
+  memcpy(f->buf, frame, len);
+  ram_count++;
+  return true;
+}
+
+uint32_t FrameQueue::peekSeq() {
+  if (spill_count == 0) return ram[ram_head].seq;
+
+  uint32_t seq = 0;
+  File file = openRead(_fs, _filename);
+  if (file) {
+    file.seek(SPILL_HDR_SIZE + spill_head * sizeof(QueuedFrame));
+    file.read((uint8_t *) &seq, sizeof(seq));
+    file.close();
+  }
+  return seq;
+}
+
+uint32_t FrameQueue::lastSeq() {
+  if (ram_count > 0) return ram[(ram_head + ram_count - 1) % RAM_QUEUE_SIZE].seq;
+  return spill_seq;   // (new frames must be newer than any in the file, or than taken_seq)
+}
+
+int FrameQueue::pop(uint8_t frame[]) {
+  if (spill_count > 0) {   // oldest are in flash
+    File file = openUpdate(_fs, _filename);
+    if (!file) return 0;
+
+    QueuedFrame f;
+    file.seek(SPILL_HDR_SIZE + spill_head * sizeof(QueuedFrame));
+    int len = 0;
+    if (file.read((uint8_t *) &f, sizeof(f)) == sizeof(f)) {
+      if (f.seq > taken_seq) taken_seq = f.seq;
+      if (f.len <= MAX_FRAME_SIZE) {
+        len = f.len;
+        memcpy(frame, f.buf, len);
+      }
+    }
+    spill_head = (spill_head + 1) % spill_size;   // skip, even if unreadable
+    spill_count--;
+    if (++unsaved_pops >= OFFLINE_POP_BATCH || spill_count == 0) saveSpillHeader(file);
+    file.close();
+    return len;
+  }
+
+  if (ram_count > 0) {
+    auto f = &ram[ram_head];
+    memcpy(frame, f->buf, f->len);
+    ram_head = (ram_head + 1) % RAM_QUEUE_SIZE;
+    ram_count--;
+    return f->len;
+  }
+  return 0;  // queue is empty
+}
+
+void FrameQueue::flush() {
+  while (ram_count > 0 && spillOldestRAM()) { }
+
+  if (unsaved_pops > 0) {
+    File file = openUpdate(_fs, _filename);
+    if (file) {
+      saveSpillHeader(file);
+      file.close();
+    }
+  }
+}
+
+void OfflineQueue::begin(FILESYSTEM* fs) {
+  _direct.begin(fs);
+  _channel.begin(fs);
+
+  // carry on sequence from frames retained in flash
+  uint32_t d = _direct.lastSeq(), c = _channel.lastSeq();
+  next_seq = (d > c ? d : c) + 1;
+}
+
+bool OfflineQueue::add(const uint8_t frame[], int len, bool is_channel_msg) {
+  if (len > MAX_FRAME_SIZE) len = MAX_FRAME_SIZE;
+  if (is_channel_msg) {
+    return _channel.push(next_seq++, frame, len);
+  }
+  return _direct.push(next_seq++, frame, len);
+}
+
+int OfflineQueue::get(uint8_t frame[]) {
+  if (_direct.count() == 0) return _channel.pop(frame);
+  if (_channel.count() == 0) return _direct.pop(frame);
+
+  // take whichever is oldest
+  return _direct.peekSeq() < _channel.peekSeq() ? _direct.pop(frame) : _channel.pop(frame);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+#include <helpers/BaseSerialInterface.h>
+
+#ifndef OFFLINE_QUEUE_SIZE
+  #define OFFLINE_QUEUE_SIZE 16     // frames held in RAM (split evenly between direct and channel msgs)
+#endif
+static_assert(OFFLINE_QUEUE_SIZE >= 2, "OFFLINE_QUEUE_SIZE must be at least 2 (one RAM slot per queue)");
+
+// frames in each spill file, ~180 bytes each
+#if (defined(NRF52_PLATFORM) && !defined(EXTRAFS) && !defined(QSPIFLASH)) || defined(STM32_PLATFORM)
+  // small internal filesystem (~28KB on nRF52), shared with contacts, channels, etc: ~2.2KB for both files
+  #ifndef OFFLINE_SPILL_DIRECT
+    #define OFFLINE_SPILL_DIRECT    8
+  #endif
+  #ifndef OFFLINE_SPILL_CHANNEL
+    #define OFFLINE_SPILL_CHANNEL   4
+  #endif
+#else
+  #ifndef OFFLINE_SPILL_DIRECT
+    #define OFFLINE_SPILL_DIRECT   64
+  #endif
+  #ifndef OFFLINE_SPILL_CHANNEL
+    #define OFFLINE_SPILL_CHANNEL  64
+  #endif
+#endif
+
+#ifndef OFFLINE_POP_BATCH
+  #define OFFLINE_POP_BATCH   8     // frames taken from flash per spill header write (and most re-sent after a crash)
+#endif
+
+struct QueuedFrame {
+  uint32_t seq;   // arrival order, across both queues
+  uint8_t len;
+  uint8_t buf[MAX_FRAME_SIZE];
+};
+
+/**
+ * \brief  FIFO of frames, as a RAM ring which spills its oldest frames to a fixed-size ring file in flash.
+ *   All frames in flash are older than those in RAM, so they are taken first.
+ *   A spill is just the one slot write: frames in the file newer than the header's 'taken' seq are the queue.
+ *   The header (two alternating copies) is only written every OFFLINE_POP_BATCH frames taken, or once the file
+ *   is empty, or on flush().
+ *   On a crash or power loss (ie. no flush()), the frames still in RAM are lost, at most OFFLINE_QUEUE_SIZE/2 (the
+ *   newest), and up to OFFLINE_POP_BATCH-1 frames already taken from flash are given again after reboot.
+ */
+class FrameQueue {
+  QueuedFrame ram[OFFLINE_QUEUE_SIZE / 2];
+  int ram_head, ram_count;
+
+  FILESYSTEM* _fs;
+  const char* _filename;
+  int spill_size;
+  uint16_t spill_head, spill_count;
+  uint32_t taken_seq;    // frames in flash up to this have been taken (as at last header write)
+  uint32_t spill_seq;    // newest seq written to, or taken from flash
+  uint8_t hdr_slot, unsaved_pops;
+  bool _drop_oldest;   // retention policy when full: drop oldest, or refuse newest
+
+  bool loadSpill(File& file);
+  bool saveSpillHeader(File& file);
+  bool spillOldestRAM();
+
+public:
+  FrameQueue(const char* filename, int num_spill, bool drop_oldest);
+
+  void begin(FILESYSTEM* fs);
+  bool push(uint32_t seq, const uint8_t frame[], int len);
+  uint32_t peekSeq();   // only valid if count() > 0
+  int pop(uint8_t frame[]);
+  void flush();   // move all RAM frames to flash, ie. before reboot
+  int count() const { return ram_count + spill_count; }
+  uint32_t lastSeq();   // newest seq queued (or taken, if none queued)
+};
+
+/**
+ * \brief  Messages waiting for the app, with separate retention for direct and channel messages.
+ *   Channel messages drop the oldest when full, direct messages refuse the newest when full.
+ */
+class OfflineQueue {
+  FrameQueue _direct, _channel;
+  uint32_t next_seq;
+
+public:
+  OfflineQueue() : _direct("/offq_direct", OFFLINE_SPILL_DIRECT, false), _channel("/offq_chan", OFFLINE_SPILL_CHANNEL, true), next_seq(1) { }
+
+  void begin(FILESYSTEM* fs);
+  bool add(const uint8_t frame[], int len, bool is_channel_msg);
+  int get(uint8_t frame[]);
+  void flush() { _direct.flush(); _channel.flush(); }
+  int count() const { return _direct.count() + _channel.count(); }
+};
@@ -303,6 +303,8 @@ void UITask::shutdown(bool restart){
 
   #endif // PIN_BUZZER
 
+  the_mesh.flushPendingWrites();
+
   if (restart) {
     _board->reboot();
   } else {
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string.h>
+#include <stdint.h>
+
+#ifndef ADVERT_THIN_TRACK
+  #define ADVERT_THIN_TRACK      8      // recent adverts tracked, for counting copies heard
+#endif
+#define ADVERT_THIN_MIN_PROB     32     // out of 256, ie. never thin below 1/8
+#define ADVERT_THIN_HASH_SIZE    4
+
+/**
+ * \brief  Density-adaptive thinning of flood advert rebroadcasts. With 'target' or fewer neighbours, adverts are
+ *   always rebroadcast. Above that, they are rebroadcast with probability target/density. A thinned advert is
+ *   still queued (tentatively), and only cancelled if another copy is heard before it is sent, so an edge
+ *   repeater which is the only path onwards still rebroadcasts.
+ */
+class AdvertThinning {
+  struct RecentAdvert {
+    uint8_t hash[ADVERT_THIN_HASH_SIZE];
+    uint8_t copies;
+    bool tentative;
+  };
+  RecentAdvert recent[ADVERT_THIN_TRACK];
+  int next_idx;
+  uint16_t copies_avg;   // EWMA of copies heard per advert, x16
+  uint32_t n_thinned, n_cancelled;
+
+  RecentAdvert* find(const uint8_t* hash) {
+    for (int i = 0; i < ADVERT_THIN_TRACK; i++) {
+      if (recent[i].copies > 0 && memcmp(recent[i].hash, hash, ADVERT_THIN_HASH_SIZE) == 0) return &recent[i];
+    }
+    return NULL;
+  }
+
+public:
+  AdvertThinning() {
+    memset(recent, 0, sizeof(recent));
+    next_idx = 0;
+    copies_avg = 16;
+    n_thinned = n_cancelled = 0;
+  }
+
+  /**
+   * \brief  to be called for every copy of a flood advert received, including duplicates
+   * \returns  true if this advert's rebroadcast is tentative, and should now be cancelled (as it was relayed by another)
+   */
+  bool onRecv(const uint8_t* hash) {
+    auto r = find(hash);
+    if (r == NULL) {
+      r = &recent[next_idx];
+      if (r->copies > 0) {   // fold evicted advert's count into average
+        copies_avg += ((int)r->copies * 16 - (int)copies_avg) / 8;
+      }
+      next_idx = (next_idx + 1) % ADVERT_THIN_TRACK;
+      memcpy(r->hash, hash, ADVERT_THIN_HASH_SIZE);
+      r->copies = 0;
+      r->tentative = false;
+    }
+    if (r->copies < 0xFF) r->copies++;
+    if (r->tentative && r->copies >= 2) {
+      r->tentative = false;
+      n_cancelled++;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * \returns  density estimate, ie. the larger of the active neighbour count, and average copies heard per advert
+   */
+  int getDensity(int num_neighbours) const {
+    int copies = (copies_avg + 8) / 16;
+    return num_neighbours > copies ? num_neighbours : copies;
+  }
+
+  /**
+   * \brief  decides whether the (first copy of) advert is rebroadcast for certain, or just tentatively
+   * \param  rand256  random number 0..255
+   */
+  void decide(const uint8_t* hash, int density, uint8_t target, bool first_hop, uint8_t rand256) {
+    if (target == 0 || density <= target || first_hop) return;   // always rebroadcast
+
+    int prob = (target * 256) / density;
+    if (prob < ADVERT_THIN_MIN_PROB) prob = ADVERT_THIN_MIN_PROB;
+    if (rand256 < prob) return;
+
+    auto r = find(hash);
+    if (r && r->copies < 2) {   // not already heard from another
+      r->tentative = true;
+      n_thinned++;
+    }
+  }
+
+  int getCopiesAvgX16() const { return copies_avg; }
+  uint32_t getNumThinned() const { return n_thinned; }
+  uint32_t getNumCancelled() const { return n_cancelled; }
+};
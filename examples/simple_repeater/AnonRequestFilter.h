@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Mesh.h>
+#include <helpers/ClientACL.h>
+#include "RateLimiter.h"
+
+/**
+ * \brief  The checks on an anonymous request, before Mesh does the (expensive) ECDH for it, ie. for allowAnonRequest().
+ *   Pub keys are public, so a known sender's MAC is checked first, with its stored secret (no ECDH), before charging
+ *   its bucket. Otherwise anyone could lock out an admin by sending junk requests in their name.
+ */
+class AnonRequestFilter {
+  ClientACL* _acl;
+  SenderRateLimiter* _limiter;
+
+public:
+  AnonRequestFilter(ClientACL& acl, SenderRateLimiter& limiter) : _acl(&acl), _limiter(&limiter) { }
+
+  bool allow(const mesh::Packet* packet, const uint8_t* sender_pub_key, unsigned long now) {
+    ClientInfo* client = _acl->getClient(sender_pub_key, PUB_KEY_SIZE);
+    if (client) {
+      int i = 1 + PUB_KEY_SIZE;   // dest_hash, sender pub_key, then MAC + encrypted data
+      uint8_t data[MAX_PACKET_PAYLOAD];
+      if (mesh::Utils::MACThenDecrypt(_acl->getSharedSecret(client), data, &packet->payload[i], packet->payload_len - i) <= 0) {
+        MESH_DEBUG_PRINTLN("allowAnonRequest: invalid MAC for known sender");
+        return false;
+      }
+    }
+    if (!_limiter->allow(sender_pub_key, now, client != NULL)) {
+      MESH_DEBUG_PRINTLN("allowAnonRequest: rate limited, sender=%02X%02X%02X%02X", (uint32_t)sender_pub_key[0],
+                         (uint32_t)sender_pub_key[1], (uint32_t)sender_pub_key[2], (uint32_t)sender_pub_key[3]);
+      return false;
+    }
+    return true;
+  }
+};
@@ -0,0 +1,190 @@
+#include "FloodPolicy.h"
+
+#define FLOOD_POLICY_MAGIC     0x5146434D   // "MCFQ"
+#define FLOOD_POLICY_VERSION   1
+
+struct FloodPolicyHeader {
+  uint32_t magic;
+  uint8_t  version;
+  uint8_t  num_types;
+  uint16_t reserved;
+};
+
+static File openWrite(FILESYSTEM* _fs, const char* filename) {
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    _fs->remove(filename);
+    return _fs->open(filename, FILE_O_WRITE);
+  #elif defined(RP2040_PLATFORM)
+    return _fs->open(filename, "w");
+  #else
+    return _fs->open(filename, "w", true);
+  #endif
+}
+
+static File openRead(FILESYSTEM* _fs, const char* filename) {
+  #if defined(RP2040_PLATFORM)
+    return _fs->open(filename, "r");
+  #else
+    return _fs->open(filename);
+  #endif
+}
+
+FloodPolicy::FloodPolicy() {
+  memset(sketch, 0, sizeof(sketch));
+  memset(totals, 0, sizeof(totals));
+  memset(n_dropped, 0, sizeof(n_dropped));
+  curr = 0;
+  window_start = 0;
+  seed = 0;
+  setDefaults();
+}
+
+void FloodPolicy::setDefaults() {
+  memset(quotas, 0, sizeof(quotas));
+}
+
+void FloodPolicy::begin(uint32_t hash_seed, unsigned long now_millis) {
+  seed = hash_seed;
+  window_start = now_millis;
+}
+
+bool FloodPolicy::load(FILESYSTEM* fs) {
+  if (!fs->exists(FLOOD_POLICY_FILE)) return false;
+
+  File file = openRead(fs, FLOOD_POLICY_FILE);
+  if (!file) return false;
+
+  FloodPolicyHeader hdr;
+  FloodQuota tmp[FLOOD_NUM_TYPES];
+  uint32_t crc;
+  bool success = file.read((uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr)
+        && hdr.magic == FLOOD_POLICY_MAGIC && hdr.version == FLOOD_POLICY_VERSION && hdr.num_types == FLOOD_NUM_TYPES
+        && file.read((uint8_t *)tmp, sizeof(tmp)) == sizeof(tmp)
+        && file.read((uint8_t *)&crc, sizeof(crc)) == sizeof(crc)
+        && crc == mesh::Utils::crc32((const uint8_t *)tmp, sizeof(tmp));
+  file.close();
+
+  if (success) {
+    memcpy(quotas, tmp, sizeof(quotas));
+  }
+  return success;
+}
+
+bool FloodPolicy::save(FILESYSTEM* fs) {
+  File file = openWrite(fs, FLOOD_POLICY_FILE);
+  if (!file) return false;
+
+  FloodPolicyHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = FLOOD_POLICY_MAGIC;
+  hdr.version = FLOOD_POLICY_VERSION;
+  hdr.num_types = FLOOD_NUM_TYPES;
+  uint32_t crc = mesh::Utils::crc32((const uint8_t *)quotas, sizeof(quotas));
+
+  bool success = file.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr)
+        && file.write((const uint8_t *)quotas, sizeof(quotas)) == sizeof(quotas)
+        && file.write((const uint8_t *)&crc, sizeof(crc)) == sizeof(crc);
+  file.close();
+  return success;
+}
+
+int FloodPolicy::getOriginKey(const mesh::Packet* pkt, uint8_t key[]) {
+  int len = 0;
+  uint8_t type = pkt->getPayloadType();
+  key[len++] = type;
+  if (type == PAYLOAD_TYPE_ADVERT && pkt->payload_len >= PUB_KEY_SIZE) {
+    memcpy(&key[len], pkt->payload, 8);   // pub_key prefix
+    len += 8;
+  } else if ((type == PAYLOAD_TYPE_REQ || type == PAYLOAD_TYPE_RESPONSE || type == PAYLOAD_TYPE_TXT_MSG || type == PAYLOAD_TYPE_PATH)
+              && pkt->payload_len >= 2) {
+    key[len++] = 0x01;
+    key[len++] = pkt->payload[1];   // src_hash
+  } else if (pkt->path_len > 0) {
+    key[len++] = 0x02;
+    key[len++] = pkt->path[0];   // first hop, ie. originator
+  } else {
+    key[len++] = 0x03;   // zero hop, so originator is a neighbour (unknown which), share one count per channel
+    key[len++] = pkt->payload_len > 0 ? pkt->payload[0] : 0;
+  }
+  return len;
+}
+
+void FloodPolicy::rotate(unsigned long now_millis) {
+  unsigned long elapsed = now_millis - window_start;
+  if (elapsed < FLOOD_POLICY_WINDOW) return;
+
+  if (elapsed >= 2*FLOOD_POLICY_WINDOW) {   // idle for a while, forget everything
+    memset(sketch, 0, sizeof(sketch));
+    memset(totals, 0, sizeof(totals));
+    window_start = now_millis;
+  } else {
+    curr ^= 1;   // current becomes previous, and previous is cleared to be new current
+    memset(sketch[curr], 0, sizeof(sketch[curr]));
+    memset(totals[curr], 0, sizeof(totals[curr]));
+    window_start += FLOOD_POLICY_WINDOW;
+  }
+}
+
+void FloodPolicy::getSketchIndexes(const mesh::Packet* pkt, int idx[]) const {
+  uint8_t key[12];
+  int len = getOriginKey(pkt, key);
+  uint32_t h = 2166136261u ^ seed;   // FNV-1a
+  for (int i = 0; i < len; i++) {
+    h = (h ^ key[i]) * 16777619u;
+  }
+  uint32_t h2 = (h >> 16) | 1;   // double hashing, for the row indexes
+  for (int r = 0; r < FLOOD_SKETCH_DEPTH; r++) {
+    idx[r] = (h + r*h2) & (FLOOD_SKETCH_WIDTH - 1);
+  }
+}
+
+bool FloodPolicy::check(const mesh::Packet* pkt, unsigned long now_millis) {
+  uint8_t type = pkt->getPayloadType();
+  const FloodQuota& q = quotas[type];
+  if (q.per_origin == 0 && q.total == 0) return true;   // no quota for this type
+
+  rotate(now_millis);
+  // sliding window, previous counts fade out (weight is in 1/1024ths)
+  uint32_t prev_weight = (FLOOD_POLICY_WINDOW - (now_millis - window_start)) / (FLOOD_POLICY_WINDOW / 1024);
+  uint8_t prev = curr ^ 1;
+
+  if (q.total && totals[curr][type] + ((totals[prev][type] * prev_weight) >> 10) >= q.total) {
+    n_dropped[type]++;
+    return false;
+  }
+
+  if (q.per_origin) {
+    int idx[FLOOD_SKETCH_DEPTH];
+    getSketchIndexes(pkt, idx);
+    uint32_t est = 0xFFFFFFFF;
+    for (int r = 0; r < FLOOD_SKETCH_DEPTH; r++) {
+      uint32_t n = sketch[curr][r][idx[r]] + ((sketch[prev][r][idx[r]] * prev_weight) >> 10);
+      if (n < est) est = n;
+    }
+    if (est >= q.per_origin) {
+      n_dropped[type]++;
+      return false;
+    }
+  }
+  return true;
+}
+
+void FloodPolicy::commit(const mesh::Packet* pkt, unsigned long now_millis) {
+  uint8_t type = pkt->getPayloadType();
+  const FloodQuota& q = quotas[type];
+  if (q.per_origin == 0 && q.total == 0) return;   // not counted, as check() wasn't either
+
+  rotate(now_millis);
+  if (q.per_origin) {
+    int idx[FLOOD_SKETCH_DEPTH];
+    getSketchIndexes(pkt, idx);
+    uint8_t min_curr = 0xFF;
+    for (int r = 0; r < FLOOD_SKETCH_DEPTH; r++) {
+      if (sketch[curr][r][idx[r]] < min_curr) min_curr = sketch[curr][r][idx[r]];
+    }
+    for (int r = 0; r < FLOOD_SKETCH_DEPTH; r++) {   // conservative update, only raise the minimum counters
+      if (sketch[curr][r][idx[r]] == min_curr && min_curr < 0xFF) sketch[curr][r][idx[r]]++;
+    }
+  }
+  if (totals[curr][type] < 0xFFFF) totals[curr][type]++;
+}
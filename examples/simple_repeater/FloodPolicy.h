@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Mesh.h>
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+
+#ifndef FLOOD_SKETCH_WIDTH
+  #define FLOOD_SKETCH_WIDTH   256     // counters per row, must be power of 2
+#endif
+#define FLOOD_SKETCH_DEPTH     3       // rows, ie. independent hashes
+#define FLOOD_POLICY_WINDOW    (60*60*1000)   // quotas are per sliding hour
+
+#define FLOOD_POLICY_FILE      "/flood_quotas"
+#define FLOOD_NUM_TYPES        16
+
+struct FloodQuota {   // packets per hour, zero = unlimited
+  uint16_t per_origin;
+  uint16_t total;
+};
+
+/**
+ * \brief  Forwarding quotas for flood packets, per payload type and per originator. Originators are counted in
+ *   a count-min sketch, so memory is fixed no matter how many are seen (a collision can only over-count, so an
+ *   originator may be throttled early, but never late). Counts are over a sliding hour, estimated from the
+ *   current and previous hour's sketches.
+ */
+class FloodPolicy {
+  FloodQuota quotas[FLOOD_NUM_TYPES];
+  uint8_t sketch[2][FLOOD_SKETCH_DEPTH][FLOOD_SKETCH_WIDTH];   // current and previous window (saturating counts)
+  uint16_t totals[2][FLOOD_NUM_TYPES];
+  uint8_t curr;
+  unsigned long window_start;
+  uint32_t seed;
+  uint32_t n_dropped[FLOOD_NUM_TYPES];
+
+  static int getOriginKey(const mesh::Packet* pkt, uint8_t key[]);
+  void rotate(unsigned long now_millis);
+  void getSketchIndexes(const mesh::Packet* pkt, int idx[]) const;
+
+public:
+  FloodPolicy();
+
+  void setDefaults();
+  void begin(uint32_t hash_seed, unsigned long now_millis);   // seed is random, so collisions can't be engineered
+  bool load(FILESYSTEM* fs);
+  bool save(FILESYSTEM* fs);
+
+  /**
+   * \returns  false if originator, or payload type, has used up its quota (packet is then counted as dropped).
+   *   Does not count the packet, call commit() once it is certain to be forwarded.
+   */
+  bool check(const mesh::Packet* pkt, unsigned long now_millis);
+
+  /**
+   * \brief  Counts a packet against its quotas. Only for packets which passed check() and every other forwarding check.
+   */
+  void commit(const mesh::Packet* pkt, unsigned long now_millis);
+
+  FloodQuota& getQuota(uint8_t payload_type) { return quotas[payload_type & (FLOOD_NUM_TYPES - 1)]; }
+  uint32_t getNumDropped(uint8_t payload_type) const { return n_dropped[payload_type & (FLOOD_NUM_TYPES - 1)]; }
+};
@@ -49,6 +49,10 @@
 #define REQ_TYPE_GET_ACCESS_LIST    0x05
 #define REQ_TYPE_GET_NEIGHBOURS     0x06
 #define REQ_TYPE_GET_OWNER_INFO     0x07     // FIRMWARE_VER_LEVEL >= 2
+#define REQ_TYPE_GET_NEIGHBOUR_STATS 0x08
+
+#define NEIGHBOUR_STATS_REC_SIZE    24
+#define NEIGHBOUR_STATS_MAX_RECS     6    // per page, so reply (9 + 6*24 = 153) fits an encrypted RESPONSE
 
 #define RESP_SERVER_LOGIN_OK        0 // response to ANON_REQ
 
@@ -60,30 +64,45 @@
 
 #define LAZY_CONTACTS_WRITE_DELAY    5000
 
-void MyMesh::putNeighbour(const mesh::Identity &id, uint32_t timestamp, float snr) {
-#if MAX_NEIGHBOURS // check if neighbours enabled
-  // find existing neighbour, else use least recently updated
-  uint32_t oldest_timestamp = 0xFFFFFFFF;
-  NeighbourInfo *neighbour = &neighbours[0];
-  for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-    // if neighbour already known, we should update it
-    if (id.matches(neighbours[i].id)) {
-      neighbour = &neighbours[i];
-      break;
-    }
+#define ACTIVE_NEIGHBOUR_SECS        (12*60*60)   // same as default flood advert interval
 
-    // otherwise we should update the least recently updated neighbour
-    if (neighbours[i].heard_timestamp < oldest_timestamp) {
-      neighbour = &neighbours[i];
-      oldest_timestamp = neighbour->heard_timestamp;
-    }
+static const char* payload_type_names[] = { "req", "resp", "txt", "ack", "advert", "grp.txt", "grp.data", "anon",
+                                            "path", "trace", "multi", "ctrl", "0c", "0d", "0e", "raw" };
+
+static int findPayloadType(const char* name) {
+  for (int t = 0; t < FLOOD_NUM_TYPES; t++) {
+    if (strcmp(name, payload_type_names[t]) == 0) return t;
   }
+  return -1;
+}
+
+void MyMesh::putNeighbour(const mesh::Identity &id, uint32_t timestamp, float snr, int32_t gps_lat, int32_t gps_lon) {
+#if MAX_NEIGHBOURS // check if neighbours enabled
+  // find existing neighbour, else use least recently updated
+  int idx = neighbours.put(id);
 
   // update neighbour info
-  neighbour->id = id;
+  auto neighbour = neighbours.getByIdx(idx);
   neighbour->advert_timestamp = timestamp;
   neighbour->heard_timestamp = getRTCClock()->getCurrentTime();
   neighbour->snr = (int8_t)(snr * 4);
+  neighbour->gps_lat = gps_lat;
+  neighbour->gps_lon = gps_lon;
+  neighbour_geo.put(idx, gps_lat, gps_lon, 0);
+#endif
+}
+
+void MyMesh::updateNeighbourStats(const mesh::Packet* pkt, int len) {
+#if MAX_NEIGHBOURS
+  int idx = -1;
+  if (pkt->isRouteFlood() && pkt->path_len > 0) {
+    idx = neighbours.findByHash(pkt->path[pkt->path_len - 1]);   // last hop
+  } else if (pkt->path_len == 0 && pkt->getPayloadType() == PAYLOAD_TYPE_ADVERT && pkt->payload_len >= PUB_KEY_SIZE) {
+    idx = neighbours.find(pkt->payload, PUB_KEY_SIZE);   // zero hop advert
+  }
+  if (idx >= 0) {
+    neighbours.onRecv(idx, pkt->getPayloadType(), len, pkt->getSNR(), getRTCClock()->getCurrentTime());
+  }
 #endif
 }
 
@@ -121,7 +140,7 @@ uint8_t MyMesh::handleLoginReq(const mesh::Identity& sender, const uint8_t* secr
     client->last_activity = getRTCClock()->getCurrentTime();
     client->permissions &= ~0x03;
     client->permissions |= perms;
-    memcpy(client->shared_secret, secret, PUB_KEY_SIZE);
+    acl.setSharedSecret(client, secret);
 
     if (perms != PERM_ACL_GUEST) {   // keep number of FS writes to a minimum
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
@@ -145,61 +164,52 @@ uint8_t MyMesh::handleLoginReq(const mesh::Identity& sender, const uint8_t* secr
 }
 
 uint8_t MyMesh::handleAnonRegionsReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data) {
-  if (anon_limiter.allow(rtc_clock.getCurrentTime())) {
-    // request data has: {reply-path-len}{reply-path}
-    reply_path_len = *data++ & 0x3F;
-    memcpy(reply_path, data, reply_path_len);
-    // data += reply_path_len;
+  // request data has: {reply-path-len}{reply-path}
+  reply_path_len = *data++ & 0x3F;
+  memcpy(reply_path, data, reply_path_len);
+  // data += reply_path_len;
 
-    memcpy(reply_data, &sender_timestamp, 4);   // prefix with sender_timestamp, like a tag
-    uint32_t now = getRTCClock()->getCurrentTime();
-    memcpy(&reply_data[4], &now, 4);     // include our clock (for easy clock sync, and packet hash uniqueness)
+  memcpy(reply_data, &sender_timestamp, 4);   // prefix with sender_timestamp, like a tag
+  uint32_t now = getRTCClock()->getCurrentTime();
+  memcpy(&reply_data[4], &now, 4);     // include our clock (for easy clock sync, and packet hash uniqueness)
 
-    return 8 + region_map.exportNamesTo((char *) &reply_data[8], sizeof(reply_data) - 12, REGION_DENY_FLOOD);   // reply length
-  }
-  return 0;
+  return 8 + region_map.exportNamesTo((char *) &reply_data[8], sizeof(reply_data) - 12, REGION_DENY_FLOOD);   // reply length
 }
 
 uint8_t MyMesh::handleAnonOwnerReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data) {
-  if (anon_limiter.allow(rtc_clock.getCurrentTime())) {
-    // request data has: {reply-path-len}{reply-path}
-    reply_path_len = *data++ & 0x3F;
-    memcpy(reply_path, data, reply_path_len);
-    // data += reply_path_len;
+  // request data has: {reply-path-len}{reply-path}
+  reply_path_len = *data++ & 0x3F;
+  memcpy(reply_path, data, reply_path_len);
+  // data += reply_path_len;
 
-    memcpy(reply_data, &sender_timestamp, 4);   // prefix with sender_timestamp, like a tag
-    uint32_t now = getRTCClock()->getCurrentTime();
-    memcpy(&reply_data[4], &now, 4);     // include our clock (for easy clock sync, and packet hash uniqueness)
-    sprintf((char *) &reply_data[8], "%s\n%s", _prefs.node_name, _prefs.owner_info);
+  memcpy(reply_data, &sender_timestamp, 4);   // prefix with sender_timestamp, like a tag
+  uint32_t now = getRTCClock()->getCurrentTime();
+  memcpy(&reply_data[4], &now, 4);     // include our clock (for easy clock sync, and packet hash uniqueness)
+  sprintf((char *) &reply_data[8], "%s\n%s", _prefs.node_name, _prefs.owner_info);
 
-    return 8 + strlen((char *) &reply_data[8]);   // reply length
-  }
-  return 0;
+  return 8 + strlen((char *) &reply_data[8]);   // reply length
 }
 
 uint8_t MyMesh::handleAnonClockReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data) {
-  if (anon_limiter.allow(rtc_clock.getCurrentTime())) {
-    // request data has: {reply-path-len}{reply-path}
-    reply_path_len = *data++ & 0x3F;
-    memcpy(reply_path, data, reply_path_len);
-    // data += reply_path_len;
+  // request data has: {reply-path-len}{reply-path}
+  reply_path_len = *data++ & 0x3F;
+  memcpy(reply_path, data, reply_path_len);
+  // data += reply_path_len;
 
-    memcpy(reply_data, &sender_timestamp, 4);   // prefix with sender_timestamp, like a tag
-    uint32_t now = getRTCClock()->getCurrentTime();
-    memcpy(&reply_data[4], &now, 4);     // include our clock (for easy clock sync, and packet hash uniqueness)
-    reply_data[8] = 0;  // features
+  memcpy(reply_data, &sender_timestamp, 4);   // prefix with sender_timestamp, like a tag
+  uint32_t now = getRTCClock()->getCurrentTime();
+  memcpy(&reply_data[4], &now, 4);     // include our clock (for easy clock sync, and packet hash uniqueness)
+  reply_data[8] = 0;  // features
 #ifdef WITH_RS232_BRIDGE
-    reply_data[8] |= 0x01;  // is bridge, type UART
+  reply_data[8] |= 0x01;  // is bridge, type UART
 #elif WITH_ESPNOW_BRIDGE
-    reply_data[8] |= 0x03;  // is bridge, type ESP-NOW
+  reply_data[8] |= 0x03;  // is bridge, type ESP-NOW
 #endif
-    if (_prefs.disable_fwd) {   // is this repeater currently disabled
-      reply_data[8] |= 0x80;  // is disabled
-    }
-    // TODO:  add some kind of moving-window utilisation metric, so can query 'how busy' is this repeater
-    return 9;   // reply length
+  if (_prefs.disable_fwd) {   // is this repeater currently disabled
+    reply_data[8] |= 0x80;  // is disabled
   }
-  return 0;
+  // TODO:  add some kind of moving-window utilisation metric, so can query 'how busy' is this repeater
+  return 9;   // reply length
 }
 
 int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t *payload, size_t payload_len) {
@@ -212,9 +222,12 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
     stats.batt_milli_volts = board.getBattMilliVolts();
     stats.curr_tx_queue_len = _mgr->getOutboundCount(0xFFFFFFFF);
     stats.noise_floor = (int16_t)_radio->getNoiseFloor();
-    stats.last_rssi = (int16_t)radio_driver.getLastRSSI();
+    stats.last_rssi = (int16_t)_radio->getLastRSSI();
+    _radio->lock();   // driver counters may be updated by the radio task
     stats.n_packets_recv = radio_driver.getPacketsRecv();
     stats.n_packets_sent = radio_driver.getPacketsSent();
+    stats.n_recv_errors = radio_driver.getPacketsRecvErrors();
+    _radio->unlock();
     stats.total_air_time_secs = getTotalAirTime() / 1000;
     stats.total_up_time_secs = uptime_millis / 1000;
     stats.n_sent_flood = getNumSentFlood();
@@ -222,11 +235,10 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
     stats.n_recv_flood = getNumRecvFlood();
     stats.n_recv_direct = getNumRecvDirect();
     stats.err_events = _err_flags;
-    stats.last_snr = (int16_t)(radio_driver.getLastSNR() * 4);
+    stats.last_snr = (int16_t)(_radio->getLastSNR() * 4);
     stats.n_direct_dups = ((SimpleMeshTables *)getTables())->getNumDirectDups();
     stats.n_flood_dups = ((SimpleMeshTables *)getTables())->getNumFloodDups();
     stats.total_rx_air_time_secs = getReceiveAirTime() / 1000;
-    stats.n_recv_errors = radio_driver.getPacketsRecvErrors();
     memcpy(&reply_data[4], &stats, sizeof(stats));
 
     return 4 + sizeof(stats); //  reply_len
@@ -294,9 +306,8 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
       int16_t neighbours_count = 0;
       NeighbourInfo* sorted_neighbours[MAX_NEIGHBOURS];
       for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-        auto neighbour = &neighbours[i];
-        if (neighbour->heard_timestamp > 0) {
-          sorted_neighbours[neighbours_count] = neighbour;
+        if (neighbours.isUsed(i)) {
+          sorted_neighbours[neighbours_count] = neighbours.getByIdx(i);
           neighbours_count++;
         }
       }
@@ -359,6 +370,62 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
 
       return reply_offset;
     }
+  } else if (payload[0] == REQ_TYPE_GET_NEIGHBOUR_STATS && sender->isAdmin() && payload_len >= 2) {
+#if MAX_NEIGHBOURS
+    uint32_t now = getRTCClock()->getCurrentTime();
+    int ofs = 4;
+    if (payload[1] == 0 && payload_len >= 4) {   // page of table, from slot index 'start'
+      uint16_t start;
+      memcpy(&start, &payload[2], 2);
+
+      uint16_t total = 0;
+      for (int i = 0; i < MAX_NEIGHBOURS; i++) {
+        if (neighbours.isUsed(i)) total++;
+      }
+      memcpy(&reply_data[ofs], &total, 2); ofs += 2;
+      int next_ofs = ofs; ofs += 2;     // fill in below
+      int count_ofs = ofs++;
+
+      uint8_t count = 0;
+      int i = start;
+      for (; i < MAX_NEIGHBOURS && count < NEIGHBOUR_STATS_MAX_RECS; i++) {
+        if (!neighbours.isUsed(i)) continue;
+
+        auto n = neighbours.getByIdx(i);
+        uint32_t secs_ago = now - n->heard_timestamp;
+        uint16_t types = 0;
+        for (int t = 0; t < NEIGHBOUR_NUM_TYPES; t++) {
+          if (n->type_heard[t]) types |= (1 << t);
+        }
+        memcpy(&reply_data[ofs], n->id.pub_key, 6); ofs += 6;
+        memcpy(&reply_data[ofs], &secs_ago, 4); ofs += 4;
+        memcpy(&reply_data[ofs], &n->n_rx_pkts, 4); ofs += 4;
+        memcpy(&reply_data[ofs], &n->n_rx_bytes, 4); ofs += 4;
+        reply_data[ofs++] = n->snr;
+        reply_data[ofs++] = (int8_t) (n->snr_avg / 16);
+        reply_data[ofs++] = n->snr_min;
+        reply_data[ofs++] = n->snr_max;
+        memcpy(&reply_data[ofs], &types, 2); ofs += 2;
+        count++;
+      }
+      uint16_t next = i < MAX_NEIGHBOURS ? i : 0xFFFF;   // where to continue, or 0xFFFF if at end
+      memcpy(&reply_data[next_ofs], &next, 2);
+      reply_data[count_ofs] = count;
+      return ofs;
+    }
+    if (payload[1] == 1 && payload_len >= 8) {   // detail for one neighbour, by 6 byte pub_key prefix
+      int i = neighbours.find(&payload[2], 6);
+      if (i >= 0) {
+        auto n = neighbours.getByIdx(i);
+        memcpy(&reply_data[ofs], n->id.pub_key, 6); ofs += 6;
+        for (int t = 0; t < NEIGHBOUR_NUM_TYPES; t++) {
+          uint32_t secs_ago = n->type_heard[t] ? now - n->type_heard[t] : 0xFFFFFFFF;
+          memcpy(&reply_data[ofs], &secs_ago, 4); ofs += 4;
+        }
+        return ofs;
+      }
+    }
+#endif
   } else if (payload[0] == REQ_TYPE_GET_OWNER_INFO) {
     sprintf((char *) &reply_data[4], "%s\n%s\n%s", FIRMWARE_VERSION, _prefs.node_name, _prefs.owner_info);
     return 4 + strlen((char *) &reply_data[4]);
@@ -373,14 +440,42 @@ mesh::Packet *MyMesh::createSelfAdvert() {
   return createAdvert(self_id, app_data, app_data_len);
 }
 
-File MyMesh::openAppend(const char *fname) {
-#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
-  return _fs->open(fname, FILE_O_WRITE);
-#elif defined(RP2040_PLATFORM)
-  return _fs->open(fname, "a");
-#else
-  return _fs->open(fname, "a", true);
+void MyMesh::pushStats() {
+  StatsSnapshot s;
+  s.uptime_secs = uptime_millis / 1000;
+  s.batt_milli_volts = board.getBattMilliVolts();
+  s.err_flags = _err_flags;
+  s.queue_len = _mgr->getOutboundCount(0xFFFFFFFF);
+  s.noise_floor = (int16_t)_radio->getNoiseFloor();
+  s.last_rssi = (int8_t)_radio->getLastRSSI();
+  s.last_snr = (int8_t)(_radio->getLastSNR() * 4);
+  _radio->lock();   // driver counters may be updated by the radio task
+  s.n_packets_recv = radio_driver.getPacketsRecv();
+  s.n_packets_sent = radio_driver.getPacketsSent();
+  s.n_recv_errors = radio_driver.getPacketsRecvErrors();
+  _radio->unlock();
+  s.n_sent_flood = getNumSentFlood();
+  s.n_sent_direct = getNumSentDirect();
+  s.n_recv_flood = getNumRecvFlood();
+  s.n_recv_direct = getNumRecvDirect();
+  s.n_flood_dups = ((SimpleMeshTables *)getTables())->getNumFloodDups();
+  s.n_direct_dups = ((SimpleMeshTables *)getTables())->getNumDirectDups();
+  s.tx_air_millis = getTotalAirTime();
+  s.rx_air_millis = getReceiveAirTime();
+
+  uint8_t frame[STATS_PUSH_MAX_FRAME];
+  int len = stats_push.writeFrame(s, self_id.pub_key, frame);
+
+#ifdef WITH_BRIDGE
+  if (_prefs.stats_push_dest == STATS_PUSH_DEST_BRIDGE) {
+    bridge.sendStats(frame, len);
+    return;
+  }
 #endif
+  char hex[STATS_PUSH_MAX_FRAME*2 + 1];
+  mesh::Utils::toHex(hex, frame, len);
+  Serial.print("STATS: ");
+  Serial.println(hex);
 }
 
 bool MyMesh::allowPacketForward(const mesh::Packet *packet) {
@@ -390,9 +485,58 @@ bool MyMesh::allowPacketForward(const mesh::Packet *packet) {
     MESH_DEBUG_PRINTLN("allowPacketForward: unknown transport code, or wildcard not allowed for FLOOD packet");
     return false;
   }
+  if (packet->isRouteFlood() && !flood_policy.check(packet, _ms->getMillis())) {
+    MESH_DEBUG_PRINTLN("allowPacketForward: flood quota exceeded for type %d", (uint32_t)packet->getPayloadType());
+    return false;
+  }
+  if (packet->isRouteFlood()) {
+    uint32_t airtime = _radio->getEstAirtimeFor(packet->getRawLength() + PATH_HASH_SIZE);
+    if (!region_map.allowForward(recv_pkt_region, airtime, _ms->getMillis())) {
+      MESH_DEBUG_PRINTLN("allowPacketForward: quota exceeded for region %s", recv_pkt_region->name);
+      return false;
+    }
+    // past every check, so will be forwarded (only count it against quotas now)
+    flood_policy.commit(packet, _ms->getMillis());
+
+    if (packet->getPayloadType() == PAYLOAD_TYPE_ADVERT && _prefs.advert_thin_target > 0) {
+      uint8_t hash[MAX_HASH_SIZE];
+      packet->calculatePacketHash(hash);
+      int density = advert_thin.getDensity(countActiveNeighbours());
+      advert_thin.decide(hash, density, _prefs.advert_thin_target, packet->path_len == 0, getRNG()->nextInt(0, 256));
+    }
+  }
   return true;
 }
 
+int MyMesh::countActiveNeighbours() {
+  int n = 0;
+#if MAX_NEIGHBOURS
+  uint32_t since = getRTCClock()->getCurrentTime() - ACTIVE_NEIGHBOUR_SECS;
+  for (int i = 0; i < MAX_NEIGHBOURS; i++) {
+    if (neighbours.isUsed(i) && neighbours.getByIdx(i)->heard_timestamp > since) n++;
+  }
+#endif
+  return n;
+}
+
+void MyMesh::cancelRetransmit(const uint8_t* pkt_hash) {
+  uint8_t hash[MAX_HASH_SIZE];
+  int n = _mgr->getOutboundCount(0xFFFFFFFF);
+  for (int i = 0; i < n; i++) {
+    auto pkt = _mgr->getOutboundByIdx(i);
+    pkt->calculatePacketHash(hash);
+    if (memcmp(hash, pkt_hash, ADVERT_THIN_HASH_SIZE) == 0) {
+      MESH_DEBUG_PRINTLN("cancelRetransmit: advert relayed by another, cancelling");
+      _mgr->free(_mgr->removeOutboundByIdx(i));
+      break;
+    }
+  }
+}
+
+bool MyMesh::allowAnonRequest(const mesh::Packet* packet, const uint8_t* sender_pub_key) {
+  return anon_filter.allow(packet, sender_pub_key, _ms->getMillis());
+}
+
 const char *MyMesh::getLogDateTime() {
   static char tmp[32];
   uint32_t now = getRTCClock()->getCurrentTime();
@@ -412,6 +556,14 @@ void MyMesh::logRxRaw(float snr, float rssi, const uint8_t raw[], int len) {
 }
 
 void MyMesh::logRx(mesh::Packet *pkt, int len, float score) {
+  updateNeighbourStats(pkt, len);
+
+  if (pkt->isRouteFlood() && pkt->getPayloadType() == PAYLOAD_TYPE_ADVERT) {
+    uint8_t hash[MAX_HASH_SIZE];
+    pkt->calculatePacketHash(hash);
+    if (advert_thin.onRecv(hash)) cancelRetransmit(hash);
+  }
+
 #ifdef WITH_BRIDGE
   if (_prefs.bridge_pkt_src == 1) {
     bridge.sendPacket(pkt);
@@ -419,21 +571,8 @@ void MyMesh::logRx(mesh::Packet *pkt, int len, float score) {
 #endif
 
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": RX, len=%d (type=%d, route=%s, payload_len=%d) SNR=%d RSSI=%d score=%d", len,
-               pkt->getPayloadType(), pkt->isRouteDirect() ? "D" : "F", pkt->payload_len,
-               (int)_radio->getLastSNR(), (int)_radio->getLastRSSI(), (int)(score * 1000));
-
-      if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH || pkt->getPayloadType() == PAYLOAD_TYPE_REQ ||
-          pkt->getPayloadType() == PAYLOAD_TYPE_RESPONSE || pkt->getPayloadType() == PAYLOAD_TYPE_TXT_MSG) {
-        f.printf(" [%02X -> %02X]\n", (uint32_t)pkt->payload[1], (uint32_t)pkt->payload[0]);
-      } else {
-        f.printf("\n");
-      }
-      f.close();
-    }
+    pkt_log.add(PKT_LOG_RX, pkt, len, _radio->getLastSNR(), _radio->getLastRSSI(), score, getRTCClock()->getCurrentTime());
+    if (pkt_log_flush_at == 0) pkt_log_flush_at = futureMillis(PACKET_LOG_FLUSH_DELAY);
   }
 }
 
@@ -445,32 +584,15 @@ void MyMesh::logTx(mesh::Packet *pkt, int len) {
 #endif
 
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": TX, len=%d (type=%d, route=%s, payload_len=%d)", len, pkt->getPayloadType(),
-               pkt->isRouteDirect() ? "D" : "F", pkt->payload_len);
-
-      if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH || pkt->getPayloadType() == PAYLOAD_TYPE_REQ ||
-          pkt->getPayloadType() == PAYLOAD_TYPE_RESPONSE || pkt->getPayloadType() == PAYLOAD_TYPE_TXT_MSG) {
-        f.printf(" [%02X -> %02X]\n", (uint32_t)pkt->payload[1], (uint32_t)pkt->payload[0]);
-      } else {
-        f.printf("\n");
-      }
-      f.close();
-    }
+    pkt_log.add(PKT_LOG_TX, pkt, len, 0, 0, 0, getRTCClock()->getCurrentTime());
+    if (pkt_log_flush_at == 0) pkt_log_flush_at = futureMillis(PACKET_LOG_FLUSH_DELAY);
   }
 }
 
 void MyMesh::logTxFail(mesh::Packet *pkt, int len) {
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": TX FAIL!, len=%d (type=%d, route=%s, payload_len=%d)\n", len, pkt->getPayloadType(),
-               pkt->isRouteDirect() ? "D" : "F", pkt->payload_len);
-      f.close();
-    }
+    pkt_log.add(PKT_LOG_TX_FAIL, pkt, len, 0, 0, 0, getRTCClock()->getCurrentTime());
+    if (pkt_log_flush_at == 0) pkt_log_flush_at = futureMillis(PACKET_LOG_FLUSH_DELAY);
   }
 }
 
@@ -559,7 +681,7 @@ void MyMesh::getPeerSharedSecret(uint8_t *dest_secret, int peer_idx) {
   int i = matching_peer_indexes[peer_idx];
   if (i >= 0 && i < acl.getNumClients()) {
     // lookup pre-calculated shared_secret
-    memcpy(dest_secret, acl.getClientByIdx(i)->shared_secret, PUB_KEY_SIZE);
+    memcpy(dest_secret, acl.getSharedSecret(acl.getClientByIdx(i)), PUB_KEY_SIZE);
   } else {
     MESH_DEBUG_PRINTLN("getPeerSharedSecret: Invalid peer idx: %d", i);
   }
@@ -580,7 +702,7 @@ void MyMesh::onAdvertRecv(mesh::Packet *packet, const mesh::Identity &id, uint32
   if (packet->path_len == 0 && !isShare(packet)) {
     AdvertDataParser parser(app_data, app_data_len);
     if (parser.isValid() && parser.getType() == ADV_TYPE_REPEATER) { // just keep neigbouring Repeaters
-      putNeighbour(id, timestamp, packet->getSNR());
+      putNeighbour(id, timestamp, packet->getSNR(), parser.getIntLat(), parser.getIntLon());
     }
   }
 }
@@ -746,7 +868,8 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
     : mesh::Mesh(radio, ms, rng, rtc, *new StaticPoolPacketManager(32), tables),
       _cli(board, rtc, sensors, acl, &_prefs, this), telemetry(MAX_PACKET_PAYLOAD - 4), region_map(key_store), temp_map(key_store),
       discover_limiter(4, 120),  // max 4 every 2 minutes
-      anon_limiter(4, 180)   // max 4 every 3 minutes
+      anon_limiter(30, 3, 15, 4),  // per sender: 3 then one per 30 secs, all unknown senders: 4 then one per 15 secs
+      anon_filter(acl, anon_limiter)
 #if defined(WITH_RS232_BRIDGE)
       , bridge(&_prefs, WITH_RS232_BRIDGE, _mgr, &rtc)
 #endif
@@ -760,12 +883,10 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   dirty_contacts_expiry = 0;
   set_radio_at = revert_radio_at = 0;
   _logging = false;
+  pkt_log_flush_at = 0;
+  next_stats_push = 0;
   region_load_active = false;
 
-#if MAX_NEIGHBOURS
-  memset(neighbours, 0, sizeof(neighbours));
-#endif
-
   // defaults
   memset(&_prefs, 0, sizeof(_prefs));
   _prefs.airtime_factor = 1.0;   // one half
@@ -806,11 +927,17 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
 void MyMesh::begin(FILESYSTEM *fs) {
   mesh::Mesh::begin();
   _fs = fs;
+  pkt_log.begin(fs);
   // load persisted prefs
   _cli.loadPrefs(_fs);
   acl.load(_fs, self_id);
   _prefs.powersaving_enabled = 1;
   // TODO: key_store.begin();
+  flood_policy.load(_fs);
+  uint32_t seed;
+  getRNG()->random((uint8_t *)&seed, sizeof(seed));
+  flood_policy.begin(seed, _ms->getMillis());
+
   bool regions_loaded = region_map.load(_fs);
   if(regions_loaded == false) {
     //set defaults
@@ -826,8 +953,10 @@ void MyMesh::begin(FILESYSTEM *fs) {
   }
 #endif
 
+  _radio->lock();
   radio_set_params(_prefs.freq, _prefs.bw, _prefs.sf, _prefs.cr);
   radio_set_tx_power(_prefs.tx_power_dbm);
+  _radio->unlock();
 
   updateAdvertTimer();
   updateFloodAdvertTimer();
@@ -892,23 +1021,13 @@ void MyMesh::updateFloodAdvertTimer() {
 }
 
 void MyMesh::dumpLogFile() {
-#if defined(RP2040_PLATFORM)
-  File f = _fs->open(PACKET_LOG_FILE, "r");
-#else
-  File f = _fs->open(PACKET_LOG_FILE);
-#endif
-  if (f) {
-    while (f.available()) {
-      int c = f.read();
-      if (c < 0) break;
-      Serial.print((char)c);
-    }
-    f.close();
-  }
+  pkt_log.dump(Serial);   // decode with: bin/packet_log/decode.py
 }
 
 void MyMesh::setTxPower(int8_t power_dbm) {
+  _radio->lock();
   radio_set_tx_power(power_dbm);
+  _radio->unlock();
 }
 
 void MyMesh::formatNeighborsReply(char *reply) {
@@ -919,9 +1038,8 @@ void MyMesh::formatNeighborsReply(char *reply) {
   int16_t neighbours_count = 0;
   NeighbourInfo* sorted_neighbours[MAX_NEIGHBOURS];
   for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-    auto neighbour = &neighbours[i];
-    if (neighbour->heard_timestamp > 0) {
-      sorted_neighbours[neighbours_count] = neighbour;
+    if (neighbours.isUsed(i)) {
+      sorted_neighbours[neighbours_count] = neighbours.getByIdx(i);
       neighbours_count++;
     }
   }
@@ -955,12 +1073,51 @@ void MyMesh::formatNeighborsReply(char *reply) {
   *dp = 0; // null terminator
 }
 
+void MyMesh::formatNearestNeighborsReply(char *reply, int max_results, uint32_t max_dist) {
+  char *dp = reply;
+
+#if MAX_NEIGHBOURS
+  int32_t lat = (int32_t)(_prefs.node_lat * 1000000.0);
+  int32_t lon = (int32_t)(_prefs.node_lon * 1000000.0);
+  if (lat == 0 && lon == 0) {
+    strcpy(reply, "Err - no location set");
+    return;
+  }
+
+  int results[MAX_NEIGHBOURS];
+  uint32_t dists[MAX_NEIGHBOURS];
+  if (max_results > MAX_NEIGHBOURS) max_results = MAX_NEIGHBOURS;
+  int n = neighbour_geo.findNearest(lat, lon, 0, max_dist, results, dists, max_results);
+
+  for (int i = 0; i < n && dp - reply < 134; i++) {
+    NeighbourInfo *neighbour = neighbours.getByIdx(results[i]);
+
+    // add new line if not first item
+    if (i > 0) *dp++ = '\n';
+
+    char hex[10];
+    // get 4 bytes of neighbour id as hex
+    mesh::Utils::toHex(hex, neighbour->id.pub_key, 4);
+
+    sprintf(dp, "%s:%u:%d", hex, (unsigned int) dists[i], neighbour->snr);
+    while (*dp)
+      dp++; // find end of string
+  }
+#endif
+  if (dp == reply) { // no neighbours, need empty response
+    strcpy(dp, "-none-");
+    dp += 6;
+  }
+  *dp = 0; // null terminator
+}
+
 void MyMesh::removeNeighbor(const uint8_t *pubkey, int key_len) {
 #if MAX_NEIGHBOURS
   for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-    NeighbourInfo *neighbour = &neighbours[i];
+    NeighbourInfo *neighbour = neighbours.getByIdx(i);
     if (memcmp(neighbour->id.pub_key, pubkey, key_len) == 0) {
-      neighbours[i] = NeighbourInfo(); // clear neighbour entry
+      neighbours.remove(i); // clear neighbour entry
+      neighbour_geo.remove(i);
     }
   }
 #endif
@@ -971,12 +1128,14 @@ void MyMesh::formatStatsReply(char *reply) {
 }
 
 void MyMesh::formatRadioStatsReply(char *reply) {
-  StatsFormatHelper::formatRadioStats(reply, _radio, radio_driver, getTotalAirTime(), getReceiveAirTime());
+  StatsFormatHelper::formatRadioStats(reply, _radio, *_radio, getTotalAirTime(), getReceiveAirTime());
 }
 
 void MyMesh::formatPacketStatsReply(char *reply) {
+  _radio->lock();
   StatsFormatHelper::formatPacketStats(reply, radio_driver, getNumSentFlood(), getNumSentDirect(), 
                                        getNumRecvFlood(), getNumRecvDirect());
+  _radio->unlock();
 }
 
 void MyMesh::saveIdentity(const mesh::LocalIdentity &new_id) {
@@ -993,7 +1152,9 @@ void MyMesh::saveIdentity(const mesh::LocalIdentity &new_id) {
 }
 
 void MyMesh::clearStats() {
+  _radio->lock();
   radio_driver.resetStats();
+  _radio->unlock();
   resetStats();
   ((SimpleMeshTables *)getTables())->resetStats();
 }
@@ -1023,6 +1184,7 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
           auto nw = temp_map.putRegion(np, parent->id, old ? old->id : 0);  // carry-over the current ID (if name already exists)
           if (nw) {
             nw->flags = old ? old->flags : (*ep == 'F' ? 0 : REGION_DENY_FLOOD);   // carry-over flags from curr
+            if (old) nw->policy = old->policy;
 
             load_stack[indent] = nw;  // keep pointers to parent regions, to resolve parent_id's
           }
@@ -1075,6 +1237,62 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
       Serial.printf("\n");
     }
     reply[0] = 0;
+  } else if (memcmp(command, "neighbors.near", 14) == 0 && (command[14] == 0 || command[14] == ' ')) {
+    // format:  neighbors.near [max-results] [max-km]
+    const char* parts[3];
+    int n = mesh::Utils::parseTextParts(command, parts, 3, ' ');
+    int max_results = n >= 2 ? atoi(parts[1]) : 8;
+    uint32_t max_dist = n >= 3 ? (uint32_t)(strtof(parts[2], nullptr) * 1000.0f) : 0;
+    formatNearestNeighborsReply(reply, max_results > 0 ? max_results : 8, max_dist);
+  } else if (sender_timestamp == 0 && strcmp(command, "stats-thin") == 0) {
+    int copies = advert_thin.getCopiesAvgX16();
+    sprintf(reply, "> neighbours: %d, copies/advert: %d.%d, density: %d, thinned: %u, cancelled: %u", countActiveNeighbours(),
+            copies / 16, (copies % 16) * 10 / 16, advert_thin.getDensity(countActiveNeighbours()),
+            (unsigned int) advert_thin.getNumThinned(), (unsigned int) advert_thin.getNumCancelled());
+  } else if (sender_timestamp == 0 && strcmp(command, "stats-lbt") == 0) {
+    uint32_t checks = getNumLBTChecks();
+    sprintf(reply, "> checks: %u, busy: %u%%, deferred: %u, forced: %u", (unsigned int) checks,
+            (unsigned int) (checks ? getNumLBTBusy() * 100 / checks : 0), (unsigned int) getNumLBTDeferred(),
+            (unsigned int) getNumLBTForced());
+  } else if (sender_timestamp == 0 && strcmp(command, "stats-anon") == 0) {
+    sprintf(reply, "> allowed: %u, dropped (sender): %u, dropped (global): %u", (unsigned int) anon_limiter.getNumAllowed(),
+            (unsigned int) anon_limiter.getNumDroppedSender(), (unsigned int) anon_limiter.getNumDroppedGlobal());
+  } else if (memcmp(command, "fwd.quota", 9) == 0 && (command[9] == 0 || command[9] == ' ')) {
+    const char* parts[3];
+    int n = mesh::Utils::parseTextParts(command, parts, 3, ' ');
+    int type = n >= 2 ? findPayloadType(parts[1]) : -1;
+    if (n == 1) {   // list the types which have quotas
+      strcpy(reply, ">");
+      for (int t = 0; t < FLOOD_NUM_TYPES; t++) {
+        auto& q = flood_policy.getQuota(t);
+        if (q.per_origin == 0 && q.total == 0) continue;
+        int len = strlen(reply);
+        if (len > 130) break;
+        sprintf(&reply[len], " %s:%d,%d(-%u)", payload_type_names[t], (uint32_t) q.per_origin, (uint32_t) q.total,
+                (unsigned int) flood_policy.getNumDropped(t));
+      }
+    } else if (type < 0) {
+      strcpy(reply, "Err - unknown payload type");
+    } else if (n == 2) {
+      auto& q = flood_policy.getQuota(type);
+      sprintf(reply, "> %d/hr per origin, %d/hr total, dropped: %u", (uint32_t) q.per_origin, (uint32_t) q.total,
+              (unsigned int) flood_policy.getNumDropped(type));
+    } else {   // set:  <per-origin/hr>[,<total/hr>]
+      char tmp[24];
+      StrHelper::strncpy(tmp, parts[2], sizeof(tmp));
+      const char* args[2];
+      int na = mesh::Utils::parseTextParts(tmp, args, 2, ',');
+      int per_origin = atoi(args[0]);
+      int total = na >= 2 ? atoi(args[1]) : 0;
+      if (per_origin < 0 || per_origin > 250 || total < 0 || total > 60000) {
+        strcpy(reply, "Err - per origin must be 0-250, total 0-60000");
+      } else {
+        auto& q = flood_policy.getQuota(type);
+        q.per_origin = per_origin;
+        q.total = total;
+        strcpy(reply, flood_policy.save(_fs) ? "OK" : "Err - save failed");
+      }
+    }
   } else if (memcmp(command, "region", 6) == 0) {
     reply[0] = 0;
 
@@ -1154,6 +1372,36 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
       } else {
         strcpy(reply, "Err - not found");
       }
+    } else if (n >= 3 && strcmp(parts[1], "quota") == 0) {
+      auto region = region_map.findByNamePrefix(parts[2]);
+      if (region == NULL) {
+        strcpy(reply, "Err - unknown region");
+      } else if (n >= 4) {   // set:  <pkts/hr>,<airtime secs/hr>[,low|normal|high]
+        char tmp[40];
+        StrHelper::strncpy(tmp, parts[3], sizeof(tmp));
+        const char* args[3];
+        int na = mesh::Utils::parseTextParts(tmp, args, 3, ',');
+        if (na < 2) {
+          strcpy(reply, "Err - use: <pkts/hr>,<airtime secs/hr>[,low|normal|high]");
+        } else {
+          region->policy.max_pkts = atoi(args[0]);
+          region->policy.max_airtime = atoi(args[1]);
+          if (na >= 3) {
+            region->policy.priority = strcmp(args[2], "low") == 0 ? REGION_PRI_LOW : (strcmp(args[2], "high") == 0 ? REGION_PRI_HIGH : REGION_PRI_NORMAL);
+          }
+          strcpy(reply, "OK");
+        }
+      } else {
+        auto q = region_map.getQuota(region);
+        const char* pri = region->policy.priority == REGION_PRI_LOW ? "low" : (region->policy.priority == REGION_PRI_HIGH ? "high" : "normal");
+        sprintf(reply, "> %d pkts/hr, %ds/hr, %s, fwd: %u, drop: %u, air: %us", (uint32_t) region->policy.max_pkts,
+                (uint32_t) region->policy.max_airtime, pri, (unsigned int) q->n_forwarded, (unsigned int) q->n_dropped,
+                (unsigned int) (q->airtime_used / 1000));
+      }
+    } else if (n == 2 && strcmp(parts[1], "keycache") == 0) {
+      sprintf(reply, "> hits: %u, misses: %u, evicted: %u, used: %d/%d", (unsigned int) key_store.getNumCacheHits(),
+              (unsigned int) key_store.getNumCacheMisses(), (unsigned int) key_store.getNumCacheEvictions(),
+              key_store.getCacheCount(), MAX_TKS_ENTRIES);
     } else if (n >= 3 && strcmp(parts[1], "list") == 0) {
       uint8_t mask = 0;
       bool invert = false;
@@ -1203,13 +1451,17 @@ void MyMesh::loop() {
 
   if (set_radio_at && millisHasNowPassed(set_radio_at)) { // apply pending (temporary) radio params
     set_radio_at = 0;                                     // clear timer
+    _radio->lock();
     radio_set_params(pending_freq, pending_bw, pending_sf, pending_cr);
+    _radio->unlock();
     MESH_DEBUG_PRINTLN("Temp radio params");
   }
 
   if (revert_radio_at && millisHasNowPassed(revert_radio_at)) { // revert radio params to orig
     revert_radio_at = 0;                                        // clear timer
+    _radio->lock();
     radio_set_params(_prefs.freq, _prefs.bw, _prefs.sf, _prefs.cr);
+    _radio->unlock();
     MESH_DEBUG_PRINTLN("Radio params restored");
   }
 
@@ -1219,6 +1471,18 @@ void MyMesh::loop() {
     dirty_contacts_expiry = 0;
   }
 
+  // write out buffered packet log, in between packets
+  bool is_idle = !_radio->isReceiving() && _mgr->getOutboundCount(0xFFFFFFFF) == 0;
+  if (pkt_log_flush_at && (pkt_log.isFull() || (is_idle && (pkt_log.isHalfFull() || millisHasNowPassed(pkt_log_flush_at))))) {
+    pkt_log.flush();
+    pkt_log_flush_at = 0;
+  }
+
+  if (_prefs.stats_push_interval && millisHasNowPassed(next_stats_push)) {
+    pushStats();
+    next_stats_push = futureMillis(_prefs.stats_push_interval * 1000);
+  }
+
   // update uptime
   uint32_t now = millis();
   uptime_millis += now - last_millis;
@@ -1230,5 +1494,6 @@ bool MyMesh::hasPendingWork() const {
 #if defined(WITH_BRIDGE)
   if (bridge.isRunning()) return true;  // bridge needs WiFi radio, can't sleep
 #endif
+  if (pkt_log.getPendingCount() > 0) return true;   // flush before sleeping
   return _mgr->getOutboundCount(0xFFFFFFFF) > 0;
 }
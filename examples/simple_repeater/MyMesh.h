@@ -27,6 +27,7 @@
 #include <helpers/ArduinoHelpers.h>
 #include <helpers/ClientACL.h>
 #include <helpers/CommonCLI.h>
+#include <helpers/GeoIndex.h>
 #include <helpers/IdentityStore.h>
 #include <helpers/SimpleMeshTables.h>
 #include <helpers/StaticPoolPacketManager.h>
@@ -34,6 +35,12 @@
 #include <helpers/TxtDataHelpers.h>
 #include <helpers/RegionMap.h>
 #include "RateLimiter.h"
+#include "AnonRequestFilter.h"
+#include "PacketLog.h"
+#include "StatsPush.h"
+#include "FloodPolicy.h"
+#include "AdvertThinning.h"
+#include "NeighbourTable.h"
 
 #ifdef WITH_BRIDGE
 extern AbstractBridge* bridge;
@@ -61,13 +68,6 @@ struct RepeaterStats {
   #define MAX_CLIENTS           32
 #endif
 
-struct NeighbourInfo {
-  mesh::Identity id;
-  uint32_t advert_timestamp;
-  uint32_t heard_timestamp;
-  int8_t snr; // multiplied by 4, user should divide to get float value
-};
-
 #ifndef FIRMWARE_BUILD_DATE
   #define FIRMWARE_BUILD_DATE   "15 Feb 2026"
 #endif
@@ -78,14 +78,18 @@ struct NeighbourInfo {
 
 #define FIRMWARE_ROLE "repeater"
 
-#define PACKET_LOG_FILE  "/packet_log"
-
 class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   FILESYSTEM* _fs;
   uint32_t last_millis;
   uint64_t uptime_millis;
   unsigned long next_local_advert, next_flood_advert;
   bool _logging;
+  PacketLog pkt_log;
+  unsigned long pkt_log_flush_at;
+  StatsPush stats_push;
+  FloodPolicy flood_policy;
+  AdvertThinning advert_thin;
+  unsigned long next_stats_push;
   NodePrefs _prefs;
   ClientACL  acl;
   CommonCLI _cli;
@@ -96,11 +100,14 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   RegionMap region_map, temp_map;
   RegionEntry* load_stack[8];
   RegionEntry* recv_pkt_region;
-  RateLimiter discover_limiter, anon_limiter;
+  RateLimiter discover_limiter;
+  SenderRateLimiter anon_limiter;
+  AnonRequestFilter anon_filter;
   bool region_load_active;
   unsigned long dirty_contacts_expiry;
 #if MAX_NEIGHBOURS
-  NeighbourInfo neighbours[MAX_NEIGHBOURS];
+  NeighbourTable<MAX_NEIGHBOURS> neighbours;
+  GeoIndex<MAX_NEIGHBOURS> neighbour_geo;
 #endif
   CayenneLPP telemetry;
   unsigned long set_radio_at, revert_radio_at;
@@ -115,15 +122,18 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   ESPNowBridge bridge;
 #endif
 
-  void putNeighbour(const mesh::Identity& id, uint32_t timestamp, float snr);
+  void putNeighbour(const mesh::Identity& id, uint32_t timestamp, float snr, int32_t gps_lat, int32_t gps_lon);
+  void updateNeighbourStats(const mesh::Packet* pkt, int len);
+  void formatNearestNeighborsReply(char *reply, int max_results, uint32_t max_dist);
   uint8_t handleLoginReq(const mesh::Identity& sender, const uint8_t* secret, uint32_t sender_timestamp, const uint8_t* data, bool is_flood);
   uint8_t handleAnonRegionsReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data);
   uint8_t handleAnonOwnerReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data);
   uint8_t handleAnonClockReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data);
   int handleRequest(ClientInfo* sender, uint32_t sender_timestamp, uint8_t* payload, size_t payload_len);
   mesh::Packet* createSelfAdvert();
-
-  File openAppend(const char* fname);
+  void pushStats();
+  int countActiveNeighbours();
+  void cancelRetransmit(const uint8_t* pkt_hash);
 
 protected:
   float getAirtimeBudgetFactor() const override {
@@ -131,6 +141,7 @@ protected:
   }
 
   bool allowPacketForward(const mesh::Packet* packet) override;
+  bool allowAnonRequest(const mesh::Packet* packet, const uint8_t* sender_pub_key) override;
   const char* getLogDateTime() override;
   void logRxRaw(float snr, float rssi, const uint8_t raw[], int len) override;
 
@@ -191,10 +202,14 @@ public:
   void updateAdvertTimer() override;
   void updateFloodAdvertTimer() override;
 
-  void setLoggingOn(bool enable) override { _logging = enable; }
+  void setLoggingOn(bool enable) override {
+    _logging = enable;
+    if (enable) pkt_log.start();
+    else pkt_log.flush();
+  }
 
   void eraseLogFile() override {
-    _fs->remove(PACKET_LOG_FILE);
+    pkt_log.erase();
   }
 
   void dumpLogFile() override;
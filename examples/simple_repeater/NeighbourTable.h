@@ -0,0 +1,126 @@
+#pragma once
+
+#include <Mesh.h>
+
+#ifndef NEIGHBOUR_HASH_BUCKETS
+  #define NEIGHBOUR_HASH_BUCKETS   32     // must be power of 2
+#endif
+
+#define NEIGHBOUR_NUM_TYPES   16     // last heard is kept per payload type
+
+struct NeighbourInfo {
+  mesh::Identity id;
+  uint32_t advert_timestamp;
+  uint32_t heard_timestamp;
+  int8_t snr; // multiplied by 4, user should divide to get float value
+  int32_t gps_lat, gps_lon;  // from advert (if any), 6 dec places
+
+  // traffic stats, since first heard (transient)
+  uint32_t n_rx_pkts, n_rx_bytes;
+  int16_t snr_avg;          // EWMA, multiplied by 64
+  int8_t  snr_min, snr_max;  // multiplied by 4
+  uint32_t type_heard[NEIGHBOUR_NUM_TYPES];   // our RTC time, when last heard each payload type (zero = never)
+};
+
+/**
+ * \brief  Table of neighbouring repeaters, hashed by first byte of pub_key (ie. same as their path hash), so
+ *   packets can be attributed to the neighbour which relayed them. Entries keep a fixed index until removed.
+ */
+template <int MAX_ITEMS>
+class NeighbourTable {
+  NeighbourInfo entries[MAX_ITEMS];
+  int16_t buckets[NEIGHBOUR_HASH_BUCKETS];
+  int16_t next[MAX_ITEMS];
+
+  static int bucketOf(uint8_t hash) { return hash & (NEIGHBOUR_HASH_BUCKETS - 1); }
+
+  void unlink(int idx) {
+    int16_t* link = &buckets[bucketOf(entries[idx].id.pub_key[0])];
+    while (*link >= 0) {
+      if (*link == idx) {
+        *link = next[idx];
+        break;
+      }
+      link = &next[*link];
+    }
+  }
+
+public:
+  NeighbourTable() {
+    for (int i = 0; i < MAX_ITEMS; i++) {
+      entries[i] = NeighbourInfo();
+    }
+    memset(buckets, 0xFF, sizeof(buckets));   // all -1
+    memset(next, 0xFF, sizeof(next));
+  }
+
+  bool isUsed(int idx) const { return entries[idx].heard_timestamp > 0; }
+  NeighbourInfo* getByIdx(int idx) { return &entries[idx]; }
+
+  int find(const uint8_t* pub_key, int key_len) const {
+    for (int i = buckets[bucketOf(pub_key[0])]; i >= 0; i = next[i]) {
+      if (memcmp(entries[i].id.pub_key, pub_key, key_len) == 0) return i;
+    }
+    return -1;  // not found
+  }
+
+  /**
+   * \returns  index of most recently heard neighbour with given path hash, or -1 if none
+   */
+  int findByHash(uint8_t hash) const {
+    int best = -1;
+    for (int i = buckets[bucketOf(hash)]; i >= 0; i = next[i]) {
+      if (entries[i].id.pub_key[0] == hash && (best < 0 || entries[i].heard_timestamp > entries[best].heard_timestamp)) {
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  /**
+   * \brief  finds existing neighbour, else allocates new entry, evicting the least recently heard
+   * \returns  index of entry
+   */
+  int put(const mesh::Identity& id) {
+    int idx = find(id.pub_key, PUB_KEY_SIZE);
+    if (idx >= 0) return idx;
+
+    uint32_t oldest_timestamp = 0xFFFFFFFF;
+    idx = 0;
+    for (int i = 0; i < MAX_ITEMS; i++) {
+      if (entries[i].heard_timestamp < oldest_timestamp) {
+        idx = i;
+        oldest_timestamp = entries[i].heard_timestamp;
+      }
+    }
+    remove(idx);
+
+    entries[idx].id = id;
+    int b = bucketOf(id.pub_key[0]);
+    next[idx] = buckets[b];
+    buckets[b] = idx;
+    return idx;
+  }
+
+  void remove(int idx) {
+    if (isUsed(idx)) unlink(idx);
+    entries[idx] = NeighbourInfo();   // clear entry
+    next[idx] = -1;
+  }
+
+  void onRecv(int idx, uint8_t payload_type, int len, float snr, uint32_t now) {
+    auto n = &entries[idx];
+    int8_t snr4 = (int8_t) constrain(snr * 4, -128, 127);
+    if (n->n_rx_pkts == 0) {
+      n->snr_avg = snr4 * 16;
+      n->snr_min = n->snr_max = snr4;
+    } else {
+      n->snr_avg += (snr4 * 16 - n->snr_avg) / 8;   // EWMA, alpha = 1/8
+      if (snr4 < n->snr_min) n->snr_min = snr4;
+      if (snr4 > n->snr_max) n->snr_max = snr4;
+    }
+    n->n_rx_pkts++;
+    n->n_rx_bytes += len;
+    n->type_heard[payload_type & (NEIGHBOUR_NUM_TYPES - 1)] = now;
+  }
+};
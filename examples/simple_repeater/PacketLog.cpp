@@ -0,0 +1,136 @@
+#include "PacketLog.h"
+#include <MeshCore.h>
+
+static const uint8_t log_header[8] = { 'M', 'C', 'P', 'L', PACKET_LOG_VERSION, sizeof(PacketLogRecord), 0, 0 };
+
+File PacketLog::openAppend(const char* fname) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return _fs->open(fname, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return _fs->open(fname, "a");
+#else
+  return _fs->open(fname, "a", true);
+#endif
+}
+
+File PacketLog::openRead(const char* fname) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return _fs->open(fname, FILE_O_READ);
+#else
+  return _fs->open(fname, "r");
+#endif
+}
+
+void PacketLog::start() {
+  if (ring == NULL) ring = new PacketLogRecord[PACKET_LOG_RAM_RECORDS];
+}
+
+bool PacketLog::readHeader(File& f) {
+  uint8_t hdr[sizeof(log_header)];
+  return f.read(hdr, sizeof(hdr)) == sizeof(hdr) && memcmp(hdr, log_header, 6) == 0;   // magic, version, record size
+}
+
+void PacketLog::rotate() {
+  _fs->remove(PACKET_LOG_OLD_FILE);
+  _fs->rename(PACKET_LOG_FILE, PACKET_LOG_OLD_FILE);
+}
+
+void PacketLog::add(uint8_t kind, const mesh::Packet* pkt, int len, float snr, float rssi, float score, uint32_t timestamp) {
+  if (ring == NULL) return;   // not started
+  if (count >= PACKET_LOG_RAM_RECORDS) {   // not flushed in time, overwrite oldest
+    head = (head + 1) % PACKET_LOG_RAM_RECORDS;
+    count--;
+    num_dropped++;
+  }
+  auto r = &ring[(head + count) % PACKET_LOG_RAM_RECORDS];
+  count++;
+
+  memset(r, 0, sizeof(*r));
+  r->timestamp = timestamp;
+  r->kind = kind;
+  r->header = pkt->header;
+  r->len = len;
+  r->payload_len = pkt->payload_len;
+  r->snr = (int8_t) constrain(snr * 4, -128, 127);
+  r->rssi = (int8_t) constrain(rssi, -128, 127);
+  r->score = (uint16_t) constrain(score * 1000, 0, 65535);
+  r->path_len = pkt->path_len;
+
+  uint8_t t = pkt->getPayloadType();
+  if (t == PAYLOAD_TYPE_PATH || t == PAYLOAD_TYPE_REQ || t == PAYLOAD_TYPE_RESPONSE || t == PAYLOAD_TYPE_TXT_MSG) {
+    r->dest_hash = pkt->payload[0];
+    r->src_hash = pkt->payload[1];
+  }
+  uint8_t hash[MAX_HASH_SIZE];
+  pkt->calculatePacketHash(hash);
+  memcpy(r->pkt_hash, hash, sizeof(r->pkt_hash));
+}
+
+void PacketLog::flush() {
+  if (count == 0 || _fs == NULL) return;
+
+  if (!file_checked && _fs->exists(PACKET_LOG_FILE)) {   // eg. a text log from older firmware, don't append to it
+    File f = openRead(PACKET_LOG_FILE);
+    if (f) {
+      bool valid = f.size() == 0 || readHeader(f);
+      f.close();
+      if (!valid) rotate();
+    }
+  }
+  file_checked = true;
+
+  File f = openAppend(PACKET_LOG_FILE);
+  if (f && f.size() + count * sizeof(PacketLogRecord) > PACKET_LOG_MAX_FILE_SIZE) {
+    f.close();
+    rotate();
+    f = openAppend(PACKET_LOG_FILE);
+  }
+  if (!f) return;   // try again later
+
+  if (f.size() == 0) {
+    f.write(log_header, sizeof(log_header));
+  }
+  // ring is written in (at most) two sequential chunks
+  int n = count;
+  if (head + n > PACKET_LOG_RAM_RECORDS) n = PACKET_LOG_RAM_RECORDS - head;
+  f.write((uint8_t *) &ring[head], n * sizeof(PacketLogRecord));
+  if (n < count) {
+    f.write((uint8_t *) &ring[0], (count - n) * sizeof(PacketLogRecord));
+  }
+  f.close();
+
+  head = count = 0;
+}
+
+void PacketLog::erase() {
+  head = count = 0;
+  num_dropped = 0;
+  _fs->remove(PACKET_LOG_OLD_FILE);
+  _fs->remove(PACKET_LOG_FILE);
+}
+
+void PacketLog::dumpFile(const char* fname, Stream& out) {
+  File f = openRead(fname);
+  if (f) {
+    uint8_t buf[sizeof(PacketLogRecord)];
+    char hex[sizeof(buf)*2 + 1];
+    int n;
+    if (!readHeader(f)) {   // eg. a text log from older firmware
+      f.close();
+      return;
+    }
+    mesh::Utils::toHex(hex, log_header, sizeof(log_header));
+    out.println(hex);
+    while ((n = f.read(buf, sizeof(buf))) == sizeof(buf)) {
+      mesh::Utils::toHex(hex, buf, n);
+      out.println(hex);
+    }
+    f.close();
+  }
+}
+
+void PacketLog::dump(Stream& out) {
+  flush();
+  dumpFile(PACKET_LOG_OLD_FILE, out);
+  dumpFile(PACKET_LOG_FILE, out);
+}
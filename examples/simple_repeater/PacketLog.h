@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Packet.h>
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+
+#ifndef PACKET_LOG_RAM_RECORDS
+  #define PACKET_LOG_RAM_RECORDS   64      // records buffered in RAM, between flushes
+#endif
+#ifndef PACKET_LOG_MAX_FILE_SIZE
+  #define PACKET_LOG_MAX_FILE_SIZE  (32*1024)   // rotate to PACKET_LOG_FILE ".1" when reached
+#endif
+#ifndef PACKET_LOG_FLUSH_DELAY
+  #define PACKET_LOG_FLUSH_DELAY   5000    // max millis a record waits in RAM (when idle)
+#endif
+
+#define PACKET_LOG_FILE      "/packet_log"
+#define PACKET_LOG_OLD_FILE  "/packet_log.1"
+
+#define PKT_LOG_RX        1
+#define PKT_LOG_TX        2
+#define PKT_LOG_TX_FAIL   3
+
+/*
+  File format (all little-endian), see also bin/packet_log/decode.py
+    header:  "MCPL", version (1 byte), record size (1 byte), 2 bytes reserved
+    then a sequence of PacketLogRecord
+*/
+#define PACKET_LOG_VERSION   1
+
+struct PacketLogRecord {   // 20 bytes
+  uint32_t timestamp;    // RTC time
+  uint8_t  kind;         // one of PKT_LOG_*
+  uint8_t  header;       // raw packet header, ie. route type, payload type and version
+  uint8_t  len;          // raw packet length
+  uint8_t  payload_len;
+  int8_t   snr;          // in 1/4 dB (RX only)
+  int8_t   rssi;         // (RX only)
+  uint16_t score;        // x1000 (RX only)
+  uint8_t  path_len;
+  uint8_t  dest_hash, src_hash;   // for PATH, REQ, RESPONSE, TXT_MSG only, otherwise zero
+  uint8_t  reserved;
+  uint8_t  pkt_hash[4];  // prefix of packet hash
+};
+
+/**
+ * \brief  Binary packet log, buffered in a RAM ring and written out to flash in batches. The ring is only allocated
+ *   once logging is first started.
+ */
+class PacketLog {
+  FILESYSTEM* _fs;
+  PacketLogRecord* ring;
+  int head, count;
+  uint32_t num_dropped;
+  bool file_checked;
+
+  File openAppend(const char* fname);
+  File openRead(const char* fname);
+  bool readHeader(File& f);
+  void rotate();
+  void dumpFile(const char* fname, Stream& out);
+
+public:
+  PacketLog() : _fs(NULL), ring(NULL), head(0), count(0), num_dropped(0), file_checked(false) { }
+
+  void begin(FILESYSTEM* fs) { _fs = fs; }
+  void start();
+  void add(uint8_t kind, const mesh::Packet* pkt, int len, float snr, float rssi, float score, uint32_t timestamp);
+  int  getPendingCount() const { return count; }
+  bool isFull() const { return count >= PACKET_LOG_RAM_RECORDS; }
+  bool isHalfFull() const { return count >= PACKET_LOG_RAM_RECORDS / 2; }
+  uint32_t getNumDropped() const { return num_dropped; }
+  void flush();
+  void erase();
+  void dump(Stream& out);   // as hex, one record per line
+};
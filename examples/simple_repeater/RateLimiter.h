@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 
 class RateLimiter {
   uint32_t _start_timestamp;
@@ -20,4 +21,87 @@ public:
     }
     return true;
   }
-};
\ No newline at end of file
+};
+#ifndef SENDER_LIMITER_SLOTS
+  #define SENDER_LIMITER_SLOTS   32     // must be power of 2
+#endif
+
+#define SENDER_LIMITER_PROBES   4
+
+/**
+ * \brief  Token buckets per sender (by pub_key prefix), in a small hashed table, plus one global bucket
+ *   shared by all (unknown) senders. Buckets are kept as a 'theoretical arrival time' (GCRA), in millis.
+ */
+class SenderRateLimiter {
+  struct Slot {
+    uint8_t prefix[4];
+    unsigned long tat;
+  };
+  Slot slots[SENDER_LIMITER_SLOTS];
+  unsigned long global_tat;
+  uint32_t _interval, _global_interval;
+  uint8_t _burst, _global_burst;
+  uint32_t n_allowed, n_dropped_sender, n_dropped_global;
+
+  // NOTE: unsigned arithmetic, so millis() wrap-around is fine
+  static bool conforms(unsigned long tat, unsigned long now, uint32_t interval, uint8_t burst) {
+    return (long)(now - tat) >= -(long)(interval * (burst - 1));
+  }
+  static unsigned long advance(unsigned long tat, unsigned long now, uint32_t interval) {
+    return ((long)(now - tat) > 0 ? now : tat) + interval;
+  }
+
+public:
+  /**
+   * \param  interval_secs  each sender gets one request per this many seconds ...
+   * \param  burst          ... with up to this many in a burst
+   */
+  SenderRateLimiter(uint32_t interval_secs, uint8_t burst, uint32_t global_interval_secs, uint8_t global_burst)
+    : _interval(interval_secs * 1000), _global_interval(global_interval_secs * 1000), _burst(burst), _global_burst(global_burst)
+  {
+    memset(slots, 0, sizeof(slots));
+    global_tat = 0;
+    n_allowed = n_dropped_sender = n_dropped_global = 0;
+  }
+
+  /**
+   * \param  is_known  sender is a known client (whose MAC has been checked), so is exempt from the global bucket
+   */
+  bool allow(const uint8_t* pub_key, unsigned long now, bool is_known) {
+    int start = pub_key[0] & (SENDER_LIMITER_SLOTS - 1);
+    Slot* slot = NULL;
+    Slot* idlest = NULL;
+    for (int i = 0; i < SENDER_LIMITER_PROBES; i++) {
+      Slot* s = &slots[(start + i) & (SENDER_LIMITER_SLOTS - 1)];
+      if (memcmp(s->prefix, pub_key, sizeof(s->prefix)) == 0) {
+        slot = s;
+        break;
+      }
+      if (idlest == NULL || (long)(s->tat - idlest->tat) < 0) idlest = s;
+    }
+    unsigned long tat = slot ? slot->tat : now;   // new sender, has full bucket
+
+    if (!conforms(tat, now, _interval, _burst)) {
+      n_dropped_sender++;
+      return false;
+    }
+    if (!is_known) {
+      if (!conforms(global_tat, now, _global_interval, _global_burst)) {
+        n_dropped_global++;
+        return false;
+      }
+      global_tat = advance(global_tat, now, _global_interval);
+    }
+    if (slot == NULL) {   // replace the most idle sender
+      slot = idlest;
+      memcpy(slot->prefix, pub_key, sizeof(slot->prefix));
+    }
+    slot->tat = advance(tat, now, _interval);
+    n_allowed++;
+    return true;
+  }
+
+  uint32_t getNumAllowed() const { return n_allowed; }
+  uint32_t getNumDroppedSender() const { return n_dropped_sender; }
+  uint32_t getNumDroppedGlobal() const { return n_dropped_global; }
+};
@@ -0,0 +1,74 @@
+#include "StatsPush.h"
+
+static uint16_t delta16(uint32_t curr, uint32_t prev) {
+  uint32_t d = curr - prev;   // NOTE: unsigned arithmetic, so counter wrap-around is fine
+  return d > 0xFFFF ? 0xFFFF : d;   // saturate
+}
+
+int StatsPush::writeFrame(const StatsSnapshot& curr, const uint8_t* self_pub_key, uint8_t dest[]) {
+  bool full = (seq % STATS_PUSH_FULL_EVERY) == 0;
+
+  int i = 0;
+  dest[i++] = STATS_PUSH_VERSION;
+  dest[i++] = full ? STATS_PUSH_FLAG_FULL : 0;
+  memcpy(&dest[i], &seq, 2); i += 2;
+  memcpy(&dest[i], self_pub_key, 4); i += 4;
+
+  if (full) {
+    dest[i++] = STATS_RESP_CODE;
+    dest[i++] = STATS_TYPE_CORE;
+    memcpy(&dest[i], &curr.batt_milli_volts, 2); i += 2;
+    memcpy(&dest[i], &curr.uptime_secs, 4); i += 4;
+    memcpy(&dest[i], &curr.err_flags, 2); i += 2;
+    dest[i++] = curr.queue_len;
+
+    dest[i++] = STATS_RESP_CODE;
+    dest[i++] = STATS_TYPE_RADIO;
+    uint32_t tx_air_secs = curr.tx_air_millis / 1000;
+    uint32_t rx_air_secs = curr.rx_air_millis / 1000;
+    memcpy(&dest[i], &curr.noise_floor, 2); i += 2;
+    dest[i++] = curr.last_rssi;
+    dest[i++] = curr.last_snr;
+    memcpy(&dest[i], &tx_air_secs, 4); i += 4;
+    memcpy(&dest[i], &rx_air_secs, 4); i += 4;
+
+    dest[i++] = STATS_RESP_CODE;
+    dest[i++] = STATS_TYPE_PACKETS;
+    memcpy(&dest[i], &curr.n_packets_recv, 4); i += 4;
+    memcpy(&dest[i], &curr.n_packets_sent, 4); i += 4;
+    memcpy(&dest[i], &curr.n_sent_flood, 4); i += 4;
+    memcpy(&dest[i], &curr.n_sent_direct, 4); i += 4;
+    memcpy(&dest[i], &curr.n_recv_flood, 4); i += 4;
+    memcpy(&dest[i], &curr.n_recv_direct, 4); i += 4;
+    memcpy(&dest[i], &curr.n_recv_errors, 4); i += 4;
+  } else {
+    uint16_t d[10];
+    d[0] = delta16(curr.uptime_secs, prev.uptime_secs);   // interval
+    d[1] = delta16(curr.n_packets_recv, prev.n_packets_recv);
+    d[2] = delta16(curr.n_packets_sent, prev.n_packets_sent);
+    d[3] = delta16(curr.n_sent_flood, prev.n_sent_flood);
+    d[4] = delta16(curr.n_sent_direct, prev.n_sent_direct);
+    d[5] = delta16(curr.n_recv_flood, prev.n_recv_flood);
+    d[6] = delta16(curr.n_recv_direct, prev.n_recv_direct);
+    d[7] = delta16(curr.n_recv_errors, prev.n_recv_errors);
+    d[8] = (uint16_t)(curr.n_flood_dups - prev.n_flood_dups);
+    d[9] = (uint16_t)(curr.n_direct_dups - prev.n_direct_dups);
+    uint32_t tx_air = curr.tx_air_millis - prev.tx_air_millis;
+    uint32_t rx_air = curr.rx_air_millis - prev.rx_air_millis;
+
+    dest[i++] = STATS_RESP_CODE;
+    dest[i++] = STATS_TYPE_DELTA;
+    memcpy(&dest[i], d, sizeof(d)); i += sizeof(d);
+    memcpy(&dest[i], &tx_air, 4); i += 4;
+    memcpy(&dest[i], &rx_air, 4); i += 4;
+    memcpy(&dest[i], &curr.noise_floor, 2); i += 2;
+    dest[i++] = curr.last_rssi;
+    dest[i++] = curr.last_snr;
+    memcpy(&dest[i], &curr.batt_milli_volts, 2); i += 2;
+    dest[i++] = curr.queue_len;
+    memcpy(&dest[i], &curr.err_flags, 2); i += 2;
+  }
+  prev = curr;
+  seq++;
+  return i;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+
+#ifndef STATS_PUSH_FULL_EVERY
+  #define STATS_PUSH_FULL_EVERY   10     // every Nth push has absolute counters (others are deltas)
+#endif
+
+#define STATS_PUSH_DEST_SERIAL   0
+#define STATS_PUSH_DEST_BRIDGE   1
+
+/*
+  Push frame format (all little-endian), see docs/stats_binary_frames.md and bin/stats_collector/collect.py
+    header:  version (1 byte), flags (1 byte), seq (uint16), pub_key prefix (4 bytes)
+    if flags & STATS_PUSH_FLAG_FULL:  STATS_TYPE_CORE, STATS_TYPE_RADIO and STATS_TYPE_PACKETS records (as per companion replies)
+    else:  a single STATS_TYPE_DELTA record
+*/
+#define STATS_PUSH_VERSION       1
+#define STATS_PUSH_FLAG_FULL     0x01
+#define STATS_PUSH_HEADER_SIZE   8
+#define STATS_PUSH_MAX_FRAME     64
+
+#define STATS_RESP_CODE          24   // same as companion RESP_CODE_STATS
+#define STATS_TYPE_CORE          0
+#define STATS_TYPE_RADIO         1
+#define STATS_TYPE_PACKETS       2
+#define STATS_TYPE_DELTA         3    // push only
+
+struct StatsSnapshot {
+  uint32_t uptime_secs;
+  uint16_t batt_milli_volts;
+  uint16_t err_flags;
+  uint8_t  queue_len;
+  int16_t  noise_floor;
+  int8_t   last_rssi;
+  int8_t   last_snr;   // x 4
+  uint32_t n_packets_recv, n_packets_sent;
+  uint32_t n_sent_flood, n_sent_direct;
+  uint32_t n_recv_flood, n_recv_direct;
+  uint32_t n_recv_errors;
+  uint16_t n_flood_dups, n_direct_dups;
+  uint32_t tx_air_millis, rx_air_millis;
+};
+
+/**
+ * \brief  Builds the periodic stats push frames, as counter deltas since the previous push, with a full frame
+ *   of absolute counters every STATS_PUSH_FULL_EVERY pushes (so a collector can resync after lost frames).
+ */
+class StatsPush {
+  StatsSnapshot prev;
+  uint16_t seq;
+
+public:
+  StatsPush() : seq(0) { memset(&prev, 0, sizeof(prev)); }
+
+  /**
+   * \returns  length of frame written to 'dest' (at most STATS_PUSH_MAX_FRAME)
+   */
+  int writeFrame(const StatsSnapshot& curr, const uint8_t* self_pub_key, uint8_t dest[]);
+};
@@ -11,7 +11,13 @@
 StdRNG fast_rng;
 SimpleMeshTables tables;
 
-MyMesh the_mesh(board, radio_driver, *new ArduinoMillis(), fast_rng, rtc_clock, tables);
+#ifdef RADIO_TASK_CORE
+  #include <helpers/QueuedRadio.h>
+  static QueuedRadio queued_radio(radio_driver, RADIO_TASK_CORE);   // radio serviced in own task, on this core
+  MyMesh the_mesh(board, queued_radio, *new ArduinoMillis(), fast_rng, rtc_clock, tables);
+#else
+  MyMesh the_mesh(board, radio_driver, *new ArduinoMillis(), fast_rng, rtc_clock, tables);
+#endif
 
 void halt() {
   while (1) ;
@@ -134,7 +140,11 @@ void loop() {
 #endif
   rtc_clock.tick();
 
-  if (the_mesh.getNodePrefs()->powersaving_enabled && !the_mesh.hasPendingWork()) {
+  bool pending_work = the_mesh.hasPendingWork();
+#ifdef RADIO_TASK_CORE
+  if (queued_radio.getRxQueueLen() > 0) pending_work = true;   // received, but not processed yet
+#endif
+  if (the_mesh.getNodePrefs()->powersaving_enabled && !pending_work) {
     #if defined(NRF52_PLATFORM)
     board.sleep(1800); // nrf ignores seconds param, sleeps whenever possible
     #else
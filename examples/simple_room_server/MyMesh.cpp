@@ -2,7 +2,8 @@
 
 #define REPLY_DELAY_MILLIS          1500
 #define PUSH_NOTIFY_DELAY_MILLIS    2000
-#define SYNC_PUSH_INTERVAL          1200
+#define SYNC_POLL_INTERVAL          150
+#define PUSH_MAX_QUEUED             2     // outbound queue depth, above which new pushes are held
 
 #define PUSH_ACK_TIMEOUT_FLOOD      12000
 #define PUSH_TIMEOUT_BASE           4000
@@ -40,17 +41,15 @@ struct ServerStats {
 
 void MyMesh::addPost(ClientInfo *client, const char *postData) {
   // TODO: suggested postData format: <title>/<descrption>
-  posts[next_post_idx].author = client->id; // add to cyclic queue
-  StrHelper::strncpy(posts[next_post_idx].text, postData, MAX_POST_TEXT_LEN);
-
-  posts[next_post_idx].post_timestamp = getRTCClock()->getCurrentTimeUnique();
-  next_post_idx = (next_post_idx + 1) % MAX_UNSYNCED_POSTS;
+  if (!post_store.add(client->id, getRTCClock()->getCurrentTimeUnique(), postData)) {
+    MESH_DEBUG_PRINTLN("addPost: unable to store post");
+  }
 
   next_push = futureMillis(PUSH_NOTIFY_DELAY_MILLIS);
   _num_posted++; // stats
 }
 
-void MyMesh::pushPostToClient(ClientInfo *client, PostInfo &post) {
+bool MyMesh::pushPostToClient(ClientInfo *client, PostInfo &post, PushInFlight *slot, int num_ahead) {
   int len = 0;
   memcpy(&reply_data[len], &post.post_timestamp, 4);
   len += 4; // this is a PAST timestamp... but should be accepted by client
@@ -68,44 +67,128 @@ void MyMesh::pushPostToClient(ClientInfo *client, PostInfo &post) {
   len += text_len;
 
   // calc expected ACK reply
-  mesh::Utils::sha256((uint8_t *)&client->extra.room.pending_ack, 4, reply_data, len, client->id.pub_key, PUB_KEY_SIZE);
-  client->extra.room.push_post_timestamp = post.post_timestamp;
+  uint32_t ack;
+  mesh::Utils::sha256((uint8_t *)&ack, 4, reply_data, len, client->id.pub_key, PUB_KEY_SIZE);
 
-  auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, client->shared_secret, reply_data, len);
-  if (reply) {
-    if (client->out_path_len < 0) {
-      sendFlood(reply);
-      client->extra.room.ack_timeout = futureMillis(PUSH_ACK_TIMEOUT_FLOOD);
-    } else {
-      sendDirect(reply, client->out_path, client->out_path_len);
-      client->extra.room.ack_timeout =
-          futureMillis(PUSH_TIMEOUT_BASE + PUSH_ACK_TIMEOUT_FACTOR * (client->out_path_len + 1));
-    }
-    _num_post_pushes++; // stats
-  } else {
-    client->extra.room.pending_ack = 0;
+  auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, acl.getSharedSecret(client), reply_data, len);
+  if (reply == NULL) {
+    slot->ack_timeout = 0;   // try again later
     MESH_DEBUG_PRINTLN("Unable to push post to client");
+    return false;
   }
+  slot->prev_ack = slot->ack;
+  slot->ack = ack;
+  if (client->out_path_len < 0) {
+    sendFlood(reply);
+    slot->ack_timeout = futureMillis(PUSH_ACK_TIMEOUT_FLOOD);
+  } else {
+    sendDirect(reply, client->out_path, client->out_path_len);
+    // pushes still in-flight to this client are ahead of this one, on every hop
+    uint32_t t = PUSH_TIMEOUT_BASE + PUSH_ACK_TIMEOUT_FACTOR * (client->out_path_len + 1)
+               + num_ahead * (client->out_path_len + 1) * _radio->getEstAirtimeFor(reply->getRawLength());
+    slot->ack_timeout = futureMillis(t);
+  }
+  _num_post_pushes++; // stats
+  return true;
 }
 
-uint8_t MyMesh::getUnsyncedCount(ClientInfo *client) {
-  uint8_t count = 0;
-  for (int k = 0; k < MAX_UNSYNCED_POSTS; k++) {
-    if (posts[k].post_timestamp > client->extra.room.sync_since // is new post for this Client?
-        && !posts[k].author.matches(client->id)) {   // don't push posts to the author
-      count++;
+bool MyMesh::pushNextToClient(ClientInfo *client) {
+  if (client->last_activity == 0 || client->extra.room.push_failures >= 3) return false;  // evicted, or retries maxed
+  if (client->extra.room.push_post_timestamp < client->extra.room.sync_since) {
+    client->extra.room.push_post_timestamp = client->extra.room.sync_since;   // eg. loaded from ACL file
+  }
+
+  uint32_t id;
+  memcpy(&id, client->id.pub_key, 4);
+  PushInFlight* retry = NULL;
+  PushInFlight* unused = NULL;
+  int num_live = 0;
+  for (int i = 0; i < MAX_PUSHES_IN_FLIGHT; i++) {
+    auto p = &pushes[i];
+    if (p->post_timestamp == 0) {
+      if (unused == NULL) unused = p;
+    } else if (p->client == id) {
+      if (p->ack_timeout) {
+        num_live++;
+      } else if (retry == NULL || p->post_timestamp < retry->post_timestamp) {
+        retry = p;   // oldest timed-out post
+      }
+    }
+  }
+  int window = client->out_path_len < 0 ? 1 : PUSH_WINDOW_SIZE;   // don't pipeline floods
+  if (num_live >= window) return false;
+
+  PostInfo post;
+  if (retry) {   // retries first, so sync_since can advance
+    int idx = post_store.findNext(retry->post_timestamp - 1, retry->post_timestamp, client->id.pub_key);
+    if (idx < 0 || !post_store.read(idx, post)) {   // post no longer stored, just skip it
+      retry->post_timestamp = 0;
+      updateSyncSince(client);
+      return false;
     }
+    return pushPostToClient(client, post, retry, num_live);
   }
-  return count;
+  if (unused == NULL) return false;   // all slots in use
+
+  // oldest post which is new for this Client, but not by the author
+  uint32_t now = getRTCClock()->getCurrentTime();
+  int idx = post_store.findNext(client->extra.room.push_post_timestamp, now - POST_SYNC_DELAY_SECS, client->id.pub_key);
+  if (idx < 0 || !post_store.read(idx, post)) return false;
+
+  unused->client = id;
+  unused->post_timestamp = post.post_timestamp;
+  unused->ack = unused->prev_ack = 0;
+  client->extra.room.push_post_timestamp = post.post_timestamp;
+  MESH_DEBUG_PRINTLN("loop - pushing to client %02X: %s", (uint32_t)client->id.pub_key[0], post.text);
+  return pushPostToClient(client, post, unused, num_live);
+}
+
+void MyMesh::updateSyncSince(ClientInfo *client) {
+  // everything pushed has been ACK'd, up to the oldest post still in-flight (post timestamps are unique)
+  uint32_t id;
+  memcpy(&id, client->id.pub_key, 4);
+  uint32_t since = client->extra.room.push_post_timestamp;
+  for (int i = 0; i < MAX_PUSHES_IN_FLIGHT; i++) {
+    auto p = &pushes[i];
+    if (p->post_timestamp && p->client == id && p->post_timestamp - 1 < since) since = p->post_timestamp - 1;
+  }
+  client->extra.room.sync_since = since;
+}
+
+void MyMesh::releasePushes(ClientInfo *client) {
+  uint32_t id;
+  memcpy(&id, client->id.pub_key, 4);
+  for (int i = 0; i < MAX_PUSHES_IN_FLIGHT; i++) {
+    if (pushes[i].client == id) pushes[i].post_timestamp = 0;
+  }
+  client->extra.room.push_post_timestamp = client->extra.room.sync_since;   // push again from here
+}
+
+void MyMesh::resetPushes(ClientInfo *client) {
+#if MAX_SYNC_BACKLOG > 0
+  // don't push the whole history to a new client, or one that's been away a long time
+  client->extra.room.sync_since = post_store.limitBacklog(client->extra.room.sync_since, client->id.pub_key, MAX_SYNC_BACKLOG);
+#endif
+  releasePushes(client);
+  client->extra.room.push_failures = 0;
+}
+
+uint8_t MyMesh::getUnsyncedCount(ClientInfo *client) {
+  // new posts for this Client, but don't count posts by the author
+  return post_store.countAfter(client->extra.room.sync_since, client->id.pub_key, 0xFF);
 }
 
 bool MyMesh::processAck(const uint8_t *data) {
-  for (int i = 0; i < acl.getNumClients(); i++) {
-    auto client = acl.getClientByIdx(i);
-    if (client->extra.room.pending_ack && memcmp(data, &client->extra.room.pending_ack, 4) == 0) { // got an ACK from Client!
-      client->extra.room.pending_ack = 0; // clear this, so next push can happen
-      client->extra.room.push_failures = 0;
-      client->extra.room.sync_since = client->extra.room.push_post_timestamp; // advance Client's SINCE timestamp, to sync next post
+  for (int i = 0; i < MAX_PUSHES_IN_FLIGHT; i++) {
+    auto p = &pushes[i];
+    if (p->post_timestamp == 0) continue;
+    if ((p->ack && memcmp(data, &p->ack, 4) == 0) || (p->prev_ack && memcmp(data, &p->prev_ack, 4) == 0)) { // got an ACK from Client! (maybe late)
+      p->post_timestamp = 0; // free this slot, so next push can happen
+      auto client = acl.getClient((const uint8_t *)&p->client, 4);
+      if (client) {
+        client->extra.room.push_failures = 0;
+        updateSyncSince(client); // advance Client's SINCE timestamp
+      }
       return true;
     }
   }
@@ -321,13 +404,12 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
       MESH_DEBUG_PRINTLN("Login success!");
       client->last_timestamp = sender_timestamp;
       client->extra.room.sync_since = sender_sync_since;
-      client->extra.room.pending_ack = 0;
-      client->extra.room.push_failures = 0;
+      resetPushes(client);
 
       client->last_activity = getRTCClock()->getCurrentTime();
       client->permissions &= ~0x03;
       client->permissions |= perm;
-      memcpy(client->shared_secret, secret, PUB_KEY_SIZE);
+      acl.setSharedSecret(client, secret);
 
       dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
     }
@@ -351,11 +433,11 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
 
     if (packet->isRouteFlood()) {
       // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the response
-      mesh::Packet *path = createPathReturn(sender, client->shared_secret, packet->path, packet->path_len,
+      mesh::Packet *path = createPathReturn(sender, secret, packet->path, packet->path_len,
                                             PAYLOAD_TYPE_RESPONSE, reply_data, 13);
       if (path) sendFlood(path, SERVER_RESPONSE_DELAY);
     } else {
-      mesh::Packet *reply = createDatagram(PAYLOAD_TYPE_RESPONSE, sender, client->shared_secret, reply_data, 13);
+      mesh::Packet *reply = createDatagram(PAYLOAD_TYPE_RESPONSE, sender, secret, reply_data, 13);
       if (reply) {
         if (client->out_path_len >= 0) { // we have an out_path, so send DIRECT
           sendDirect(reply, client->out_path, client->out_path_len, SERVER_RESPONSE_DELAY);
@@ -381,7 +463,7 @@ void MyMesh::getPeerSharedSecret(uint8_t *dest_secret, int peer_idx) {
   int i = matching_peer_indexes[peer_idx];
   if (i >= 0 && i < acl.getNumClients()) {
     // lookup pre-calculated shared_secret
-    memcpy(dest_secret, acl.getClientByIdx(i)->shared_secret, PUB_KEY_SIZE);
+    memcpy(dest_secret, acl.getSharedSecret(acl.getClientByIdx(i)), PUB_KEY_SIZE);
   } else {
     MESH_DEBUG_PRINTLN("getPeerSharedSecret: Invalid peer idx: %d", i);
   }
@@ -513,10 +595,9 @@ void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx,
         }
         if (forceSince > 0) {
           client->extra.room.sync_since = forceSince; // force-update the 'sync since'
+          resetPushes(client);
         }
 
-        client->extra.room.pending_ack = 0;
-
         // TODO: Throttle KEEP_ALIVE requests!
         // if client sends too quickly, evict()
 
@@ -624,10 +705,9 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   _prefs.gps_interval = 0;
   _prefs.advert_loc_policy = ADVERT_LOC_PREFS;
 
-  next_post_idx = 0;
   next_client_idx = 0;
   next_push = 0;
-  memset(posts, 0, sizeof(posts));
+  memset(pushes, 0, sizeof(pushes));
   _num_posted = _num_post_pushes = 0;
 }
 
@@ -638,6 +718,7 @@ void MyMesh::begin(FILESYSTEM *fs) {
   _cli.loadPrefs(_fs);
 
   acl.load(_fs, self_id);
+  post_store.begin(_fs);
 
   radio_set_params(_prefs.freq, _prefs.bw, _prefs.sf, _prefs.cr);
   radio_set_tx_power(_prefs.tx_power_dbm);
@@ -788,6 +869,12 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
         strcpy(reply, "Err - bad pubkey");
       }
     }
+  } else if (strcmp(command, "posts") == 0) {
+    int n = post_store.getNumPosts();
+    sprintf(reply, "> %d posts, oldest: %u", n, n > 0 ? post_store.getTimestamp(0) : 0);
+  } else if (strcmp(command, "posts.clear") == 0) {
+    post_store.clear();
+    strcpy(reply, "OK - posts cleared");
   } else if (sender_timestamp == 0 && strcmp(command, "get acl") == 0) {
     Serial.println("ACL:");
     for (int i = 0; i < acl.getNumClients(); i++) {
@@ -813,45 +900,36 @@ void MyMesh::loop() {
 
   if (millisHasNowPassed(next_push) && acl.getNumClients() > 0) {
     // check for ACK timeouts
-    for (int i = 0; i < acl.getNumClients(); i++) {
-      auto c = acl.getClientByIdx(i);
-      if (c->extra.room.pending_ack && millisHasNowPassed(c->extra.room.ack_timeout)) {
+    for (int i = 0; i < MAX_PUSHES_IN_FLIGHT; i++) {
+      auto p = &pushes[i];
+      if (p->post_timestamp == 0) continue;
+
+      auto c = acl.getClient((const uint8_t *)&p->client, 4);
+      if (c == NULL) {
+        p->post_timestamp = 0;   // client has gone (eg. removed from ACL), whether timed out or not
+      } else if (p->ack_timeout && millisHasNowPassed(p->ack_timeout)) {
+        p->ack_timeout = 0;   // retry, but keep the expected ACK, incase it arrives LATER
         c->extra.room.push_failures++;
-        c->extra.room.pending_ack = 0; // reset  (TODO: keep prev expected_ack's in a list, incase they arrive LATER, after we retry)
         MESH_DEBUG_PRINTLN("pending ACK timed out: push_failures: %d", (uint32_t)c->extra.room.push_failures);
-      }
-    }
-    // check next Round-Robin client, and sync next new post
-    auto client = acl.getClientByIdx(next_client_idx);
-    bool did_push = false;
-    if (client->extra.room.pending_ack == 0 && client->last_activity != 0 &&
-        client->extra.room.push_failures < 3) { // not already waiting for ACK, AND not evicted, AND retries not max
-      MESH_DEBUG_PRINTLN("loop - checking for client %02X", (uint32_t)client->id.pub_key[0]);
-      uint32_t now = getRTCClock()->getCurrentTime();
-      for (int k = 0, idx = next_post_idx; k < MAX_UNSYNCED_POSTS; k++) {
-        auto p = &posts[idx];
-        if (now >= p->post_timestamp + POST_SYNC_DELAY_SECS &&
-            p->post_timestamp > client->extra.room.sync_since // is new post for this Client?
-            && !p->author.matches(client->id)) {   // don't push posts to the author
-          // push this post to Client, then wait for ACK
-          pushPostToClient(client, *p);
-          did_push = true;
-          MESH_DEBUG_PRINTLN("loop - pushed to client %02X: %s", (uint32_t)client->id.pub_key[0], p->text);
-          break;
+        if (c->extra.room.push_failures >= 3) {
+          releasePushes(c);   // client is probably offline, don't hold slots others could use
         }
-        idx = (idx + 1) % MAX_UNSYNCED_POSTS; // wrap to start of cyclic queue
       }
-    } else {
-      MESH_DEBUG_PRINTLN("loop - skipping busy (or evicted) client %02X", (uint32_t)client->id.pub_key[0]);
     }
-    next_client_idx = (next_client_idx + 1) % acl.getNumClients(); // round robin polling for each client
-
-    if (did_push) {
-      next_push = futureMillis(SYNC_PUSH_INTERVAL);
-    } else {
-      // were no unsynced posts for curr client, so proccess next client much quicker! (in next loop())
-      next_push = futureMillis(SYNC_PUSH_INTERVAL / 8);
+    // fill clients' windows, round robin, but only while outbound queue is short, so pushes are paced by the
+    // Dispatcher's airtime budget, and don't hold up other traffic
+    int num_clients = acl.getNumClients();
+    int num_idle = 0;
+    while (num_idle < num_clients && _mgr->getOutboundCount(0xFFFFFFFF) < PUSH_MAX_QUEUED) {
+      if (next_client_idx >= num_clients) next_client_idx = 0;
+      if (pushNextToClient(acl.getClientByIdx(next_client_idx))) {
+        num_idle = 0;
+      } else {
+        num_idle++;
+      }
+      next_client_idx = (next_client_idx + 1) % num_clients;
     }
+    next_push = futureMillis(SYNC_POLL_INTERVAL);
   }
 
   if (next_flood_advert && millisHasNowPassed(next_flood_advert)) {
@@ -22,6 +22,7 @@
 #include <helpers/ClientACL.h>
 #include <RTClib.h>
 #include <target.h>
+#include "PostStore.h"
 
 /* ------------------------------ Config -------------------------------- */
 
@@ -63,10 +64,6 @@
   #define  ADMIN_PASSWORD  "password"
 #endif
 
-#ifndef MAX_UNSYNCED_POSTS
-  #define MAX_UNSYNCED_POSTS    32
-#endif
-
 #ifndef SERVER_RESPONSE_DELAY
   #define SERVER_RESPONSE_DELAY   300
 #endif
@@ -75,16 +72,25 @@
   #define TXT_ACK_DELAY     200
 #endif
 
+#ifndef PUSH_WINDOW_SIZE
+  #define PUSH_WINDOW_SIZE       4    // max posts awaiting ACK, per client (with a direct path)
+#endif
+#ifndef MAX_PUSHES_IN_FLIGHT
+  #define MAX_PUSHES_IN_FLIGHT  32    // across all clients
+#endif
+#ifndef MAX_SYNC_BACKLOG
+  #define MAX_SYNC_BACKLOG      32    // most recent posts pushed to a client on login (eg. first sync), 0 = all
+#endif
+
 #define FIRMWARE_ROLE "room_server"
 
 #define PACKET_LOG_FILE  "/packet_log"
 
-#define MAX_POST_TEXT_LEN    (160-9)
-
-struct PostInfo {
-  mesh::Identity author;
-  uint32_t post_timestamp;   // by OUR clock
-  char text[MAX_POST_TEXT_LEN+1];
+struct PushInFlight {
+  uint32_t client;            // first 4 bytes of client's pub_key
+  uint32_t post_timestamp;    // zero if slot is unused
+  uint32_t ack, prev_ack;     // expected ACK for this attempt, and previous one (in case it arrives late)
+  unsigned long ack_timeout;  // zero if timed out (needs retry)
 };
 
 class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
@@ -101,8 +107,8 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   unsigned long next_push;
   uint16_t _num_posted, _num_post_pushes;
   int next_client_idx;  // for round-robin polling
-  int next_post_idx;
-  PostInfo posts[MAX_UNSYNCED_POSTS];   // cyclic queue
+  PostStore post_store;
+  PushInFlight pushes[MAX_PUSHES_IN_FLIGHT];
   CayenneLPP telemetry;
   unsigned long set_radio_at, revert_radio_at;
   float pending_freq;
@@ -112,7 +118,11 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   int  matching_peer_indexes[MAX_CLIENTS];
 
   void addPost(ClientInfo* client, const char* postData);
-  void pushPostToClient(ClientInfo* client, PostInfo& post);
+  bool pushPostToClient(ClientInfo* client, PostInfo& post, PushInFlight* slot, int num_ahead);
+  bool pushNextToClient(ClientInfo* client);
+  void updateSyncSince(ClientInfo* client);
+  void releasePushes(ClientInfo* client);
+  void resetPushes(ClientInfo* client);
   uint8_t getUnsyncedCount(ClientInfo* client);
   bool processAck(const uint8_t *data);
   mesh::Packet* createSelfAdvert();
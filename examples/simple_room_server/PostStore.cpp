@@ -0,0 +1,361 @@
+#include "PostStore.h"
+
+#define POST_LOG_MAGIC       0x4C50434D   // "MCPL"
+#define POST_RECORD_MARKER   0xA5
+#define POST_RECORD_HDR_LEN  (4 + PUB_KEY_SIZE + 2)   // timestamp, author, text_len, marker
+#define POST_LOG_READ_BUF    512
+
+#define POSTS_PER_SEGMENT    (MAX_STORED_POSTS / 2)
+#define SEGMENT_MAX_BYTES    (POST_LOG_MAX_BYTES / 2)
+#define SEGMENT_BIT          0x80000000
+
+struct PostLogHeader {
+  uint32_t magic;
+  uint32_t generation;   // higher is newer
+};
+
+static const char* segment_files[2] = { "/post_log0", "/post_log1" };
+static const char* trim_files[2] = { "/post_log0.tmp", "/post_log1.tmp" };
+
+static File openRead(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(filename, FILE_O_READ);
+#else
+  return fs->open(filename, "r");
+#endif
+}
+
+static File openWrite(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  fs->remove(filename);
+  return fs->open(filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return fs->open(filename, "w");
+#else
+  return fs->open(filename, "w", true);
+#endif
+}
+
+static File openAppend(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return fs->open(filename, "a");
+#else
+  return fs->open(filename, "a", true);
+#endif
+}
+
+PostStore::PostStore() {
+  _fs = NULL;
+  num_posts = 0;
+  curr_seg = 0;
+  curr_gen = 0;
+  seg_end[0] = seg_end[1] = 0;
+  seg_count[0] = seg_count[1] = 0;
+  needs_trim = false;
+}
+
+int PostStore::upperBound(uint32_t timestamp) const {   // first index with timestamp > given
+  int lo = 0, hi = num_posts;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (index[mid].timestamp <= timestamp) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+void PostStore::insert(uint32_t timestamp, const uint8_t* author, uint32_t offset) {
+  if (num_posts >= MAX_STORED_POSTS) return;   // shouldn't happen, segments are capped
+
+  int i = upperBound(timestamp);   // usually the end, unless clock has been set backwards
+  memmove(&index[i + 1], &index[i], (num_posts - i) * sizeof(PostIndexEntry));
+  index[i].timestamp = timestamp;
+  memcpy(&index[i].author, author, 4);
+  index[i].offset = offset;
+  num_posts++;
+}
+
+bool PostStore::fitsSegment(uint32_t seg_len, int rec_len) const {
+  return SEGMENT_MAX_BYTES == 0 || seg_len + rec_len <= SEGMENT_MAX_BYTES;
+}
+
+bool PostStore::readGeneration(int seg, uint32_t& gen) {
+  File file = openRead(_fs, segment_files[seg]);
+  if (!file) return false;
+
+  PostLogHeader hdr;
+  bool success = file.read((uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == POST_LOG_MAGIC;
+  file.close();
+  if (success) gen = hdr.generation;
+  return success;
+}
+
+bool PostStore::loadSegment(int seg) {
+  File file = openRead(_fs, segment_files[seg]);
+  if (!file) return false;
+
+  PostLogHeader hdr;
+  if (file.read((uint8_t *) &hdr, sizeof(hdr)) != sizeof(hdr) || hdr.magic != POST_LOG_MAGIC) {
+    file.close();
+    return false;
+  }
+  uint32_t file_size = file.size();
+  uint32_t offset = sizeof(hdr);
+  uint32_t seg_bit = seg ? SEGMENT_BIT : 0;
+  seg_count[seg] = 0;
+
+  // one sequential pass, parsing records out of a buffer
+  uint8_t buf[POST_LOG_READ_BUF];
+  int len = 0;
+  bool done = false;
+  while (!done) {
+    int n = file.read(&buf[len], sizeof(buf) - len);
+    if (n > 0) len += n;
+
+    int pos = 0;
+    while (len - pos >= POST_RECORD_HDR_LEN) {
+      uint8_t text_len = buf[pos + 4 + PUB_KEY_SIZE];
+      if (buf[pos + 5 + PUB_KEY_SIZE] != POST_RECORD_MARKER || text_len > MAX_POST_TEXT_LEN
+          || seg_count[seg] >= POSTS_PER_SEGMENT) {
+        done = true;   // bad record, or over capacity (eg. MAX_STORED_POSTS was reduced)
+        break;
+      }
+      int rec_len = POST_RECORD_HDR_LEN + text_len;
+      if (!fitsSegment(offset, rec_len)) {
+        done = true;   // over capacity (eg. POST_LOG_MAX_BYTES was reduced)
+        break;
+      }
+      if (len - pos < rec_len) break;   // need more
+
+      uint32_t timestamp;
+      memcpy(&timestamp, &buf[pos], 4);
+      insert(timestamp, &buf[pos + 4], seg_bit | offset);
+      seg_count[seg]++;
+      offset += rec_len;
+      pos += rec_len;
+    }
+    memmove(buf, &buf[pos], len - pos);
+    len -= pos;
+    if (n <= 0) done = true;   // EOF
+  }
+  file.close();
+
+  seg_end[seg] = offset;
+  if (offset < file_size && seg == curr_seg) {
+    needs_trim = true;   // don't append after a bad tail
+  }
+  return true;
+}
+
+void PostStore::begin(FILESYSTEM* fs) {
+  _fs = fs;
+  num_posts = 0;
+  needs_trim = false;
+
+  for (int seg = 0; seg < 2; seg++) {   // finish, or undo, an interrupted trimTail()
+    if (!_fs->exists(trim_files[seg])) continue;
+    if (_fs->exists(segment_files[seg])) {
+      _fs->remove(trim_files[seg]);   // copy may be incomplete, original is still intact
+    } else {
+      _fs->rename(trim_files[seg], segment_files[seg]);
+    }
+  }
+
+  uint32_t gen[2];
+  bool valid[2];
+  valid[0] = readGeneration(0, gen[0]);
+  valid[1] = readGeneration(1, gen[1]);
+
+  if (!valid[0] && !valid[1]) {
+    if (!startSegment(0, 1)) {
+      MESH_DEBUG_PRINTLN("PostStore::begin() - unable to create post log");
+    }
+    return;
+  }
+
+  curr_seg = (valid[0] && valid[1]) ? (gen[1] > gen[0] ? 1 : 0) : (valid[0] ? 0 : 1);
+  curr_gen = gen[curr_seg];
+  if (valid[curr_seg ^ 1]) loadSegment(curr_seg ^ 1);   // older first, so index inserts are appends
+  loadSegment(curr_seg);
+  if (needs_trim && trimTail()) needs_trim = false;   // else, add() will try again
+
+  MESH_DEBUG_PRINTLN("PostStore::begin() - %d posts", num_posts);
+}
+
+bool PostStore::startSegment(int seg, uint32_t gen) {
+  File file = openWrite(_fs, segment_files[seg]);
+  if (!file) return false;
+
+  PostLogHeader hdr;
+  hdr.magic = POST_LOG_MAGIC;
+  hdr.generation = gen;
+  bool success = file.write((const uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr);
+  file.close();
+
+  if (success) {
+    curr_seg = seg;
+    curr_gen = gen;
+    seg_end[seg] = sizeof(hdr);
+    seg_count[seg] = 0;
+    needs_trim = false;
+  }
+  return success;
+}
+
+// rewrites current segment up to seg_end, via a copy, so a power loss meanwhile can't lose any posts
+bool PostStore::trimTail() {
+  File src = openRead(_fs, segment_files[curr_seg]);
+  if (!src) return false;
+  File dest = openWrite(_fs, trim_files[curr_seg]);
+  if (!dest) {
+    src.close();
+    return false;
+  }
+
+  uint8_t buf[POST_LOG_READ_BUF];
+  uint32_t remaining = seg_end[curr_seg];
+  bool success = true;
+  while (success && remaining > 0) {
+    int n = remaining < sizeof(buf) ? remaining : sizeof(buf);
+    success = src.read(buf, n) == n && dest.write(buf, n) == n;
+    remaining -= n;
+  }
+  src.close();
+  dest.close();
+
+  if (!success) {
+    _fs->remove(trim_files[curr_seg]);   // eg. filesystem is full
+    return false;
+  }
+  _fs->remove(segment_files[curr_seg]);
+  return _fs->rename(trim_files[curr_seg], segment_files[curr_seg]);
+}
+
+bool PostStore::rotate() {
+  int next = curr_seg ^ 1;
+
+  // drop the oldest segment's posts from index
+  uint32_t seg_bit = next ? SEGMENT_BIT : 0;
+  int j = 0;
+  for (int i = 0; i < num_posts; i++) {
+    if ((index[i].offset & SEGMENT_BIT) != seg_bit) index[j++] = index[i];
+  }
+  num_posts = j;
+  seg_count[next] = 0;
+
+  return startSegment(next, curr_gen + 1);
+}
+
+bool PostStore::add(const mesh::Identity& author, uint32_t timestamp, const char* text) {
+  if (_fs == NULL) return false;
+  if (needs_trim) {
+    if (trimTail()) {
+      needs_trim = false;
+    } else if (!rotate()) {   // can't rewrite it (eg. filesystem full), so free the oldest segment instead
+      return false;
+    }
+  }
+  int text_len = strlen(text);
+  if (text_len > MAX_POST_TEXT_LEN) text_len = MAX_POST_TEXT_LEN;
+  if ((seg_count[curr_seg] >= POSTS_PER_SEGMENT || !fitsSegment(seg_end[curr_seg], POST_RECORD_HDR_LEN + text_len))
+      && !rotate()) {
+    return false;
+  }
+
+  if (!append(author, timestamp, text)) {
+    MESH_DEBUG_PRINTLN("PostStore::add() - write failed, erasing oldest posts");
+    if (!rotate() || !append(author, timestamp, text)) {   // filesystem may be full, so free the oldest segment
+      needs_trim = true;   // tail may now be partial
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PostStore::append(const mesh::Identity& author, uint32_t timestamp, const char* text) {
+  uint8_t hdr[POST_RECORD_HDR_LEN];
+  int text_len = strlen(text);
+  if (text_len > MAX_POST_TEXT_LEN) text_len = MAX_POST_TEXT_LEN;
+  memcpy(hdr, &timestamp, 4);
+  memcpy(&hdr[4], author.pub_key, PUB_KEY_SIZE);
+  hdr[4 + PUB_KEY_SIZE] = text_len;
+  hdr[5 + PUB_KEY_SIZE] = POST_RECORD_MARKER;
+
+  File file = openAppend(_fs, segment_files[curr_seg]);
+  if (!file) return false;
+  bool success = file.write(hdr, sizeof(hdr)) == sizeof(hdr)
+              && file.write((const uint8_t *) text, text_len) == text_len;
+  file.close();
+
+  if (!success) return false;
+
+  insert(timestamp, author.pub_key, (curr_seg ? SEGMENT_BIT : 0) | seg_end[curr_seg]);
+  seg_end[curr_seg] += sizeof(hdr) + text_len;
+  seg_count[curr_seg]++;
+  return true;
+}
+
+void PostStore::clear() {
+  if (_fs == NULL) return;
+
+  _fs->remove(segment_files[curr_seg ^ 1]);
+  num_posts = 0;
+  seg_count[0] = seg_count[1] = 0;
+  startSegment(curr_seg, curr_gen + 1);
+}
+
+int PostStore::findNext(uint32_t since, uint32_t until, const uint8_t* exclude_author) const {
+  uint32_t exclude;
+  memcpy(&exclude, exclude_author, 4);
+  for (int i = upperBound(since); i < num_posts && index[i].timestamp <= until; i++) {
+    if (index[i].author != exclude) return i;
+  }
+  return -1;
+}
+
+int PostStore::countAfter(uint32_t since, const uint8_t* exclude_author, int max) const {
+  uint32_t exclude;
+  memcpy(&exclude, exclude_author, 4);
+  int count = 0;
+  for (int i = upperBound(since); i < num_posts && count < max; i++) {
+    if (index[i].author != exclude) count++;
+  }
+  return count;
+}
+
+uint32_t PostStore::limitBacklog(uint32_t since, const uint8_t* exclude_author, int max) const {
+  uint32_t exclude;
+  memcpy(&exclude, exclude_author, 4);
+  int count = 0;
+  for (int i = num_posts - 1; i >= 0 && index[i].timestamp > since; i--) {
+    if (index[i].author != exclude && ++count > max) return index[i].timestamp;   // only 'max' posts are newer
+  }
+  return since;
+}
+
+bool PostStore::read(int idx, PostInfo& post) {
+  if (_fs == NULL || idx < 0 || idx >= num_posts) return false;
+
+  int seg = (index[idx].offset & SEGMENT_BIT) ? 1 : 0;
+  File file = openRead(_fs, segment_files[seg]);
+  if (!file) return false;
+
+  uint8_t hdr[POST_RECORD_HDR_LEN];
+  file.seek(index[idx].offset & ~SEGMENT_BIT);
+  bool success = file.read(hdr, sizeof(hdr)) == sizeof(hdr) && hdr[5 + PUB_KEY_SIZE] == POST_RECORD_MARKER;
+  if (success) {
+    int text_len = hdr[4 + PUB_KEY_SIZE];
+    if (text_len > MAX_POST_TEXT_LEN) text_len = MAX_POST_TEXT_LEN;
+    success = file.read((uint8_t *) post.text, text_len) == text_len;
+    post.text[text_len] = 0;
+    memcpy(&post.post_timestamp, hdr, 4);
+    post.author = mesh::Identity(&hdr[4]);
+  }
+  file.close();
+  return success;
+}
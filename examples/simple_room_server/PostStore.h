@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Mesh.h>
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+
+#ifndef MAX_STORED_POSTS
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define MAX_STORED_POSTS   64     // small internal filesystem
+  #else
+    #define MAX_STORED_POSTS   2048
+  #endif
+#endif
+
+#ifndef POST_LOG_MAX_BYTES
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define POST_LOG_MAX_BYTES   8192   // of the ~28KB InternalFS, so ACL, prefs, etc. can still be saved
+  #else
+    #define POST_LOG_MAX_BYTES   0      // no limit, other than MAX_STORED_POSTS
+  #endif
+#endif
+
+#define MAX_POST_TEXT_LEN    (160-9)
+
+struct PostInfo {
+  mesh::Identity author;
+  uint32_t post_timestamp;   // by OUR clock
+  char text[MAX_POST_TEXT_LEN+1];
+};
+
+struct PostIndexEntry {
+  uint32_t timestamp;
+  uint32_t author;   // first 4 bytes of author's pub_key (as sent in pushes)
+  uint32_t offset;   // of record in log, top bit is the segment
+};
+
+/**
+ * \brief  Room posts, as an append-only log in flash, with a RAM index sorted by post_timestamp. The log is two
+ *   segment files, each of up to MAX_STORED_POSTS/2 posts (and POST_LOG_MAX_BYTES/2 bytes). When the current one is
+ *   full, the other (oldest) is erased, and appending continues there, so between one and two segments of the most
+ *   recent posts are kept (or fewer, if the filesystem fills up first). Index is rebuilt on boot, from one sequential read
+ *   of each segment. A bad tail on the current segment (eg. power lost mid-append) is trimmed off before appending.
+ */
+class PostStore {
+  FILESYSTEM* _fs;
+  PostIndexEntry index[MAX_STORED_POSTS];
+  int num_posts;
+  uint8_t curr_seg;
+  uint32_t curr_gen;
+  uint32_t seg_end[2];     // append offset
+  uint16_t seg_count[2];
+  bool needs_trim;         // current segment has a bad tail (eg. power lost mid-append)
+
+  int upperBound(uint32_t timestamp) const;
+  void insert(uint32_t timestamp, const uint8_t* author, uint32_t offset);
+  bool fitsSegment(uint32_t seg_len, int rec_len) const;
+  bool readGeneration(int seg, uint32_t& gen);
+  bool loadSegment(int seg);
+  bool startSegment(int seg, uint32_t gen);
+  bool rotate();
+  bool trimTail();
+  bool append(const mesh::Identity& author, uint32_t timestamp, const char* text);
+
+public:
+  PostStore();
+
+  void begin(FILESYSTEM* fs);
+  bool add(const mesh::Identity& author, uint32_t timestamp, const char* text);
+  void clear();
+
+  /**
+   * \returns  index of oldest post with timestamp in (since, until], not by 'exclude_author', or -1 if none
+   */
+  int findNext(uint32_t since, uint32_t until, const uint8_t* exclude_author) const;
+
+  /**
+   * \returns  number of posts after 'since', not by 'exclude_author' (counts no further than 'max')
+   */
+  int countAfter(uint32_t since, const uint8_t* exclude_author, int max) const;
+
+  /**
+   * \returns  'since', moved forward (if needed) so that at most 'max' posts after it are not by 'exclude_author'
+   */
+  uint32_t limitBacklog(uint32_t since, const uint8_t* exclude_author, int max) const;
+
+  bool read(int idx, PostInfo& post);
+  int getNumPosts() const { return num_posts; }
+  uint32_t getTimestamp(int idx) const { return index[idx].timestamp; }
+};
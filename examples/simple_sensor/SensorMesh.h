@@ -152,7 +152,7 @@ private:
   uint8_t handleRequest(uint8_t perms, uint32_t sender_timestamp, uint8_t req_type, uint8_t* payload, size_t payload_len);
   mesh::Packet* createSelfAdvert();
 
-  void sendAlert(const ClientInfo* c, Trigger* t);
+  void sendAlert(ClientInfo* c, Trigger* t);
 
   #if ENV_INCLUDE_GPS == 1
   void applyGpsPrefs() {
@@ -17,6 +17,7 @@ namespace mesh {
 void Dispatcher::begin() {
   n_sent_flood = n_sent_direct = 0;
   n_recv_flood = n_recv_direct = 0;
+  n_lbt_checks = n_lbt_busy = n_lbt_deferred = n_lbt_forced = 0;
   _err_flags = 0;
   radio_nonrx_start = _ms->getMillis();
 
@@ -32,7 +33,7 @@ int Dispatcher::calcRxDelay(float score, uint32_t air_time) const {
   return (int) ((pow(10, 0.85f - score) - 1.0) * air_time);
 }
 
-uint32_t Dispatcher::getCADFailRetryDelay() const {
+uint32_t Dispatcher::getCADFailRetryDelay(uint8_t priority, uint8_t attempt) const {
   return 200;
 }
 uint32_t Dispatcher::getCADFailMaxDuration() const {
@@ -226,23 +227,38 @@ void Dispatcher::processRecvPacket(Packet* pkt) {
 void Dispatcher::checkSend() {
   if (_mgr->getOutboundCount(_ms->getMillis()) == 0) return;  // nothing waiting to send
   if (!millisHasNowPassed(next_tx_time)) return;   // still in 'radio silence' phase (from airtime budget setting)
+
+  uint8_t priority = _mgr->getNextOutboundPriority(_ms->getMillis());
+  n_lbt_checks++;
   if (_radio->isReceiving()) {   // LBT - check if radio is currently mid-receive, or if channel activity
+    n_lbt_busy++;
     if (cad_busy_start == 0) {
       cad_busy_start = _ms->getMillis();   // record when CAD busy state started
     }
 
     if (_ms->getMillis() - cad_busy_start > getCADFailMaxDuration()) {
       _err_flags |= ERR_EVENT_CAD_TIMEOUT;
+      n_lbt_forced++;
 
       MESH_DEBUG_PRINTLN("%s Dispatcher::checkSend(): CAD busy max duration reached!", getLogDateTime());
       // channel activity has gone on too long... (Radio might be in a bad state)
       // force the pending transmit below...
     } else {
-      next_tx_time = futureMillis(getCADFailRetryDelay());
+      next_tx_time = futureMillis(getCADFailRetryDelay(priority, cad_attempts));   // back off, window grows with each attempt
+      if (cad_attempts < 0xFF) cad_attempts++;
+      return;
+    }
+  } else if (cad_attempts > 0) {   // channel has just gone clear, but others may also be waiting for it
+    uint32_t defer = getTxDeferDelay(priority, cad_attempts);
+    if (defer > 0) {
+      n_lbt_deferred++;
+      cad_busy_start = 0;   // channel was seen clear, so radio isn't stuck
+      next_tx_time = futureMillis(defer);
       return;
     }
   }
   cad_busy_start = 0;  // reset busy state
+  cad_attempts = 0;
 
   outbound = _mgr->getNextOutbound(_ms->getMillis());
   if (outbound) {
@@ -76,6 +76,13 @@ public:
 
   virtual float getLastRSSI() const { return 0; }
   virtual float getLastSNR() const { return 0; }
+
+  /**
+   * \brief  for exclusive access to the underlying radio driver (eg. to change its params) from outside this interface,
+   *     when the radio is serviced by another task. (see QueuedRadio)
+   */
+  virtual void lock() { }
+  virtual void unlock() { }
 };
 
 /**
@@ -89,6 +96,7 @@ public:
 
   virtual void queueOutbound(Packet* packet, uint8_t priority, uint32_t scheduled_for) = 0;
   virtual Packet* getNextOutbound(uint32_t now) = 0;    // by priority
+  virtual uint8_t getNextOutboundPriority(uint32_t now) const = 0;   // of packet getNextOutbound() would return
   virtual int getOutboundCount(uint32_t now) const = 0;
   virtual int getFreeCount() const = 0;
   virtual Packet* getOutboundByIdx(int i) = 0;
@@ -117,11 +125,13 @@ class Dispatcher {
   unsigned long outbound_expiry, outbound_start, total_air_time, rx_air_time;
   unsigned long next_tx_time;
   unsigned long cad_busy_start;
+  uint8_t cad_attempts;   // consecutive LBT busy checks, for the backoff window
   unsigned long radio_nonrx_start;
   unsigned long next_floor_calib_time, next_agc_reset_time;
   bool  prev_isrecv_mode;
   uint32_t n_sent_flood, n_sent_direct;
   uint32_t n_recv_flood, n_recv_direct;
+  uint32_t n_lbt_checks, n_lbt_busy, n_lbt_deferred, n_lbt_forced;
 
   void processRecvPacket(Packet* pkt);
 
@@ -138,6 +148,8 @@ protected:
     total_air_time = rx_air_time = 0;
     next_tx_time = 0;
     cad_busy_start = 0;
+    cad_attempts = 0;
+    n_lbt_checks = n_lbt_busy = n_lbt_deferred = n_lbt_forced = 0;
     next_floor_calib_time = next_agc_reset_time = 0;
     _err_flags = 0;
     radio_nonrx_start = 0;
@@ -155,8 +167,9 @@ protected:
 
   virtual float getAirtimeBudgetFactor() const;
   virtual int calcRxDelay(float score, uint32_t air_time) const;
-  virtual uint32_t getCADFailRetryDelay() const;
+  virtual uint32_t getCADFailRetryDelay(uint8_t priority, uint8_t attempt) const;   // backoff, after 'attempt' busy checks
   virtual uint32_t getCADFailMaxDuration() const;
+  virtual uint32_t getTxDeferDelay(uint8_t priority, uint8_t attempt) const { return 0; }   // p-persistence, 0 = send now
   virtual int getInterferenceThreshold() const { return 0; }    // disabled by default
   virtual int getAGCResetInterval() const { return 0; }    // disabled by default
 
@@ -174,8 +187,13 @@ public:
   uint32_t getNumSentDirect() const { return n_sent_direct; }
   uint32_t getNumRecvFlood() const { return n_recv_flood; }
   uint32_t getNumRecvDirect() const { return n_recv_direct; }
+  uint32_t getNumLBTChecks() const { return n_lbt_checks; }
+  uint32_t getNumLBTBusy() const { return n_lbt_busy; }   // busy ratio = busy / checks
+  uint32_t getNumLBTDeferred() const { return n_lbt_deferred; }
+  uint32_t getNumLBTForced() const { return n_lbt_forced; }
   void resetStats() {
     n_sent_flood = n_sent_direct = n_recv_flood = n_recv_direct = 0;
+    n_lbt_checks = n_lbt_busy = n_lbt_deferred = n_lbt_forced = 0;
     _err_flags = 0;
   }
 
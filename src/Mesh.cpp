@@ -1,8 +1,25 @@
 #include "Mesh.h"
 //#include <Arduino.h>
 
+#ifndef LBT_SLOT_MILLIS
+  #define LBT_SLOT_MILLIS       120
+#endif
+#ifndef LBT_MAX_BACKOFF_EXP
+  #define LBT_MAX_BACKOFF_EXP   4      // ie. max window of 16 slots
+#endif
+
 namespace mesh {
 
+// contention window (as power of 2), and persistence (out of 256), per priority class
+static const uint8_t lbt_min_exp[] = { 1, 2, 3 };
+static const uint16_t lbt_persistence[] = { 256, 192, 128 };
+
+static int getLBTClass(uint8_t priority) {
+  if (priority == 0) return 0;   // direct/routed, and ACKs
+  if (priority <= 2) return 1;
+  return 2;    // adverts, and far-away floods
+}
+
 void Mesh::begin() {
   Dispatcher::begin();
 }
@@ -26,8 +43,14 @@ uint8_t Mesh::getExtraAckTransmitCount() const {
   return 0;
 }
 
-uint32_t Mesh::getCADFailRetryDelay() const {
-  return _rng->nextInt(1, 4)*120;
+uint32_t Mesh::getCADFailRetryDelay(uint8_t priority, uint8_t attempt) const {
+  int e = lbt_min_exp[getLBTClass(priority)] + attempt;
+  if (e > LBT_MAX_BACKOFF_EXP) e = LBT_MAX_BACKOFF_EXP;
+  return _rng->nextInt(1, (1 << e) + 1)*LBT_SLOT_MILLIS;
+}
+uint32_t Mesh::getTxDeferDelay(uint8_t priority, uint8_t attempt) const {
+  if (_rng->nextInt(0, 256) < lbt_persistence[getLBTClass(priority)]) return 0;   // transmit now
+  return LBT_SLOT_MILLIS;
 }
 
 int Mesh::searchPeersByHash(const uint8_t* hash) {
@@ -195,7 +218,7 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
       if (i + 2 >= pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete data packet", getLogDateTime());
       } else if (!_tables->hasSeen(pkt)) {
-        if (self_id.isHashMatch(&dest_hash)) {
+        if (self_id.isHashMatch(&dest_hash) && allowAnonRequest(pkt, sender_pub_key)) {
           Identity sender(sender_pub_key);
 
           uint8_t secret[PUB_KEY_SIZE];
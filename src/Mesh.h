@@ -36,7 +36,17 @@ class Mesh : public Dispatcher {
 protected:
   DispatcherAction onRecvPacket(Packet* pkt) override;
 
-  virtual uint32_t getCADFailRetryDelay() const override;
+  /**
+   * \brief  LBT binary exponential backoff. Contention window starts at 2, 4 or 8 slots (by priority class), and
+   *     doubles with each busy attempt, up to LBT_MAX_BACKOFF_EXP.
+   */
+  virtual uint32_t getCADFailRetryDelay(uint8_t priority, uint8_t attempt) const override;
+
+  /**
+   * \brief  p-persistence, once channel is clear after backing off, transmit now with probability by priority class,
+   *     otherwise defer one slot.
+   */
+  virtual uint32_t getTxDeferDelay(uint8_t priority, uint8_t attempt) const override;
 
   /**
    * \brief  Decide what to do with received packet, ie. discard, forward, or hold
@@ -76,6 +86,13 @@ protected:
    */
   virtual int searchPeersByHash(const uint8_t* hash);
 
+  /**
+   * \brief  Called for an anonymous request addressed to this node, _before_ the (expensive) shared-secret is calculated.
+   * \param  sender_pub_key  the claimed public key of sender (PUB_KEY_SIZE bytes)
+   * \returns  false, to drop the request
+   */
+  virtual bool allowAnonRequest(const Packet* packet, const uint8_t* sender_pub_key) { return true; }
+
   /**
    * \brief  lookup the ECDH shared-secret between this node and peer by idx (calculate if necessary)
    * \param  dest_secret  destination array to copy the secret (must be PUB_KEY_SIZE bytes)
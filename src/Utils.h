@@ -82,6 +82,11 @@ public:
   static int parseTextParts(char* text, const char* parts[], int max_num, char separator=',');
 
   static bool isHexChar(char c);
+
+  /**
+   * \brief  calculates the CRC-32 (IEEE) of 'data'. Can be chained, by passing a previous result as 'crc'.
+  */
+  static uint32_t crc32(const uint8_t* data, int len, uint32_t crc=0);
 };
 
 }
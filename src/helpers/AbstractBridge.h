@@ -43,4 +43,13 @@ public:
    * @param packet The packet that was received.
    */
   virtual void onPacketReceived(mesh::Packet* packet) = 0;
+
+  /**
+   * @brief Sends a stats push frame (not a mesh packet) over the bridge's medium, for an external collector.
+   *        Bridges which don't support this ignore it.
+   *
+   * @param frame The stats frame.
+   * @param len Length of the frame in bytes.
+   */
+  virtual void sendStats(const uint8_t* frame, int len) { }
 };
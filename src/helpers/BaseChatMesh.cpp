@@ -67,9 +67,130 @@ void BaseChatMesh::bootstrapRTCfromContacts() {
   }
 }
 
+void BaseChatMesh::linkContactIdx(int idx) {
+  int16_t* link = &contact_buckets[contacts[idx].id.pub_key[0]];
+  while (*link >= 0 && *link < idx) {   // keep chains in contacts[] order, so lookups match a linear scan
+    link = &contact_next[*link];
+  }
+  contact_next[idx] = *link;
+  *link = idx;
+
+  linkRecentIdx(idx);
+  contact_geo.put(idx, contacts[idx].gps_lat, contacts[idx].gps_lon, contacts[idx].type);
+}
+
+void BaseChatMesh::unlinkContactIdx(int idx) {
+  unlinkRecentIdx(idx);
+  contact_geo.remove(idx);
+
+  int16_t* link = &contact_buckets[contacts[idx].id.pub_key[0]];
+  while (*link >= 0) {
+    if (*link == idx) {
+      *link = contact_next[idx];
+      return;
+    }
+    link = &contact_next[*link];
+  }
+}
+
+void BaseChatMesh::linkRecentIdx(int idx) {
+  uint32_t ts = contacts[idx].last_advert_timestamp;
+  int prev = -1;
+  int i = recent_head;
+  // while loading, contacts come in table order, so a sorted insert for each would be O(n^2)
+  while (recent_sorted && i >= 0 && contacts[i].last_advert_timestamp > ts) {   // usually stops at head, ie. fresh advert
+    prev = i;
+    i = recent_next[i];
+  }
+  recent_prev[idx] = prev;
+  recent_next[idx] = i;
+  if (prev >= 0) recent_next[prev] = idx; else recent_head = idx;
+  if (i >= 0) recent_prev[i] = idx;
+}
+
+void BaseChatMesh::unlinkRecentIdx(int idx) {
+  int prev = recent_prev[idx];
+  int next = recent_next[idx];
+  if (prev >= 0) recent_next[prev] = next; else recent_head = next;
+  if (next >= 0) recent_prev[next] = prev;
+}
+
+// merge sort of the recency list, in place (no extra RAM), then relink recent_prev[]
+void BaseChatMesh::sortRecentIdx() {
+  int head = recent_head;
+  for (int width = 1; ; width *= 2) {
+    int p = head, tail = -1, num_merges = 0;
+    head = -1;
+    while (p >= 0) {   // merge each pair of 'width' long runs
+      num_merges++;
+      int q = p, p_len = 0, q_len = width;
+      while (p_len < width && q >= 0) {
+        p_len++;
+        q = recent_next[q];
+      }
+      while (p_len > 0 || (q_len > 0 && q >= 0)) {
+        int e;
+        if (p_len > 0 && (q_len == 0 || q < 0 || contacts[p].last_advert_timestamp >= contacts[q].last_advert_timestamp)) {
+          e = p; p = recent_next[p]; p_len--;
+        } else {
+          e = q; q = recent_next[q]; q_len--;
+        }
+        if (tail >= 0) recent_next[tail] = e; else head = e;
+        tail = e;
+      }
+      p = q;
+    }
+    if (tail >= 0) recent_next[tail] = -1;
+    if (num_merges <= 1) break;
+  }
+
+  recent_head = head;
+  int prev = -1;
+  for (int i = head; i >= 0; i = recent_next[i]) {
+    recent_prev[i] = prev;
+    prev = i;
+  }
+  recent_sorted = true;
+}
+
+void BaseChatMesh::onContactUpdated(const ContactInfo& contact) {
+  int idx = &contact - contacts;
+  if (idx >= 0 && idx < num_contacts) {
+    unlinkRecentIdx(idx);
+    linkRecentIdx(idx);
+    contact_geo.put(idx, contact.gps_lat, contact.gps_lon, contact.type);
+  }
+}
+
+void BaseChatMesh::removeContactIdx(int idx) {
+  unlinkContactIdx(idx);
+  contact_geo.removeShift(idx, num_contacts);
+
+  num_contacts--;
+  for (int i = idx; i < num_contacts; i++) {
+    contacts[i] = contacts[i + 1];
+    contact_next[i] = contact_next[i + 1];
+    recent_prev[i] = recent_prev[i + 1];
+    recent_next[i] = recent_next[i + 1];
+  }
+
+  // all links to slots above removed one have shifted down
+  #define SHIFT_LINK(x)  if ((x) > idx) (x)--
+  for (int b = 0; b < CONTACT_HASH_BUCKETS; b++) {
+    SHIFT_LINK(contact_buckets[b]);
+  }
+  for (int i = 0; i < num_contacts; i++) {
+    SHIFT_LINK(contact_next[i]);
+    SHIFT_LINK(recent_prev[i]);
+    SHIFT_LINK(recent_next[i]);
+  }
+  SHIFT_LINK(recent_head);
+  #undef SHIFT_LINK
+}
+
 ContactInfo* BaseChatMesh::allocateContactSlot() {
   if (num_contacts < MAX_CONTACTS) {
-    return &contacts[num_contacts++];
+    return &contacts[num_contacts++];   // NOTE: caller must linkContactIdx() once id is populated
   } else if (shouldOverwriteWhenFull()) {
     // Find oldest non-favourite contact by oldest lastmod timestamp
     int oldest_idx = -1;
@@ -83,6 +204,7 @@ ContactInfo* BaseChatMesh::allocateContactSlot() {
     }
     if (oldest_idx >= 0) {
       onContactOverwrite(contacts[oldest_idx].id.pub_key);
+      unlinkContactIdx(oldest_idx);
       return &contacts[oldest_idx];
     }
   }
@@ -110,15 +232,11 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
     return;
   }
 
-  ContactInfo* from = NULL;
-  for (int i = 0; i < num_contacts; i++) {
-    if (id.matches(contacts[i].id)) {  // is from one of our contacts
-      from = &contacts[i];
-      if (timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
-        MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
-        return;
-      }
-      break;
+  ContactInfo* from = lookupContactByPubKey(id.pub_key, PUB_KEY_SIZE);
+  if (from) {  // is from one of our contacts
+    if (timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
+      MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
+      return;
     }
   }
 
@@ -132,6 +250,9 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
     packet->header = save;
   }
 
+  // periodic re-adverts are mostly identical, so avoid needless flash writes
+  bool save_blob = from == NULL || !isAdvertBlobCurrent(id.pub_key, timestamp, app_data, app_data_len);
+
   bool is_new = false; // true = not in contacts[], false = exists in contacts[]
   if (from == NULL) {
     if (!shouldAutoAddContactType(parser.getType())) {
@@ -153,10 +274,10 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
     
     populateContactFromAdvert(*from, id, parser, timestamp);
     from->sync_since = 0;
-    from->shared_secret_valid = false;
+    linkContactIdx(from - contacts);
   }
   // update
-    putBlobByKey(id.pub_key, PUB_KEY_SIZE, temp_buf, plen);
+    if (save_blob) putBlobByKey(id.pub_key, PUB_KEY_SIZE, temp_buf, plen);
     StrHelper::strncpy(from->name, parser.getName(), sizeof(from->name));
     from->type = parser.getType();
     if (parser.hasLatLon()) {
@@ -165,13 +286,32 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
     }
     from->last_advert_timestamp = timestamp;
     from->lastmod = getRTCClock()->getCurrentTime();
+    onContactUpdated(*from);
 
   onDiscoveredContact(*from, is_new, packet->path_len, packet->path);       // let UI know
 }
 
+bool BaseChatMesh::isAdvertBlobCurrent(const uint8_t* pub_key, uint32_t timestamp, const uint8_t* app_data, size_t app_data_len) {
+  uint8_t prev[256];
+  int len = getBlobByKey(pub_key, PUB_KEY_SIZE, prev);
+  if (len < 2) return false;   // not stored
+
+  int i = 2 + prev[1];   // skip header, path_len, path  (blobs never have transport codes)
+  if (i + PUB_KEY_SIZE + 4 + SIGNATURE_SIZE > len) return false;
+  if (memcmp(&prev[i], pub_key, PUB_KEY_SIZE) != 0) return false;   // blob keys may only be a prefix
+  i += PUB_KEY_SIZE;
+
+  uint32_t prev_timestamp;
+  memcpy(&prev_timestamp, &prev[i], 4); i += 4;
+  i += SIGNATURE_SIZE;
+  if (timestamp - prev_timestamp >= ADVERT_BLOB_REFRESH_SECS) return false;   // due for refresh
+
+  return len - i == (int)app_data_len && memcmp(&prev[i], app_data, app_data_len) == 0;
+}
+
 int BaseChatMesh::searchPeersByHash(const uint8_t* hash) {
   int n = 0;
-  for (int i = 0; i < num_contacts && n < MAX_SEARCH_RESULTS; i++) {
+  for (int i = contact_buckets[hash[0]]; i >= 0 && n < MAX_SEARCH_RESULTS; i = contact_next[i]) {
     if (contacts[i].id.isHashMatch(hash)) {
       matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
     }
@@ -179,10 +319,29 @@ int BaseChatMesh::searchPeersByHash(const uint8_t* hash) {
   return n;
 }
 
+const uint8_t* BaseChatMesh::getSharedSecret(const ContactInfo& contact) {
+  int lru_idx = 0;
+  for (int i = 0; i < CONTACT_SECRET_CACHE_SIZE; i++) {
+    auto e = &secret_cache[i];
+    if (e->last_used && memcmp(e->pub_key, contact.id.pub_key, PUB_KEY_SIZE) == 0) {
+      e->last_used = ++secret_cache_ticks;
+      return e->secret;
+    }
+    if (e->last_used < secret_cache[lru_idx].last_used) lru_idx = i;
+  }
+
+  // not cached (or was evicted), so need to recalc
+  auto e = &secret_cache[lru_idx];
+  memcpy(e->pub_key, contact.id.pub_key, PUB_KEY_SIZE);
+  self_id.calcSharedSecret(e->secret, contact.id.pub_key);
+  e->last_used = ++secret_cache_ticks;
+  return e->secret;
+}
+
 void BaseChatMesh::getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) {
   int i = matching_peer_indexes[peer_idx];
   if (i >= 0 && i < num_contacts) {
-    memcpy(dest_secret, contacts[i].getSharedSecret(self_id), PUB_KEY_SIZE);
+    memcpy(dest_secret, getSharedSecret(contacts[i]), PUB_KEY_SIZE);
   } else {
     MESH_DEBUG_PRINTLN("getPeerSharedSecret: Invalid peer idx: %d", i);
   }
@@ -327,7 +486,7 @@ void BaseChatMesh::onAckRecv(mesh::Packet* packet, uint32_t ack_crc) {
 void BaseChatMesh::handleReturnPathRetry(const ContactInfo& contact, const uint8_t* path, uint8_t path_len) {
   // NOTE: simplest impl is just to re-send a reciprocal return path to sender (DIRECTLY)
   //        override this method in various firmwares, if there's a better strategy
-  mesh::Packet* rpath = createPathReturn(contact.id, contact.getSharedSecret(self_id), path, path_len, 0, NULL, 0);
+  mesh::Packet* rpath = createPathReturn(contact.id, getSharedSecret(contact), path, path_len, 0, NULL, 0);
   if (rpath) sendDirect(rpath, contact.out_path, contact.out_path_len, 3000);   // 3 second delay
 }
 
@@ -376,7 +535,7 @@ mesh::Packet* BaseChatMesh::composeMsgPacket(const ContactInfo& recipient, uint3
     temp[len++] = attempt;  // hide attempt number at tail end of payload
   }
 
-  return createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, recipient.getSharedSecret(self_id), temp, len);
+  return createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, getSharedSecret(recipient), temp, len);
 }
 
 int  BaseChatMesh::sendMessage(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char* text, uint32_t& expected_ack, uint32_t& est_timeout) {
@@ -407,7 +566,7 @@ int  BaseChatMesh::sendCommandData(const ContactInfo& recipient, uint32_t timest
   temp[4] = (attempt & 3) | (TXT_TYPE_CLI_DATA << 2);
   memcpy(&temp[5], text, text_len + 1);
 
-  auto pkt = createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, recipient.getSharedSecret(self_id), temp, 5 + text_len);
+  auto pkt = createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, getSharedSecret(recipient), temp, 5 + text_len);
   if (pkt == NULL) return MSG_SEND_FAILED;
 
   uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -496,7 +655,7 @@ int BaseChatMesh::sendLogin(const ContactInfo& recipient, const char* password,
       tlen = 4 + len;
     }
 
-    pkt = createAnonDatagram(PAYLOAD_TYPE_ANON_REQ, self_id, recipient.id, recipient.getSharedSecret(self_id), temp, tlen);
+    pkt = createAnonDatagram(PAYLOAD_TYPE_ANON_REQ, self_id, recipient.id, getSharedSecret(recipient), temp, tlen);
   }
   if (pkt) {
     uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -521,7 +680,7 @@ int BaseChatMesh::sendAnonReq(const ContactInfo& recipient, const uint8_t* data,
     memcpy(temp, &tag, 4);   // tag to match later (also extra blob to help make packet_hash unique)
     memcpy(&temp[4], data, len);
 
-    pkt = createAnonDatagram(PAYLOAD_TYPE_ANON_REQ, self_id, recipient.id, recipient.getSharedSecret(self_id), temp, 4 + len);
+    pkt = createAnonDatagram(PAYLOAD_TYPE_ANON_REQ, self_id, recipient.id, getSharedSecret(recipient), temp, 4 + len);
   }
   if (pkt) {
     uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -548,7 +707,7 @@ int  BaseChatMesh::sendRequest(const ContactInfo& recipient, const uint8_t* req_
     memcpy(temp, &tag, 4);   // mostly an extra blob to help make packet_hash unique
     memcpy(&temp[4], req_data, data_len);
 
-    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, recipient.getSharedSecret(self_id), temp, 4 + data_len);
+    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, getSharedSecret(recipient), temp, 4 + data_len);
   }
   if (pkt) {
     uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -575,7 +734,7 @@ int  BaseChatMesh::sendRequest(const ContactInfo& recipient, uint8_t req_type, u
     memset(&temp[5], 0, 4);  // reserved (possibly for 'since' param)
     getRNG()->random(&temp[9], 4);   // random blob to help make packet-hash unique
 
-    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, recipient.getSharedSecret(self_id), temp, sizeof(temp));
+    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, getSharedSecret(recipient), temp, sizeof(temp));
   }
   if (pkt) {
     uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -698,7 +857,7 @@ void BaseChatMesh::checkConnections() {
       // calc expected ACK reply
       mesh::Utils::sha256((uint8_t *)&connections[i].expected_ack, 4, data, 9, self_id.pub_key, PUB_KEY_SIZE);
 
-      auto pkt = createDatagram(PAYLOAD_TYPE_REQ, contact->id, contact->getSharedSecret(self_id), data, 9);
+      auto pkt = createDatagram(PAYLOAD_TYPE_REQ, contact->id, getSharedSecret(*contact), data, 9);
       if (pkt) {
         sendDirect(pkt, contact->out_path, contact->out_path_len);
       }
@@ -713,30 +872,13 @@ void BaseChatMesh::resetPathTo(ContactInfo& recipient) {
   recipient.out_path_len = -1;
 }
 
-static ContactInfo* table;  // pass via global :-(
-
-static int cmp_adv_timestamp(const void *a, const void *b) {
-  int a_idx = *((int *)a);
-  int b_idx = *((int *)b);
-  if (table[b_idx].last_advert_timestamp > table[a_idx].last_advert_timestamp) return 1;
-  if (table[b_idx].last_advert_timestamp < table[a_idx].last_advert_timestamp) return -1;
-  return 0;
-}
-
 void BaseChatMesh::scanRecentContacts(int last_n, ContactVisitor* visitor) {
-  for (int i = 0; i < num_contacts; i++) {  // sort the INDEXES into contacts[]
-    sort_array[i] = i;
-  }
-  table = contacts; // pass via global *sigh* :-(
-  qsort(sort_array, num_contacts, sizeof(sort_array[0]), cmp_adv_timestamp);
-
   if (last_n == 0) {
     last_n = num_contacts;   // scan ALL
-  } else {
-    if (last_n > num_contacts) last_n = num_contacts;
   }
-  for (int i = 0; i < last_n; i++) {
-    visitor->onContactVisit(contacts[sort_array[i]]);
+  if (!recent_sorted) sortRecentIdx();   // first scan since contacts were loaded
+  for (int i = recent_head; i >= 0 && last_n > 0; i = recent_next[i], last_n--) {
+    visitor->onContactVisit(contacts[i]);
   }
 }
 
@@ -750,36 +892,41 @@ ContactInfo* BaseChatMesh::searchContactsByPrefix(const char* name_prefix) {
 }
 
 ContactInfo* BaseChatMesh::lookupContactByPubKey(const uint8_t* pub_key, int prefix_len) {
-  for (int i = 0; i < num_contacts; i++) {
+  if (prefix_len <= 0) {
+    return num_contacts > 0 ? &contacts[0] : NULL;  // empty prefix matches anything
+  }
+  for (int i = contact_buckets[pub_key[0]]; i >= 0; i = contact_next[i]) {
     auto c = &contacts[i];
     if (memcmp(c->id.pub_key, pub_key, prefix_len) == 0) return c;
   }
   return NULL;  // not found
 }
 
+int BaseChatMesh::findNearestContacts(int32_t lat, int32_t lon, uint8_t type, uint32_t max_dist, ContactInfo* results[], uint32_t dists[], int max_results) {
+  int idx[MAX_NEAREST_RESULTS];
+  if (max_results > MAX_NEAREST_RESULTS) max_results = MAX_NEAREST_RESULTS;
+  int n = contact_geo.findNearest(lat, lon, type, max_dist, idx, dists, max_results);
+  for (int i = 0; i < n; i++) {
+    results[i] = &contacts[idx[i]];
+  }
+  return n;
+}
+
 bool BaseChatMesh::addContact(const ContactInfo& contact) {
   ContactInfo* dest = allocateContactSlot();
   if (dest) {
     *dest = contact;
-    dest->shared_secret_valid = false; // mark shared_secret as needing calculation
+    linkContactIdx(dest - contacts);
     return true;  // success
   }
   return false;
 }
 
 bool BaseChatMesh::removeContact(ContactInfo& contact) {
-  int idx = 0;
-  while (idx < num_contacts && !contacts[idx].id.matches(contact.id)) {
-    idx++;
-  }
-  if (idx >= num_contacts) return false;   // not found
+  ContactInfo* found = lookupContactByPubKey(contact.id.pub_key, PUB_KEY_SIZE);
+  if (found == NULL) return false;   // not found
 
-  // remove from contacts array
-  num_contacts--;
-  while (idx < num_contacts) {
-    contacts[idx] = contacts[idx + 1];
-    idx++;
-  }
+  removeContactIdx(found - contacts);
   return true;  // Success
 }
 
@@ -8,8 +8,10 @@
 #define MAX_TEXT_LEN    (10*CIPHER_BLOCK_SIZE)  // must be LESS than (MAX_PACKET_PAYLOAD - 4 - CIPHER_MAC_SIZE - 1)
 
 #include "ContactInfo.h"
+#include "GeoIndex.h"
 
 #define MAX_SEARCH_RESULTS   8
+#define MAX_NEAREST_RESULTS 16
 
 #define MSG_SEND_FAILED       0
 #define MSG_SEND_SENT_FLOOD   1
@@ -37,6 +39,25 @@ public:
   #define MAX_CONTACTS  32
 #endif
 
+#if MAX_CONTACTS > 32767
+  #error "MAX_CONTACTS too large for contact index"
+#endif
+
+#ifndef CONTACT_SECRET_CACHE_SIZE
+  // shared secrets are recomputed (ECDH) on demand when evicted, so size for the number of recently active peers
+  #if MAX_CONTACTS / 8 > 16
+    #define CONTACT_SECRET_CACHE_SIZE  (MAX_CONTACTS / 8)
+  #else
+    #define CONTACT_SECRET_CACHE_SIZE  16
+  #endif
+#endif
+
+#ifndef ADVERT_BLOB_REFRESH_SECS
+  #define ADVERT_BLOB_REFRESH_SECS  (24*60*60)   // re-save an unchanged advert blob at most this often
+#endif
+
+#define CONTACT_HASH_BUCKETS   256   // contact index is bucketed by pub_key[0], ie. the 1-byte path hash
+
 #ifndef MAX_CONNECTIONS
   #define MAX_CONNECTIONS  16
 #endif
@@ -49,6 +70,12 @@ struct ConnectionInfo {
   uint32_t expected_ack;
 };
 
+struct CachedSecret {
+  uint8_t pub_key[PUB_KEY_SIZE];
+  uint8_t secret[PUB_KEY_SIZE];
+  uint32_t last_used;   // 0 = unused slot
+};
+
 #include "ChannelDetails.h"
 
 /**
@@ -60,8 +87,15 @@ class BaseChatMesh : public mesh::Mesh {
 
   ContactInfo contacts[MAX_CONTACTS];
   int num_contacts;
-  int sort_array[MAX_CONTACTS];
+  int16_t contact_buckets[CONTACT_HASH_BUCKETS];  // head of each bucket chain, -1 = empty
+  int16_t contact_next[MAX_CONTACTS];   // next idx in same bucket (ascending idx order), -1 = end
+  int16_t recent_head;   // most recent by last_advert_timestamp, -1 = empty
+  int16_t recent_prev[MAX_CONTACTS], recent_next[MAX_CONTACTS];  // recency list, descending last_advert_timestamp
+  bool recent_sorted;   // false while loading contacts (just linked in at head), until sortRecentIdx()
+  GeoIndex<MAX_CONTACTS> contact_geo;
   int matching_peer_indexes[MAX_SEARCH_RESULTS];
+  CachedSecret secret_cache[CONTACT_SECRET_CACHE_SIZE];
+  uint32_t secret_cache_ticks;
   unsigned long txt_send_timeout;
 #ifdef MAX_GROUP_CHANNELS
   ChannelDetails channels[MAX_GROUP_CHANNELS];
@@ -71,6 +105,15 @@ class BaseChatMesh : public mesh::Mesh {
   uint8_t temp_buf[MAX_TRANS_UNIT];
   ConnectionInfo connections[MAX_CONNECTIONS];
 
+  void linkContactIdx(int idx);
+  void unlinkContactIdx(int idx);
+  void linkRecentIdx(int idx);
+  void unlinkRecentIdx(int idx);
+  void sortRecentIdx();
+  void removeContactIdx(int idx);
+
+  const uint8_t* getSharedSecret(const ContactInfo& contact);
+  bool isAdvertBlobCurrent(const uint8_t* pub_key, uint32_t timestamp, const uint8_t* app_data, size_t app_data_len);
   mesh::Packet* composeMsgPacket(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char *text, uint32_t& expected_ack);
   void sendAckTo(const ContactInfo& dest, uint32_t ack_hash);
 
@@ -79,6 +122,11 @@ protected:
       : mesh::Mesh(radio, ms, rng, rtc, mgr, tables)
   { 
     num_contacts = 0;
+    memset(contact_buckets, 0xFF, sizeof(contact_buckets));
+    recent_head = -1;
+    recent_sorted = false;
+    memset(secret_cache, 0, sizeof(secret_cache));
+    secret_cache_ticks = 0;
   #ifdef MAX_GROUP_CHANNELS
     memset(channels, 0, sizeof(channels));
     num_channels = 0;
@@ -89,9 +137,17 @@ protected:
   }
 
   void bootstrapRTCfromContacts();
-  void resetContacts() { num_contacts = 0; }
+  void resetContacts() {
+    num_contacts = 0;
+    memset(contact_buckets, 0xFF, sizeof(contact_buckets));
+    recent_head = -1;
+    recent_sorted = false;   // sorted once on first scan, not per contact loaded
+    contact_geo.clear();
+    memset(secret_cache, 0, sizeof(secret_cache));   // self_id may have changed
+  }
   void populateContactFromAdvert(ContactInfo& ci, const mesh::Identity& id, const AdvertDataParser& parser, uint32_t timestamp);
   ContactInfo* allocateContactSlot(); // helper to find slot for new contact
+  void onContactUpdated(const ContactInfo& contact);  // call after changing last_advert_timestamp or gps of a stored contact
 
   // 'UI' concepts, for sub-classes to implement
   virtual bool isAutoAddEnabled() const { return true; }
@@ -158,6 +214,7 @@ public:
   void scanRecentContacts(int last_n, ContactVisitor* visitor);
   ContactInfo* searchContactsByPrefix(const char* name_prefix);
   ContactInfo* lookupContactByPubKey(const uint8_t* pub_key, int prefix_len);
+  int findNearestContacts(int32_t lat, int32_t lon, uint8_t type, uint32_t max_dist, ContactInfo* results[], uint32_t dists[], int max_results);
   bool  removeContact(ContactInfo& contact);
   bool  addContact(const ContactInfo& contact);
   int getNumContacts() const { return num_contacts; }
@@ -11,8 +11,12 @@ static File openWrite(FILESYSTEM* _fs, const char* filename) {
   #endif
 }
 
+#define ACL_RECORD_SIZE         136
+#define ACL_FINGERPRINT_SIZE    12    // trailer: "SCFP" + 8 byte prefix of our pub_key
+
 void ClientACL::load(FILESYSTEM* fs, const mesh::LocalIdentity& self_id) {
   _fs = fs;
+  _self_id = &self_id;
   num_clients = 0;
   if (_fs->exists("/s_contacts")) {
   #if defined(RP2040_PLATFORM)
@@ -21,58 +25,80 @@ void ClientACL::load(FILESYSTEM* fs, const mesh::LocalIdentity& self_id) {
     File file = _fs->open("/s_contacts");
   #endif
     if (file) {
-      bool full = false;
-      while (!full) {
-        ClientInfo c;
-        uint8_t pub_key[32];
-        uint8_t unused[2];
+      bool trusted = false;
+      uint8_t rec[ACL_RECORD_SIZE];
+      int n;
+      while ((n = file.read(rec, ACL_RECORD_SIZE)) == ACL_RECORD_SIZE) {
+        if (num_clients >= MAX_CLIENTS) continue;   // full, but look for the trailer
 
+        ClientInfo c;
         memset(&c, 0, sizeof(c));
 
-        bool success = (file.read(pub_key, 32) == 32);
-        success = success && (file.read((uint8_t *) &c.permissions, 1) == 1);
-        success = success && (file.read((uint8_t *) &c.extra.room.sync_since, 4) == 4);
-        success = success && (file.read(unused, 2) == 2);
-        success = success && (file.read((uint8_t *)&c.out_path_len, 1) == 1);
-        success = success && (file.read(c.out_path, 64) == 64);
-        success = success && (file.read(c.shared_secret, PUB_KEY_SIZE) == PUB_KEY_SIZE); // will be recalculated below
-
-        if (!success) break; // EOF
-
-        c.id = mesh::Identity(pub_key);
-        self_id.calcSharedSecret(c.shared_secret, pub_key);  // recalculate shared secrets in case our private key changed
-        if (num_clients < MAX_CLIENTS) {
-          clients[num_clients++] = c;
-        } else {
-          full = true;
-        }
+        int i = 0;
+        c.id = mesh::Identity(&rec[i]); i += 32;
+        c.permissions = rec[i++];
+        memcpy(&c.extra.room.sync_since, &rec[i], 4); i += 4;
+        i += 2;  // unused
+        c.out_path_len = (int8_t) rec[i++];
+        memcpy(c.out_path, &rec[i], 64); i += 64;
+        memcpy(c.shared_secret, &rec[i], PUB_KEY_SIZE); i += PUB_KEY_SIZE;
+
+        clients[num_clients++] = c;
       }
       file.close();
+
+      // stored secrets are only valid for the identity they were calculated with
+      trusted = n == ACL_FINGERPRINT_SIZE && memcmp(rec, "SCFP", 4) == 0 && memcmp(&rec[4], self_id.pub_key, 8) == 0;
+      uint8_t zeroes[PUB_KEY_SIZE];
+      memset(zeroes, 0, sizeof(zeroes));
+      for (int i = 0; i < num_clients; i++) {
+        // otherwise, recalculate on first use (all zeroes means it wasn't calculated when saved)
+        clients[i].secret_valid = trusted && memcmp(clients[i].shared_secret, zeroes, PUB_KEY_SIZE) != 0;
+      }
+      MESH_DEBUG_PRINTLN("ClientACL::load() %d clients, stored secrets %s", num_clients, trusted ? "trusted" : "deferred");
     }
   }
 }
 
+const uint8_t* ClientACL::getSharedSecret(ClientInfo* client) {
+  if (!client->secret_valid && _self_id) {
+    _self_id->calcSharedSecret(client->shared_secret, client->id.pub_key);
+    client->secret_valid = true;
+  }
+  return client->shared_secret;
+}
+
 void ClientACL::save(FILESYSTEM* fs, bool (*filter)(ClientInfo*)) {
   _fs = fs;
   File file = openWrite(_fs, "/s_contacts");
   if (file) {
     uint8_t unused[2];
     memset(unused, 0, sizeof(unused));
+    uint8_t zeroes[PUB_KEY_SIZE];
+    memset(zeroes, 0, sizeof(zeroes));
+    bool success = true;
 
     for (int i = 0; i < num_clients; i++) {
       auto c = &clients[i];
       if (c->permissions == 0 || (filter && !filter(c))) continue;    // skip deleted entries, or by filter function
 
-      bool success = (file.write(c->id.pub_key, 32) == 32);
+      success = (file.write(c->id.pub_key, 32) == 32);
       success = success && (file.write((uint8_t *) &c->permissions, 1) == 1);
       success = success && (file.write((uint8_t *) &c->extra.room.sync_since, 4) == 4);
       success = success && (file.write(unused, 2) == 2);
       success = success && (file.write((uint8_t *)&c->out_path_len, 1) == 1);
       success = success && (file.write(c->out_path, 64) == 64);
-      success = success && (file.write(c->shared_secret, PUB_KEY_SIZE) == PUB_KEY_SIZE);
+      // don't calculate secrets here (could be an ECDH for every client), just those already known
+      success = success && (file.write(c->secret_valid ? c->shared_secret : zeroes, PUB_KEY_SIZE) == PUB_KEY_SIZE);
 
       if (!success) break; // write failed
     }
+    if (success && _self_id) {   // trailer, so secrets can be trusted on next load (not if file is incomplete)
+      uint8_t fp[ACL_FINGERPRINT_SIZE];
+      memcpy(fp, "SCFP", 4);
+      memcpy(&fp[4], _self_id->pub_key, 8);
+      file.write(fp, sizeof(fp));
+    }
     file.close();
   }
 }
@@ -138,6 +164,7 @@ bool ClientACL::applyPermissions(const mesh::LocalIdentity& self_id, const uint8
 
     c->permissions = perms;  // update their permissions
     self_id.calcSharedSecret(c->shared_secret, pubkey);
+    c->secret_valid = true;
   }
   return true;
 }
@@ -15,15 +15,14 @@ struct ClientInfo {
   uint8_t permissions;
   int8_t out_path_len;
   uint8_t out_path[MAX_PATH_SIZE];
-  uint8_t shared_secret[PUB_KEY_SIZE];
+  uint8_t shared_secret[PUB_KEY_SIZE];   // NOTE: use ClientACL::getSharedSecret(), as may be calculated lazily
+  bool secret_valid;
   uint32_t last_timestamp;   // by THEIR clock  (transient)
   uint32_t last_activity;    // by OUR clock    (transient)
   union  {
     struct {
       uint32_t sync_since;  // sync messages SINCE this timestamp (by OUR clock)
-      uint32_t pending_ack;
-      uint32_t push_post_timestamp;
-      unsigned long ack_timeout;
+      uint32_t push_post_timestamp;   // newest post pushed so far (those awaiting ACK are after sync_since, up to this)
       uint8_t  push_failures;
     } room;
   } extra;
@@ -37,6 +36,7 @@ struct ClientInfo {
 
 class ClientACL {
   FILESYSTEM* _fs;
+  const mesh::LocalIdentity* _self_id;
   ClientInfo clients[MAX_CLIENTS];
   int num_clients;
 
@@ -44,6 +44,7 @@ public:
   ClientACL() { 
     memset(clients, 0, sizeof(clients));
     num_clients = 0;
+    _self_id = NULL;
   }
   void load(FILESYSTEM* _fs, const mesh::LocalIdentity& self_id);
   void save(FILESYSTEM* _fs, bool (*filter)(ClientInfo*)=NULL);
@@ -53,6 +54,12 @@ public:
   ClientInfo* putClient(const mesh::Identity& id, uint8_t init_perms);
   bool applyPermissions(const mesh::LocalIdentity& self_id, const uint8_t* pubkey, int key_len, uint8_t perms);
 
+  const uint8_t* getSharedSecret(ClientInfo* client);
+  void setSharedSecret(ClientInfo* client, const uint8_t* secret) {
+    memcpy(client->shared_secret, secret, PUB_KEY_SIZE);
+    client->secret_valid = true;
+  }
+
   int getNumClients() const { return num_clients; }
   ClientInfo* getClientByIdx(int idx) { return &clients[idx]; }
 };
@@ -81,7 +81,10 @@ void CommonCLI::loadPrefsInt(FILESYSTEM* fs, const char* filename) {
     file.read((uint8_t *)&_prefs->discovery_mod_timestamp, sizeof(_prefs->discovery_mod_timestamp)); // 162
     file.read((uint8_t *)&_prefs->adc_multiplier, sizeof(_prefs->adc_multiplier)); // 166
     file.read((uint8_t *)_prefs->owner_info, sizeof(_prefs->owner_info));  // 170
-    // 290
+    file.read((uint8_t *)&_prefs->stats_push_interval, sizeof(_prefs->stats_push_interval)); // 290
+    file.read((uint8_t *)&_prefs->stats_push_dest, sizeof(_prefs->stats_push_dest));         // 292
+    file.read((uint8_t *)&_prefs->advert_thin_target, sizeof(_prefs->advert_thin_target));   // 293
+    // 294
 
     // sanitise bad pref values
     _prefs->rx_delay_base = constrain(_prefs->rx_delay_base, 0, 20.0f);
@@ -108,6 +111,10 @@ void CommonCLI::loadPrefsInt(FILESYSTEM* fs, const char* filename) {
     _prefs->gps_enabled = constrain(_prefs->gps_enabled, 0, 1);
     _prefs->advert_loc_policy = constrain(_prefs->advert_loc_policy, 0, 2);
 
+    _prefs->stats_push_interval = constrain(_prefs->stats_push_interval, 0, 3600);
+    _prefs->stats_push_dest = constrain(_prefs->stats_push_dest, 0, 1);
+    _prefs->advert_thin_target = constrain(_prefs->advert_thin_target, 0, 32);
+
     file.close();
   }
 }
@@ -165,7 +172,10 @@ void CommonCLI::savePrefs(FILESYSTEM* fs) {
     file.write((uint8_t *)&_prefs->discovery_mod_timestamp, sizeof(_prefs->discovery_mod_timestamp)); // 162
     file.write((uint8_t *)&_prefs->adc_multiplier, sizeof(_prefs->adc_multiplier));                 // 166
     file.write((uint8_t *)_prefs->owner_info, sizeof(_prefs->owner_info));  // 170
-    // 290
+    file.write((uint8_t *)&_prefs->stats_push_interval, sizeof(_prefs->stats_push_interval)); // 290
+    file.write((uint8_t *)&_prefs->stats_push_dest, sizeof(_prefs->stats_push_dest));         // 292
+    file.write((uint8_t *)&_prefs->advert_thin_target, sizeof(_prefs->advert_thin_target));   // 293
+    // 294
 
     file.close();
   }
@@ -362,6 +372,12 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
       } else if (memcmp(config, "bridge.secret", 13) == 0) {
         sprintf(reply, "> %s", _prefs->bridge_secret);
 #endif
+      } else if (memcmp(config, "advert.thin", 11) == 0) {
+        sprintf(reply, "> %d", (uint32_t)_prefs->advert_thin_target);
+      } else if (memcmp(config, "stats.push.dest", 15) == 0) {
+        sprintf(reply, "> %s", _prefs->stats_push_dest ? "bridge" : "serial");
+      } else if (memcmp(config, "stats.push", 10) == 0) {
+        sprintf(reply, "> %d", (uint32_t)_prefs->stats_push_interval);
       } else if (memcmp(config, "adc.multiplier", 14) == 0) {
         float adc_mult = _board->getAdcMultiplier();
         if (adc_mult == 0.0f) {
@@ -603,6 +619,32 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
         savePrefs();
         strcpy(reply, "OK");
 #endif
+      } else if (memcmp(config, "advert.thin ", 12) == 0) {
+        int target = _atoi(&config[12]);
+        if (target <= 32) {
+          _prefs->advert_thin_target = (uint8_t)target;
+          savePrefs();
+          strcpy(reply, "OK");
+        } else {
+          strcpy(reply, "Error: max is 32 (0 = off)");
+        }
+      } else if (memcmp(config, "stats.push ", 11) == 0) {
+        int secs = _atoi(&config[11]);
+        if (secs == 0 || (secs >= 10 && secs <= 3600)) {
+          _prefs->stats_push_interval = (uint16_t)secs;
+          savePrefs();
+          strcpy(reply, "OK");
+        } else {
+          strcpy(reply, "Error: interval must be 0 (off), or 10-3600 secs");
+        }
+      } else if (memcmp(config, "stats.push.dest ", 16) == 0) {
+        if (memcmp(&config[16], "bridge", 6) == 0 || memcmp(&config[16], "serial", 6) == 0) {
+          _prefs->stats_push_dest = memcmp(&config[16], "bridge", 6) == 0;
+          savePrefs();
+          strcpy(reply, "OK");
+        } else {
+          strcpy(reply, "Error: dest must be serial or bridge");
+        }
       } else if (memcmp(config, "adc.multiplier ", 15) == 0) {
         _prefs->adc_multiplier = atof(&config[15]);
         if (_board->setAdcMultiplier(_prefs->adc_multiplier)) {
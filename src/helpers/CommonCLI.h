@@ -52,6 +52,10 @@ struct NodePrefs { // persisted to file
   uint32_t discovery_mod_timestamp;
   float adc_multiplier;
   char owner_info[120];
+  // Stats push (repeater only)
+  uint16_t stats_push_interval; // seconds, 0 = off
+  uint8_t stats_push_dest;      // 0 = serial, 1 = bridge
+  uint8_t advert_thin_target;   // neighbours, above which flood adverts are thinned (0 = off, repeater only)
 };
 
 class CommonCLICallbacks {
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef GEO_INDEX_BUCKETS
+  #define GEO_INDEX_BUCKETS   64      // must be power of 2
+#endif
+
+#ifndef GEO_CELL_SIZE
+  #define GEO_CELL_SIZE    50000      // in micro-degrees, ie. 0.05 deg, approx 5.5km of latitude
+#endif
+
+#ifndef GEO_MAX_RINGS
+  #define GEO_MAX_RINGS   6           // how far (in cells) to search outwards before falling back to full scan
+#endif
+
+#define GEO_METRES_PER_UDEG   0.111195f    // metres per micro-degree of latitude
+
+/**
+ * \brief  Spatial index over items with (lat, lon) in micro-degrees (ie. same as ContactInfo::gps_lat/lon).
+ *   Items are identified by their index in the owner's table. Positions are hashed into a grid of
+ *   GEO_CELL_SIZE cells, and the cells are chained into GEO_INDEX_BUCKETS buckets.
+ *   Item at (0, 0) is treated as 'no location', and is not indexed.
+ */
+template <int MAX_ITEMS>
+class GeoIndex {
+  int16_t buckets[GEO_INDEX_BUCKETS];
+  int16_t next[MAX_ITEMS];
+  int32_t lats[MAX_ITEMS], lons[MAX_ITEMS];
+  uint8_t tags[MAX_ITEMS];
+
+  static int32_t cellOf(int32_t v) { return v >= 0 ? v / GEO_CELL_SIZE : (v + 1) / GEO_CELL_SIZE - 1; }  // floor()
+  static int bucketOf(int32_t cy, int32_t cx) {
+    return (int)(((uint32_t)cy * 73856093u) ^ ((uint32_t)cx * 19349663u)) & (GEO_INDEX_BUCKETS - 1);
+  }
+  bool isIndexed(int idx) const { return lats[idx] != 0 || lons[idx] != 0; }
+
+  void unlink(int idx) {
+    int16_t* link = &buckets[bucketOf(cellOf(lats[idx]), cellOf(lons[idx]))];
+    while (*link >= 0) {
+      if (*link == idx) {
+        *link = next[idx];
+        break;
+      }
+      link = &next[*link];
+    }
+  }
+
+  static uint32_t distMetres(int32_t lat1, int32_t lon1, int32_t lat2, int32_t lon2, float lon_scale) {
+    float dy = (float)(lat2 - lat1) * GEO_METRES_PER_UDEG;
+    float dx = (float)(lon2 - lon1) * GEO_METRES_PER_UDEG * lon_scale;
+    return (uint32_t) sqrtf(dx*dx + dy*dy);
+  }
+
+  void offer(int idx, uint32_t dist, int results[], uint32_t dists[], int& n, int k) const {
+    if (n == k && dist >= dists[k - 1]) return;  // not better than current worst
+
+    int i = (n < k) ? n++ : k - 1;
+    while (i > 0 && dists[i - 1] > dist) {    // insertion sort, ascending distance
+      results[i] = results[i - 1];
+      dists[i] = dists[i - 1];
+      i--;
+    }
+    results[i] = idx;
+    dists[i] = dist;
+  }
+
+public:
+  GeoIndex() { clear(); }
+
+  void clear() {
+    memset(buckets, 0xFF, sizeof(buckets));
+    memset(lats, 0, sizeof(lats));
+    memset(lons, 0, sizeof(lons));
+  }
+
+  /**
+   * \brief  insert or move item 'idx'. 'tag' is an arbitrary value that can be used to filter queries (eg. ADV_TYPE_*)
+  */
+  void put(int idx, int32_t lat, int32_t lon, uint8_t tag) {
+    if (isIndexed(idx)) {
+      if (cellOf(lats[idx]) == cellOf(lat) && cellOf(lons[idx]) == cellOf(lon)) {   // still in same cell
+        lats[idx] = lat; lons[idx] = lon; tags[idx] = tag;
+        return;
+      }
+      unlink(idx);
+    }
+    lats[idx] = lat; lons[idx] = lon; tags[idx] = tag;
+    if (!isIndexed(idx)) return;   // no location
+
+    int b = bucketOf(cellOf(lat), cellOf(lon));
+    next[idx] = buckets[b];
+    buckets[b] = idx;
+  }
+
+  void remove(int idx) {
+    if (isIndexed(idx)) {
+      unlink(idx);
+      lats[idx] = lons[idx] = 0;
+    }
+  }
+
+  /**
+   * \brief  for owners which shift their table down when removing, ie. items above 'idx' are renumbered
+  */
+  void removeShift(int idx, int num_items) {
+    remove(idx);
+    for (int i = idx; i < num_items - 1; i++) {
+      next[i] = next[i + 1];
+      lats[i] = lats[i + 1];
+      lons[i] = lons[i + 1];
+      tags[i] = tags[i + 1];
+    }
+    lats[num_items - 1] = lons[num_items - 1] = 0;
+
+    for (int b = 0; b < GEO_INDEX_BUCKETS; b++) {
+      if (buckets[b] > idx) buckets[b]--;
+    }
+    for (int i = 0; i < num_items - 1; i++) {
+      if (isIndexed(i) && next[i] > idx) next[i]--;
+    }
+  }
+
+  /**
+   * \brief  finds up to 'k' nearest items to the given location, in ascending order of distance.
+   * \param  tag  only match items with this tag, or zero for any.
+   * \param  max_dist  in metres, or zero for unlimited.
+   * \returns  number of results stored in results[] (item indexes) and dists[] (metres)
+  */
+  int findNearest(int32_t lat, int32_t lon, uint8_t tag, uint32_t max_dist, int results[], uint32_t dists[], int k) const {
+    if (k <= 0) return 0;
+
+    float lon_scale = cosf((float)lat * (float)(M_PI / 180000000.0));
+    if (lon_scale < 0.01f) lon_scale = 0.01f;  // near poles
+    // shortest distance across one cell, in metres
+    float cell_min_m = GEO_CELL_SIZE * GEO_METRES_PER_UDEG * lon_scale;
+
+    int n = 0;
+    int32_t cy = cellOf(lat), cx = cellOf(lon);
+    for (int r = 0; r <= GEO_MAX_RINGS; r++) {
+      float ring_min_m = (r - 1) * cell_min_m;   // nothing in ring 'r' (or beyond) is closer than this
+      if (r > 0 && max_dist > 0 && ring_min_m > max_dist) return n;
+      if (r > 0 && n == k && ring_min_m > dists[k - 1]) return n;
+
+      for (int32_t y = cy - r; y <= cy + r; y++) {
+        bool edge_row = (y == cy - r || y == cy + r);
+        for (int32_t x = cx - r; x <= cx + r; x += edge_row ? 1 : 2*r) {  // just visit the ring's perimeter
+          for (int i = buckets[bucketOf(y, x)]; i >= 0; i = next[i]) {
+            if (cellOf(lats[i]) != y || cellOf(lons[i]) != x) continue;   // other cell, same bucket
+            if (tag && tags[i] != tag) continue;
+
+            uint32_t d = distMetres(lat, lon, lats[i], lons[i], lon_scale);
+            if (max_dist == 0 || d <= max_dist) offer(i, d, results, dists, n, k);
+          }
+        }
+      }
+    }
+    float searched_m = GEO_MAX_RINGS * cell_min_m;
+    if (max_dist > 0 && max_dist <= searched_m) return n;   // searched far enough
+    if (n == k && dists[k - 1] <= searched_m) return n;
+
+    // fallback: full scan, for sparse results far from query location
+    n = 0;
+    for (int b = 0; b < GEO_INDEX_BUCKETS; b++) {
+      for (int i = buckets[b]; i >= 0; i = next[i]) {
+        if (tag && tags[i] != tag) continue;
+
+        uint32_t d = distMetres(lat, lon, lats[i], lons[i], lon_scale);
+        if (max_dist == 0 || d <= max_dist) offer(i, d, results, dists, n, k);
+      }
+    }
+    return n;
+  }
+};
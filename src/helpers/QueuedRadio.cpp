@@ -0,0 +1,154 @@
+#if defined(ESP32) || !defined(ARDUINO)   // ESP32, or host builds
+
+#include "QueuedRadio.h"
+
+#define TX_IDLE      0
+#define TX_QUEUED    1    // app task has queued frame
+#define TX_SENDING   2    // radio task has started the transmit
+#define TX_DONE      3
+#define TX_FAILED    4    // startSendRaw() failed, app task will see this as a send timeout
+#define TX_ABORT     5    // app task gave up waiting, radio task to clean up
+
+QueuedRadio::QueuedRadio(mesh::Radio& inner, int core) : _inner(&inner), _core(core) {
+  tx_state = TX_IDLE;
+  running = active = false;
+  is_receiving = in_recv_mode = agc_reset_req = false;
+  noise_floor = 0;
+  calib_threshold = -1;
+  n_rx_dropped = 0;
+  last_snr = last_rssi = 0;
+}
+
+void QueuedRadio::taskMain(void* arg) {
+  auto self = (QueuedRadio *) arg;
+
+  self->driver_lock.lock();
+  self->_inner->begin();   // in this task, so the radio interrupt is attached on this core
+  self->driver_lock.unlock();
+  self->active = true;
+
+  while (self->running) {
+    self->service();
+    TaskHelpers::sleep(1);
+  }
+  self->active = false;
+}
+
+void QueuedRadio::begin() {
+  running = true;
+  if (!TaskHelpers::start(taskMain, this, "radio", _core, RADIO_TASK_STACK_SIZE, RADIO_TASK_PRIORITY)) {
+    MESH_DEBUG_PRINTLN("QueuedRadio::begin(): ERROR: could not start radio task!");
+    running = false;
+    return;
+  }
+  while (!active) TaskHelpers::sleep(1);   // wait for inner begin()
+}
+
+void QueuedRadio::end() {
+  running = false;
+  while (active) TaskHelpers::sleep(1);
+}
+
+// called only in radio task
+void QueuedRadio::service() {
+  driver_lock.lock();
+
+  int threshold = calib_threshold.exchange(-1);
+  if (threshold >= 0) _inner->triggerNoiseFloorCalibrate(threshold);
+  if (agc_reset_req.exchange(false)) _inner->resetAGC();
+  _inner->loop();
+
+  uint8_t s = tx_state;
+  if (s == TX_ABORT) {
+    if (tx_queue.front()) {
+      tx_queue.pop();   // was never started
+    } else {
+      _inner->onSendFinished();
+    }
+    tx_state = TX_IDLE;
+  } else if (s == TX_QUEUED) {
+    RadioFrame* f = tx_queue.front();
+    if (f && tx_state.compare_exchange_strong(s, TX_SENDING)) {
+      bool success = _inner->startSendRaw(f->data, f->len);
+      tx_queue.pop();
+      s = TX_SENDING;
+      if (!success) tx_state.compare_exchange_strong(s, TX_FAILED);
+    }
+  } else if (s == TX_SENDING) {
+    if (_inner->isSendComplete()) {
+      _inner->onSendFinished();   // back to receiving straight away
+      if (!tx_state.compare_exchange_strong(s, TX_DONE)) {
+        tx_state = TX_IDLE;   // app task gave up on it meanwhile
+      }
+    }
+  }
+
+  s = tx_state;
+  if (s != TX_QUEUED && s != TX_SENDING) {
+    RadioFrame* f = rx_queue.claim();
+    if (f) {
+      int len = _inner->recvRaw(f->data, MAX_TRANS_UNIT);   // NOTE: also (re)starts receive mode
+      if (len > 0) {
+        f->len = len;
+        f->snr = _inner->getLastSNR();
+        f->rssi = _inner->getLastRSSI();
+        rx_queue.publish();
+      }
+    } else {
+      uint8_t discard[MAX_TRANS_UNIT+1];   // app task is behind, but chip still needs draining to keep receiving
+      if (_inner->recvRaw(discard, MAX_TRANS_UNIT) > 0) n_rx_dropped++;
+    }
+    is_receiving = _inner->isReceiving();   // sampled here, for app task's LBT
+  }
+  in_recv_mode = _inner->isInRecvMode();
+  noise_floor = _inner->getNoiseFloor();
+
+  driver_lock.unlock();
+}
+
+// the rest are called only in app task
+
+int QueuedRadio::recvRaw(uint8_t* bytes, int sz) {
+  RadioFrame* f = rx_queue.front();
+  if (f == NULL) return 0;
+
+  int len = f->len > sz ? sz : f->len;
+  memcpy(bytes, f->data, len);
+  last_snr = f->snr;
+  last_rssi = f->rssi;
+  rx_queue.pop();
+  return len;
+}
+
+bool QueuedRadio::startSendRaw(const uint8_t* bytes, int len) {
+  for (int i = 0; i < 10 && tx_state == TX_ABORT; i++) {
+    TaskHelpers::sleep(1);   // radio task is still cleaning up a timed-out send
+  }
+  if (tx_state != TX_IDLE || len > MAX_TRANS_UNIT) return false;
+
+  RadioFrame* f = tx_queue.claim();
+  if (f == NULL) return false;
+  memcpy(f->data, bytes, len);
+  f->len = len;
+  tx_queue.publish();
+  tx_state = TX_QUEUED;
+  return true;
+}
+
+bool QueuedRadio::isSendComplete() {
+  return tx_state == TX_DONE;
+}
+
+void QueuedRadio::onSendFinished() {
+  uint8_t s = tx_state;
+  while (true) {
+    if (s == TX_ABORT) return;
+    if (s == TX_IDLE || s == TX_DONE || s == TX_FAILED) {   // radio task is finished with it
+      tx_state = TX_IDLE;
+      return;
+    }
+    if (tx_state.compare_exchange_weak(s, TX_ABORT)) return;   // radio task will clean up
+  }
+}
+
+#endif
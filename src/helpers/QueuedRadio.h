@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Dispatcher.h>
+#include <helpers/SPSCQueue.h>
+#include <helpers/TaskHelpers.h>
+
+#ifndef RADIO_TASK_RX_QUEUE
+  #define RADIO_TASK_RX_QUEUE    8      // received packets buffered for app task, must be power of 2
+#endif
+#ifndef RADIO_TASK_PRIORITY
+  #define RADIO_TASK_PRIORITY    3
+#endif
+#define RADIO_TASK_STACK_SIZE    4096
+
+struct RadioFrame {
+  float snr, rssi;
+  int len;
+  uint8_t data[MAX_TRANS_UNIT+1];
+};
+
+/**
+ * \brief  Runs the actual radio driver in its own task (pinned to 'core' on ESP32), and presents it to the Dispatcher
+ *   (in the app task) through lock-free queues. The radio task drains received packets from the chip as soon as they
+ *   arrive, and starts/completes transmits, so that slow app work (flash writes, logging, bridge or display) can no
+ *   longer cause lost packets. NOTE: when to transmit (outbound queue, LBT) is still decided in the app task, so
+ *   stalls there still delay transmits.
+ *
+ *   All calls on the inner radio happen in the radio task, except where the app task holds lock().
+ */
+class QueuedRadio : public mesh::Radio {
+  mesh::Radio* _inner;
+  int _core;
+  SPSCQueue<RadioFrame, RADIO_TASK_RX_QUEUE> rx_queue;   // radio task -> app task
+  SPSCQueue<RadioFrame, 2> tx_queue;                     // app task -> radio task
+  std::atomic<uint8_t> tx_state;
+  std::atomic<bool> running, active;
+  std::atomic<bool> is_receiving, in_recv_mode, agc_reset_req;
+  std::atomic<int> noise_floor, calib_threshold;
+  std::atomic<uint32_t> n_rx_dropped;
+  TaskMutex driver_lock;
+  float last_snr, last_rssi;   // app task only
+
+  static void taskMain(void* arg);
+  void service();
+
+public:
+  QueuedRadio(mesh::Radio& inner, int core);
+
+  void begin() override;   // starts the radio task
+  void end();              // stops the radio task (eg. in host tests)
+
+  int recvRaw(uint8_t* bytes, int sz) override;
+  uint32_t getEstAirtimeFor(int len_bytes) override { return _inner->getEstAirtimeFor(len_bytes); }   // NOTE: no radio I/O
+  float packetScore(float snr, int packet_len) override { return _inner->packetScore(snr, packet_len); }
+  bool startSendRaw(const uint8_t* bytes, int len) override;
+  bool isSendComplete() override;
+  void onSendFinished() override;
+  bool isInRecvMode() const override { return in_recv_mode; }
+  bool isReceiving() override { return is_receiving; }
+  int getNoiseFloor() const override { return noise_floor; }
+  void triggerNoiseFloorCalibrate(int threshold) override { calib_threshold = threshold; }
+  void resetAGC() override { agc_reset_req = true; }
+  float getLastRSSI() const override { return last_rssi; }
+  float getLastSNR() const override { return last_snr; }
+  void lock() override { driver_lock.lock(); }
+  void unlock() override { driver_lock.unlock(); }
+
+  uint32_t getNumRxDropped() const { return n_rx_dropped; }   // rx queue was full
+  int getRxQueueLen() const { return rx_queue.count(); }
+};
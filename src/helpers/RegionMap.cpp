@@ -1,5 +1,6 @@
 #include "RegionMap.h"
 #include <helpers/TxtDataHelpers.h>
+#include <Utils.h>
 #include <SHA256.h>
 
 // helper class for region map exporter, we emulate Stream with a safe buffer writer.
@@ -46,6 +47,9 @@ RegionMap::RegionMap(TransportKeyStore& store) : _store(&store) {
   wildcard.id = wildcard.parent = 0;
   wildcard.flags = 0;  // default behaviour, allow flood and direct
   strcpy(wildcard.name, "*");
+  memset(&wildcard.policy, 0, sizeof(wildcard.policy));
+  memset(quotas, 0, sizeof(quotas));
+  memset(&wildcard_quota, 0, sizeof(wildcard_quota));
 }
 
 bool RegionMap::is_name_char(uint8_t c) {
@@ -68,74 +72,166 @@ static File openWrite(FILESYSTEM* _fs, const char* filename) {
   #endif
 }
 
-bool RegionMap::load(FILESYSTEM* _fs, const char* path) {
-  if (_fs->exists(path ? path : "/regions2")) {
+static File openRead(FILESYSTEM* _fs, const char* filename) {
   #if defined(RP2040_PLATFORM)
-    File file = _fs->open(path ? path : "/regions2", "r");
+    return _fs->open(filename, "r");
   #else
-    File file = _fs->open(path ? path : "/regions2");
+    return _fs->open(filename);
   #endif
+}
+
+/*
+  File format (all little-endian):
+    RegionFileHeader (20 bytes), then 'num_regions' x RegionEntry (42 bytes, packed), then RegionPolicy of wildcard
+    CRC-32 is over the header (excluding 'crc') followed by the entries and wildcard policy.
+    Version 1: entries are 36 bytes (no 'policy'), and no wildcard policy.
+*/
+#define REGIONS_FILE          "/regions3"
+#define REGIONS_LEGACY_FILE   "/regions2"
+#define REGIONS_MAGIC         0x4752434D   // "MCRG"
+#define REGIONS_VERSION       2
+#define REGION_ENTRY_V1_SIZE  36
+
+struct RegionFileHeader {
+  uint32_t magic;
+  uint8_t  version;
+  uint8_t  entry_size;
+  uint16_t num_regions;
+  uint16_t home_id;
+  uint16_t next_id;
+  uint8_t  wildcard_flags;
+  uint8_t  reserved[3];
+  uint32_t crc;
+};
 
-    if (file) {
-      uint8_t pad[128];
+#define REGIONS_HDR_CRC_LEN   (sizeof(RegionFileHeader) - sizeof(uint32_t))
 
-      num_regions = 0; next_id = 1; home_id = 0;
+bool RegionMap::loadLegacy(FILESYSTEM* _fs, const char* path) {
+  File file = openRead(_fs, path);
+  if (file) {
+    uint8_t pad[128];
 
-      bool success = file.read(pad, 5) == 5;  // reserved header
-      success = success && file.read((uint8_t *) &home_id, sizeof(home_id)) == sizeof(home_id);
-      success = success && file.read((uint8_t *) &wildcard.flags, sizeof(wildcard.flags)) == sizeof(wildcard.flags);
-      success = success && file.read((uint8_t *) &next_id, sizeof(next_id)) == sizeof(next_id);
+    num_regions = 0; next_id = 1; home_id = 0;
 
-      if (success) {
-        while (num_regions < MAX_REGION_ENTRIES) {
-          auto r = &regions[num_regions];
+    bool success = file.read(pad, 5) == 5;  // reserved header
+    success = success && file.read((uint8_t *) &home_id, sizeof(home_id)) == sizeof(home_id);
+    success = success && file.read((uint8_t *) &wildcard.flags, sizeof(wildcard.flags)) == sizeof(wildcard.flags);
+    success = success && file.read((uint8_t *) &next_id, sizeof(next_id)) == sizeof(next_id);
+
+    if (success) {
+      while (num_regions < MAX_REGION_ENTRIES) {
+        auto r = &regions[num_regions];
 
-          success = file.read((uint8_t *) &r->id, sizeof(r->id)) == sizeof(r->id);
-          success = success && file.read((uint8_t *) &r->parent, sizeof(r->parent)) == sizeof(r->parent);
-          success = success && file.read((uint8_t *) r->name, sizeof(r->name)) == sizeof(r->name);
-          success = success && file.read((uint8_t *) &r->flags, sizeof(r->flags)) == sizeof(r->flags);
-          success = success && file.read(pad, sizeof(pad)) == sizeof(pad);
+        success = file.read((uint8_t *) &r->id, sizeof(r->id)) == sizeof(r->id);
+        success = success && file.read((uint8_t *) &r->parent, sizeof(r->parent)) == sizeof(r->parent);
+        success = success && file.read((uint8_t *) r->name, sizeof(r->name)) == sizeof(r->name);
+        success = success && file.read((uint8_t *) &r->flags, sizeof(r->flags)) == sizeof(r->flags);
+        success = success && file.read(pad, sizeof(pad)) == sizeof(pad);
 
-          if (!success) break; // EOF
+        if (!success) break; // EOF
 
-          if (r->id >= next_id) {    // make sure next_id is valid
-            next_id = r->id + 1;
-          }
-          num_regions++;
+        memset(&r->policy, 0, sizeof(r->policy));
+        if (r->id >= next_id) {    // make sure next_id is valid
+          next_id = r->id + 1;
         }
+        num_regions++;
       }
-      file.close();
-      return true;
     }
+    file.close();
+    return true;
   }
   return false;  // failed
 }
 
-bool RegionMap::save(FILESYSTEM* _fs, const char* path) {
-  File file = openWrite(_fs, path ? path : "/regions2");
-  if (file) {
-    uint8_t pad[128];
-    memset(pad, 0, sizeof(pad));
+bool RegionMap::load(FILESYSTEM* _fs, const char* path) {
+  if (path == NULL && !_fs->exists(REGIONS_FILE) && _fs->exists(REGIONS_LEGACY_FILE)) {
+    // one-time migration from old format
+    if (!loadLegacy(_fs, REGIONS_LEGACY_FILE)) return false;
+    if (save(_fs)) {
+      _fs->remove(REGIONS_LEGACY_FILE);
+      MESH_DEBUG_PRINTLN("RegionMap: migrated %d regions to %s", (int) num_regions, REGIONS_FILE);
+    }
+    return true;
+  }
 
-    bool success = file.write(pad, 5) == 5;  // reserved header
-    success = success && file.write((uint8_t *) &home_id, sizeof(home_id)) == sizeof(home_id);
-    success = success && file.write((uint8_t *) &wildcard.flags, sizeof(wildcard.flags)) == sizeof(wildcard.flags);
-    success = success && file.write((uint8_t *) &next_id, sizeof(next_id)) == sizeof(next_id);
+  const char* fname = path ? path : REGIONS_FILE;
+  if (!_fs->exists(fname)) return false;
 
-    if (success) {
-      for (int i = 0; i < num_regions; i++) {
-        auto r = &regions[i];
-
-        success = file.write((uint8_t *) &r->id, sizeof(r->id)) == sizeof(r->id);
-        success = success && file.write((uint8_t *) &r->parent, sizeof(r->parent)) == sizeof(r->parent);
-        success = success && file.write((uint8_t *) r->name, sizeof(r->name)) == sizeof(r->name);
-        success = success && file.write((uint8_t *) &r->flags, sizeof(r->flags)) == sizeof(r->flags);
-        success = success && file.write(pad, sizeof(pad)) == sizeof(pad);
-        if (!success) break; // write failed
-      }
+  File file = openRead(_fs, fname);
+  if (!file) return false;
+
+  RegionFileHeader hdr;
+  bool success = file.read((uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == REGIONS_MAGIC;
+  bool v1 = hdr.version == 1 && hdr.entry_size == REGION_ENTRY_V1_SIZE;
+  success = success && (v1 || (hdr.version == REGIONS_VERSION && hdr.entry_size == sizeof(RegionEntry)))
+      && hdr.num_regions <= MAX_REGION_ENTRIES;
+
+  RegionPolicy wildcard_policy;
+  memset(&wildcard_policy, 0, sizeof(wildcard_policy));
+
+  int len = success ? hdr.num_regions * hdr.entry_size : 0;
+  success = success && file.read((uint8_t *) regions, len) == len;   // all entries in one read
+  success = success && (v1 || file.read((uint8_t *) &wildcard_policy, sizeof(wildcard_policy)) == sizeof(wildcard_policy));
+  file.close();
+
+  if (success) {
+    uint32_t crc = mesh::Utils::crc32((uint8_t *) regions, len, mesh::Utils::crc32((uint8_t *) &hdr, REGIONS_HDR_CRC_LEN));
+    if (!v1) crc = mesh::Utils::crc32((uint8_t *) &wildcard_policy, sizeof(wildcard_policy), crc);
+    success = hdr.crc == crc;
+  }
+
+  if (!success) {
+    MESH_DEBUG_PRINTLN("RegionMap::load() - %s is invalid or corrupt", fname);
+    num_regions = 0; next_id = 1; home_id = 0;
+    return false;
+  }
+
+  if (v1) {   // expand in place, from the end
+    for (int i = hdr.num_regions - 1; i >= 0; i--) {
+      memmove(&regions[i], (uint8_t *) regions + i*REGION_ENTRY_V1_SIZE, REGION_ENTRY_V1_SIZE);
+      memset(&regions[i].policy, 0, sizeof(regions[i].policy));
     }
+  }
+  memset(quotas, 0, sizeof(quotas));
+  memset(&wildcard_quota, 0, sizeof(wildcard_quota));
+  wildcard.policy = wildcard_policy;
+
+  num_regions = hdr.num_regions;
+  home_id = hdr.home_id;
+  next_id = hdr.next_id;
+  wildcard.flags = hdr.wildcard_flags;
+  for (int i = 0; i < num_regions; i++) {
+    auto r = &regions[i];
+    r->name[sizeof(r->name) - 1] = 0;   // make sure names are null terminated
+    if (r->id >= next_id) {    // make sure next_id is valid
+      next_id = r->id + 1;
+    }
+  }
+  return true;
+}
+
+bool RegionMap::save(FILESYSTEM* _fs, const char* path) {
+  RegionFileHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = REGIONS_MAGIC;
+  hdr.version = REGIONS_VERSION;
+  hdr.entry_size = sizeof(RegionEntry);
+  hdr.num_regions = num_regions;
+  hdr.home_id = home_id;
+  hdr.next_id = next_id;
+  hdr.wildcard_flags = wildcard.flags;
+
+  int len = num_regions * sizeof(RegionEntry);
+  hdr.crc = mesh::Utils::crc32((uint8_t *) regions, len, mesh::Utils::crc32((uint8_t *) &hdr, REGIONS_HDR_CRC_LEN));
+  hdr.crc = mesh::Utils::crc32((uint8_t *) &wildcard.policy, sizeof(wildcard.policy), hdr.crc);
+
+  File file = openWrite(_fs, path ? path : REGIONS_FILE);
+  if (file) {
+    bool success = file.write((uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr);
+    success = success && file.write((uint8_t *) regions, len) == len;
+    success = success && file.write((uint8_t *) &wildcard.policy, sizeof(wildcard.policy)) == sizeof(wildcard.policy);
     file.close();
-    return true;
+    return success;
   }
   return false;  // failed
 }
@@ -153,9 +249,11 @@ RegionEntry* RegionMap::putRegion(const char* name, uint16_t parent_id, uint16_t
 
     region->parent = parent_id;   // re-parent / move this region in the hierarchy
   } else {
-    if (id == 0 && num_regions >= MAX_REGION_ENTRIES) return NULL;  // full!
+    if (num_regions >= MAX_REGION_ENTRIES) return NULL;  // full!
 
+    memset(&quotas[num_regions], 0, sizeof(RegionQuota));
     region = &regions[num_regions++];   // alloc new RegionEntry
+    memset(&region->policy, 0, sizeof(region->policy));   // no limits by default
     region->flags = REGION_DENY_FLOOD;     // DENY by default
     region->id = id == 0 ? next_id++ : id;
     StrHelper::strncpy(region->name, name, sizeof(region->name));
@@ -165,28 +263,26 @@ RegionEntry* RegionMap::putRegion(const char* name, uint16_t parent_id, uint16_t
 }
 
 RegionEntry* RegionMap::findMatch(mesh::Packet* packet, uint8_t mask) {
+  TransportKey tried[REGION_MATCH_MAX_TRIED];   // keys already known NOT to match
+  int num_tried = 0;
+
   for (int i = 0; i < num_regions; i++) {
     auto region = &regions[i];
     if ((region->flags & mask) == 0) {   // does region allow this? (per 'mask' param)
-      TransportKey keys[4];
-      int num;
-      if (region->name[0] == '$') {   // private region
-        num = _store->loadKeysFor(region->id, keys, 4);
-      } else if (region->name[0] == '#') {   // auto hashtag region
-        _store->getAutoKeyFor(region->id, region->name, keys[0]);
-        num = 1;
-      } else {   // new: implicit auto hashtag region
-        char tmp[sizeof(region->name)];
-        tmp[0] = '#';
-        strcpy(&tmp[1], region->name);
-        _store->getAutoKeyFor(region->id, tmp, keys[0]);
-        num = 1;
-      }
+      const TransportKeyHMAC* keys[4];
+      // '$' is private region, otherwise auto hashtag region (with '#' implied, if not in name)
+      int num = _store->getKeyStatesFor(region->id, region->name[0] == '$' ? NULL : region->name, keys, 4);
+
       for (int j = 0; j < num; j++) {
-        uint16_t code = keys[j].calcTransportCode(packet);
+        int k = 0;
+        while (k < num_tried && memcmp(tried[k].key, keys[j]->key.key, sizeof(tried[k].key)) != 0) k++;
+        if (k < num_tried) continue;   // same key as an earlier region, no need to recalc
+
+        uint16_t code = keys[j]->calcTransportCode(packet);
         if (packet->transport_codes[0] == code) {   // a match!!
           return region;
         }
+        if (num_tried < REGION_MATCH_MAX_TRIED) tried[num_tried++] = keys[j]->key;
       }
     }
   }
@@ -255,11 +351,93 @@ bool RegionMap::removeRegion(const RegionEntry& region) {
   num_regions--;    // remove from regions array
   while (i < num_regions) {
     regions[i] = regions[i + 1];
+    quotas[i] = quotas[i + 1];
     i++;
   }
   return true;  // success
 }
 
+RegionQuota* RegionMap::getQuotaFor(const RegionEntry* region) {
+  if (region == &wildcard) return &wildcard_quota;
+  int i = region - regions;
+  return (i >= 0 && i < num_regions) ? &quotas[i] : NULL;
+}
+
+void RegionMap::refill(RegionQuota* q, const RegionPolicy& policy, unsigned long now_millis) {
+  // NOTE: buckets hold one hour's worth, in units where they refill by the (hourly) limit every second
+  uint32_t pkt_cap = (uint32_t)policy.max_pkts * 3600;
+  uint32_t air_cap = (uint32_t)policy.max_airtime * 3600;
+  if (!q->primed) {
+    q->pkt_tokens = pkt_cap;
+    q->air_tokens = air_cap;
+    q->last_refill = now_millis;
+    q->primed = true;
+    return;
+  }
+  uint32_t secs = (now_millis - q->last_refill) / 1000;
+  if (secs == 0) return;
+
+  q->last_refill += secs * 1000;
+  if (secs > 3600) secs = 3600;   // already full
+  q->pkt_tokens += secs * policy.max_pkts;
+  if (q->pkt_tokens > pkt_cap) q->pkt_tokens = pkt_cap;
+  q->air_tokens += secs * policy.max_airtime;
+  if (q->air_tokens > air_cap) q->air_tokens = air_cap;
+}
+
+static uint32_t reserveFor(uint8_t priority, uint32_t cap) {   // portion of an ancestor's quota, a child can't use
+  if (priority == REGION_PRI_HIGH) return 0;
+  if (priority == REGION_PRI_LOW) return cap / 2;
+  return cap / 5;
+}
+
+bool RegionMap::allowForward(RegionEntry* region, uint32_t airtime_millis, unsigned long now_millis) {
+  if (region == NULL) return true;
+
+  uint32_t pkt_cost = 3600;
+  uint32_t air_cost = airtime_millis * 36 / 10;   // millis -> 1/3600ths of a second
+
+  // first pass, check this region then up through ancestors (with reserve, as per priority)
+  bool allowed = true;
+  int depth = 0;
+  for (RegionEntry* r = region; r && depth < 8; depth++) {
+    auto q = getQuotaFor(r);
+    if (q && (r->policy.max_pkts || r->policy.max_airtime)) {
+      refill(q, r->policy, now_millis);
+      uint32_t pkt_reserve = depth == 0 ? 0 : reserveFor(region->policy.priority, (uint32_t)r->policy.max_pkts * 3600);
+      uint32_t air_reserve = depth == 0 ? 0 : reserveFor(region->policy.priority, (uint32_t)r->policy.max_airtime * 3600);
+      if ((r->policy.max_pkts && q->pkt_tokens < pkt_cost + pkt_reserve)
+        || (r->policy.max_airtime && q->air_tokens < air_cost + air_reserve)) {
+        allowed = false;
+        break;
+      }
+    }
+    r = r->id == 0 ? NULL : findById(r->parent);
+  }
+
+  auto rq = getQuotaFor(region);
+  if (!allowed) {
+    if (rq) rq->n_dropped++;
+    return false;
+  }
+
+  // second pass, consume from all
+  depth = 0;
+  for (RegionEntry* r = region; r && depth < 8; depth++) {
+    auto q = getQuotaFor(r);
+    if (q) {
+      if (r->policy.max_pkts) q->pkt_tokens -= pkt_cost;
+      if (r->policy.max_airtime) q->air_tokens -= air_cost;
+    }
+    r = r->id == 0 ? NULL : findById(r->parent);
+  }
+  if (rq) {
+    rq->n_forwarded++;
+    rq->airtime_used += airtime_millis;
+  }
+  return true;
+}
+
 bool RegionMap::clear() {
   num_regions = 0;
   return true;  // success
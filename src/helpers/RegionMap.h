@@ -8,14 +8,38 @@
   #define MAX_REGION_ENTRIES  32
 #endif
 
+#ifndef REGION_MATCH_MAX_TRIED
+  #define REGION_MATCH_MAX_TRIED  16    // distinct keys remembered per findMatch(), to skip duplicates
+#endif
+
 #define REGION_DENY_FLOOD   0x01
 #define REGION_DENY_DIRECT  0x02   // reserved for future
 
-struct RegionEntry {
+#define REGION_PRI_NORMAL   0
+#define REGION_PRI_LOW      1    // may only use an ancestor's quota while it is at least half full
+#define REGION_PRI_HIGH     2    // may use all of an ancestor's quota (NORMAL leaves 20% in reserve)
+
+struct RegionPolicy {   // forwarding limits for FLOOD packets (zero = unlimited)
+  uint16_t max_pkts;       // packets per hour
+  uint16_t max_airtime;    // seconds of airtime per hour
+  uint8_t  priority;       // one of REGION_PRI_*
+  uint8_t  reserved;
+};
+
+struct RegionEntry {   // NOTE: persisted as-is (42 bytes), see RegionMap::save()
   uint16_t id;
   uint16_t parent;
   uint8_t flags;
   char name[31];
+  RegionPolicy policy;   // also applies to all child regions
+};
+
+struct RegionQuota {   // token buckets, in units of 1/3600 of the hourly limit (transient)
+  uint32_t pkt_tokens, air_tokens;
+  unsigned long last_refill;
+  bool primed;
+  uint32_t n_forwarded, n_dropped;
+  uint32_t airtime_used;   // millis, of forwarded packets
 };
 
 class RegionMap {
@@ -24,8 +48,13 @@ class RegionMap {
   uint16_t num_regions;
   RegionEntry regions[MAX_REGION_ENTRIES];
   RegionEntry wildcard;
+  RegionQuota quotas[MAX_REGION_ENTRIES];
+  RegionQuota wildcard_quota;
 
   void printChildRegions(int indent, const RegionEntry* parent, Stream& out) const;
+  RegionQuota* getQuotaFor(const RegionEntry* region);
+  void refill(RegionQuota* q, const RegionPolicy& policy, unsigned long now_millis);
+  bool loadLegacy(FILESYSTEM* _fs, const char* path);
 
 public:
   RegionMap(TransportKeyStore& store);
@@ -45,8 +74,16 @@ public:
   void setHomeRegion(const RegionEntry* home);
   bool removeRegion(const RegionEntry& region);
   bool clear();
-  void resetFrom(const RegionMap& src) { num_regions = 0; next_id = src.next_id; }
+  void resetFrom(const RegionMap& src) { num_regions = 0; next_id = src.next_id; wildcard.policy = src.wildcard.policy; }
   int getCount() const { return num_regions; }
+
+  /**
+   * \brief  checks the quotas of 'region' and all its ancestors, and if within all of them, consumes from each.
+   * \returns  true if packet can be forwarded
+   */
+  bool allowForward(RegionEntry* region, uint32_t airtime_millis, unsigned long now_millis);
+  const RegionQuota* getQuota(const RegionEntry* region) { return getQuotaFor(region); }
+
   const RegionEntry* getByIdx(int i) const { return &regions[i]; }
   const RegionEntry* getRoot() const { return &wildcard; }
   int exportNamesTo(char *dest, int max_len, uint8_t mask, bool invert = false);
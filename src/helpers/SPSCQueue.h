@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * \brief  Lock-free, single-producer/single-consumer ring of fixed-size items. Items are written and read in place
+ *   (claim()/publish(), and front()/pop()), so large items, like raw packets, are not copied through the queue.
+ *   Exactly one task may call the producer methods, and exactly one (other) task the consumer methods.
+ */
+template <typename T, int N>
+class SPSCQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SPSCQueue size must be a power of 2");
+
+  T items[N];
+  std::atomic<uint32_t> head;   // next slot to publish, only written by producer
+  std::atomic<uint32_t> tail;   // next slot to pop, only written by consumer
+
+public:
+  SPSCQueue() : head(0), tail(0) { }
+
+  // producer side
+
+  /**
+   * \returns  the next free slot to fill in, or NULL if queue is full. Not visible to consumer until publish().
+   */
+  T* claim() {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= N) return NULL;   // full
+    return &items[h & (N - 1)];
+  }
+  void publish() {
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // consumer side
+
+  /**
+   * \returns  the oldest published item, or NULL if queue is empty. Item stays valid until pop().
+   */
+  T* front() {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return NULL;   // empty
+    return &items[t & (N - 1)];
+  }
+  void pop() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  int count() const {   // NOTE: only a snapshot, if called from other task
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#if defined(ESP32)
+  #include <freertos/FreeRTOS.h>
+  #include <freertos/task.h>
+  #include <freertos/semphr.h>
+#elif defined(ARDUINO)
+  #error "TaskHelpers: no threading support for this platform"
+#else
+  #include <thread>
+  #include <mutex>
+  #include <chrono>
+#endif
+
+/**
+ * \brief  Minimal threading layer. FreeRTOS tasks on ESP32, or std::thread on host builds (eg. for testing
+ *   under ThreadSanitizer).
+ */
+class TaskMutex {
+#if defined(ESP32)
+  SemaphoreHandle_t _sem;
+public:
+  TaskMutex() { _sem = xSemaphoreCreateMutex(); }
+  void lock() { xSemaphoreTake(_sem, portMAX_DELAY); }
+  void unlock() { xSemaphoreGive(_sem); }
+#else
+  std::mutex _mutex;
+public:
+  void lock() { _mutex.lock(); }
+  void unlock() { _mutex.unlock(); }
+#endif
+};
+
+class TaskHelpers {
+public:
+  /**
+   * \brief  starts fn(arg) in a new task, pinned to 'core' where supported. The task just ends when fn returns.
+   * \param  priority   FreeRTOS priority (Arduino loop() is 1). Ignored on host.
+   */
+  static bool start(void (*fn)(void*), void* arg, const char* name, int core, int stack_size, int priority) {
+  #if defined(ESP32)
+    #if CONFIG_FREERTOS_UNICORE
+      core = 0;
+    #endif
+    struct Start { void (*fn)(void*); void* arg; };
+    auto s = new Start { fn, arg };
+    auto entry = [](void* p) {
+      auto s = (Start *) p;
+      s->fn(s->arg);
+      delete s;
+      vTaskDelete(NULL);   // FreeRTOS tasks must not return
+    };
+    if (xTaskCreatePinnedToCore(entry, name, stack_size, s, priority, NULL, core) == pdPASS) return true;
+    delete s;
+    return false;
+  #else
+    std::thread(fn, arg).detach();
+    return true;
+  #endif
+  }
+
+  static void sleep(int millis) {
+  #if defined(ESP32)
+    vTaskDelay(millis / portTICK_PERIOD_MS > 0 ? millis / portTICK_PERIOD_MS : 1);
+  #else
+    std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+  #endif
+  }
+};
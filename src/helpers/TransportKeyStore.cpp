@@ -1,6 +1,15 @@
 #include "TransportKeyStore.h"
 #include <SHA256.h>
 
+static uint16_t reserveCodes(uint16_t code) {
+  if (code == 0) {     // reserve codes 0000 and FFFF
+    code++;
+  } else if (code == 0xFFFF) {
+    code--;
+  }
+  return code;
+}
+
 uint16_t TransportKey::calcTransportCode(const mesh::Packet* packet) const {
   uint16_t code;
   SHA256 sha;
@@ -9,12 +18,7 @@ uint16_t TransportKey::calcTransportCode(const mesh::Packet* packet) const {
   sha.update(&type, 1);
   sha.update(packet->payload, packet->payload_len);
   sha.finalizeHMAC(key, sizeof(key), &code, 2);
-  if (code == 0) {     // reserve codes 0000 and FFFF
-    code++;
-  } else if (code == 0xFFFF) {
-    code--;
-  }
-  return code;
+  return reserveCodes(code);
 }
 
 bool TransportKey::isNull() const {
@@ -24,51 +28,148 @@ bool TransportKey::isNull() const {
   return true;  // key is all zeroes
 }
 
-void TransportKeyStore::putCache(uint16_t id, const TransportKey& key) {
-  if (num_cache < MAX_TKS_ENTRIES) {
-    cache_ids[num_cache] = id;
-    cache_keys[num_cache] = key;
-    num_cache++;
+void TransportKeyHMAC::init(const TransportKey& k) {
+  key = k;
+
+  uint8_t block[64];   // SHA256 block size
+  memset(block, 0x36, sizeof(block));   // ipad
+  for (int i = 0; i < sizeof(k.key); i++) block[i] ^= k.key[i];
+  inner.reset();
+  inner.update(block, sizeof(block));
+
+  memset(block, 0x5C, sizeof(block));   // opad
+  for (int i = 0; i < sizeof(k.key); i++) block[i] ^= k.key[i];
+  outer.reset();
+  outer.update(block, sizeof(block));
+}
+
+uint16_t TransportKeyHMAC::calcTransportCode(const mesh::Packet* packet) const {
+  uint8_t digest[32];
+  SHA256 sha = inner;   // resume from key block
+  uint8_t type = packet->getPayloadType();
+  sha.update(&type, 1);
+  sha.update(packet->payload, packet->payload_len);
+  sha.finalize(digest, sizeof(digest));
+
+  uint16_t code;
+  sha = outer;
+  sha.update(digest, sizeof(digest));
+  sha.finalize(&code, 2);
+  return reserveCodes(code);
+}
+
+int TransportKeyStore::findCached(uint16_t id, const TransportKeyHMAC* dest[], int max_num) {
+  int n = 0;
+  for (int i = 0; i < num_cache && n < max_num; i++) {
+    if (cache_ids[i] == id) {
+      cache_used[i] = ++use_clock;
+      dest[n++] = &cache_states[i];
+    }
+  }
+  if (n > 0) {
+    n_hits++;
   } else {
-    // TODO: evict oldest cache entry
+    n_misses++;
   }
+  return n;
 }
 
-void TransportKeyStore::getAutoKeyFor(uint16_t id, const char* name, TransportKey& dest) {
-  for (int i = 0; i < num_cache; i++) {  // first, check cache
-    if (cache_ids[i] == id) {   // cache hit!
-      dest = cache_keys[i];
-      return;
+const TransportKeyHMAC* TransportKeyStore::putCache(uint16_t id, const TransportKey& key, bool is_private) {
+  int i;
+  uint32_t used = ++use_clock;
+  if (num_cache < MAX_TKS_ENTRIES) {
+    i = num_cache++;
+  } else {
+    // evict least recently used, preferring auto keys (as cheap to recalc)
+    i = -1;
+    for (int pass = 0; pass < 2 && i < 0; pass++) {
+      uint32_t oldest = 0xFFFFFFFF;
+      for (int j = 0; j < num_cache; j++) {
+        // (not another key of this region, just put in dest[] by getKeyStatesFor())
+        if ((pass > 0 || !cache_private[j]) && cache_ids[j] != id && cache_used[j] < oldest) {
+          oldest = cache_used[j];
+          i = j;
+        }
+      }
     }
+    n_evictions++;
+    // once full, new entries go in as least recently used (until hit again). RegionMap::findMatch() tries all
+    // regions in the same order, so with more regions than fit, plain LRU would evict each key just before it's
+    // next needed. This way all but one entry stay cached, and only that slot churns.
+    used = 0;
   }
-  // calc key for publicly-known hashtag region name
-  SHA256 sha;
-  sha.update(name, strlen(name));
-  sha.finalize(&dest.key, sizeof(dest.key));
-
-  putCache(id, dest);
+  cache_ids[i] = id;
+  cache_used[i] = used;
+  cache_private[i] = is_private;
+  cache_states[i].init(key);
+  return &cache_states[i];
 }
 
-int TransportKeyStore::loadKeysFor(uint16_t id, TransportKey keys[], int max_num) {
-  int n = 0;
-  for (int i = 0; i < num_cache && n < max_num; i++) {  // first, check cache
+void TransportKeyStore::invalidateCache(uint16_t id) {
+  int i = 0;
+  while (i < num_cache) {
     if (cache_ids[i] == id) {
-      keys[n++] = cache_keys[i];
+      num_cache--;
+      if (i < num_cache) {   // move last entry into this slot
+        cache_ids[i] = cache_ids[num_cache];
+        cache_used[i] = cache_used[num_cache];
+        cache_private[i] = cache_private[num_cache];
+        cache_states[i] = cache_states[num_cache];
+      }
+    } else {
+      i++;
     }
   }
-  if (n > 0) return n;   // cache hit!
+}
 
+int TransportKeyStore::fetchKeys(uint16_t id, TransportKey keys[], int max_num) {
   // TODO:  retrieve from difficult-to-copy keystore
+  return 0;
+}
+
+int TransportKeyStore::getKeyStatesFor(uint16_t id, const char* name, const TransportKeyHMAC* dest[], int max_num) {
+  if (max_num < 1) return 0;
+
+  int n = findCached(id, dest, max_num);
+  if (n > 0) return n;   // cache hit!
 
-  // store in cache (if room)
+  if (name == NULL) {   // private region
+    TransportKey keys[4];
+    n = fetchKeys(id, keys, max_num < 4 ? max_num : 4);
+    for (int i = 0; i < n; i++) {
+      dest[i] = putCache(id, keys[i], true);
+    }
+    return n;
+  }
+
+  // calc key for publicly-known hashtag region name
+  TransportKey key;
+  SHA256 sha;
+  if (*name != '#') sha.update("#", 1);   // implicit hashtag
+  sha.update(name, strlen(name));
+  sha.finalize(&key.key, sizeof(key.key));
+
+  dest[0] = putCache(id, key, false);
+  return 1;
+}
+
+void TransportKeyStore::getAutoKeyFor(uint16_t id, const char* name, TransportKey& dest) {
+  const TransportKeyHMAC* state;
+  getKeyStatesFor(id, name, &state, 1);
+  dest = state->key;
+}
+
+int TransportKeyStore::loadKeysFor(uint16_t id, TransportKey keys[], int max_num) {
+  const TransportKeyHMAC* states[4];
+  int n = getKeyStatesFor(id, NULL, states, max_num < 4 ? max_num : 4);
   for (int i = 0; i < n; i++) {
-    putCache(id, keys[i]);
+    keys[i] = states[i]->key;
   }
   return n;
 }
 
 bool TransportKeyStore::saveKeysFor(uint16_t id, const TransportKey keys[], int num) {
-  invalidateCache();
+  invalidateCache(id);
 
   // TODO: update hardware keystore
 
@@ -76,7 +177,7 @@ bool TransportKeyStore::saveKeysFor(uint16_t id, const TransportKey keys[], int
 }
 
 bool TransportKeyStore::removeKeys(uint16_t id) {
-  invalidateCache();
+  invalidateCache(id);
 
   // TODO: remove from hardware keystore
 
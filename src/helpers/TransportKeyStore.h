@@ -3,6 +3,7 @@
 #include <Arduino.h>   // needed for PlatformIO
 #include <Packet.h>
 #include <helpers/IdentityStore.h>
+#include <SHA256.h>
 
 struct TransportKey {
   uint8_t key[16];
@@ -11,21 +12,69 @@ struct TransportKey {
   bool isNull() const;
 };
 
-#define MAX_TKS_ENTRIES   16
+/**
+ * \brief  A TransportKey with its HMAC inner/outer key blocks already hashed, so calculating
+ *   a transport code only needs to hash the packet (saves two SHA256 blocks per key, per packet).
+ */
+class TransportKeyHMAC {
+  SHA256 inner, outer;
 
+public:
+  TransportKey key;
+
+  void init(const TransportKey& k);
+  uint16_t calcTransportCode(const mesh::Packet* packet) const;   // same result as key.calcTransportCode()
+};
+
+// NOTE: each cache entry is about 260 bytes (two SHA256 states, plus the key)
+#ifndef MAX_TKS_ENTRIES
+  #if defined(ESP32)
+    #define MAX_TKS_ENTRIES   32
+  #else
+    #define MAX_TKS_ENTRIES   16
+  #endif
+#endif
+
+/**
+ * \brief  Region keys, with a cache of their HMAC states (LRU, but scan-resistant, see putCache()). Private keys
+ *   (which are costlier to reload) are only evicted when there are no auto (hashtag) keys left in the cache.
+ */
 class TransportKeyStore {
-  uint16_t     cache_ids[MAX_TKS_ENTRIES];
-  TransportKey cache_keys[MAX_TKS_ENTRIES];
+  uint16_t         cache_ids[MAX_TKS_ENTRIES];
+  uint32_t         cache_used[MAX_TKS_ENTRIES];   // 'use_clock' at last access
+  bool             cache_private[MAX_TKS_ENTRIES];
+  TransportKeyHMAC cache_states[MAX_TKS_ENTRIES];
   int num_cache;
+  uint32_t use_clock;
+  uint32_t n_hits, n_misses, n_evictions;
 
-  void putCache(uint16_t id, const TransportKey& key);
+  int findCached(uint16_t id, const TransportKeyHMAC* dest[], int max_num);
+  const TransportKeyHMAC* putCache(uint16_t id, const TransportKey& key, bool is_private);
+  void invalidateCache(uint16_t id);
   void invalidateCache() { num_cache = 0; }
+  int fetchKeys(uint16_t id, TransportKey keys[], int max_num);
 
 public:
-  TransportKeyStore() { num_cache = 0; }
+  TransportKeyStore() { num_cache = 0; use_clock = 0; n_hits = n_misses = n_evictions = 0; }
+
+  /**
+   * \brief  the key for a publicly-known hashtag region. If 'name' doesn't start with '#', it is implied.
+   */
   void getAutoKeyFor(uint16_t id, const char* name, TransportKey& dest);
+
+  /**
+   * \brief  fetches the keys (with precomputed HMAC states) for region 'id', from cache where possible.
+   * \param  name  region name, for auto hashtag regions, or NULL for a private region.
+   * \returns  number of entries put in 'dest'. NOTE: only valid until next call to this store.
+   */
+  int getKeyStatesFor(uint16_t id, const char* name, const TransportKeyHMAC* dest[], int max_num);
   int loadKeysFor(uint16_t id, TransportKey keys[], int max_num);
   bool saveKeysFor(uint16_t id, const TransportKey keys[], int num);
   bool removeKeys(uint16_t id);
   bool clear();
+
+  uint32_t getNumCacheHits() const { return n_hits; }
+  uint32_t getNumCacheMisses() const { return n_misses; }
+  uint32_t getNumCacheEvictions() const { return n_evictions; }
+  int getCacheCount() const { return num_cache; }
 };
@@ -37,6 +37,13 @@ public:
    */
   static constexpr uint16_t BRIDGE_PACKET_MAGIC = 0xC03E;
 
+  /**
+   * @brief Magic number for stats push frames, which use the same framing as mesh packets
+   *
+   * Other bridges drop these frames, as the magic does not match BRIDGE_PACKET_MAGIC.
+   */
+  static constexpr uint16_t BRIDGE_STATS_MAGIC = 0xC05A;
+
   /**
    * @brief Common field sizes used by bridge implementations
    *
@@ -216,4 +216,33 @@ void ESPNowBridge::onPacketReceived(mesh::Packet *packet) {
   handleReceivedPacket(packet);
 }
 
+void ESPNowBridge::sendStats(const uint8_t *frame, int len) {
+  // Guard against uninitialized state
+  if (_initialized == false) {
+    return;
+  }
+  if (len > (int)MAX_PAYLOAD_SIZE) {
+    BRIDGE_DEBUG_PRINTLN("TX stats frame too large (len=%d)\n", len);
+    return;
+  }
+
+  uint8_t buffer[MAX_ESPNOW_PACKET_SIZE];
+  buffer[0] = (BRIDGE_STATS_MAGIC >> 8) & 0xFF;
+  buffer[1] = BRIDGE_STATS_MAGIC & 0xFF;
+
+  const size_t frameOffset = BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE;
+  memcpy(buffer + frameOffset, frame, len);
+
+  uint16_t checksum = fletcher16(buffer + frameOffset, len);
+  buffer[2] = (checksum >> 8) & 0xFF;
+  buffer[3] = checksum & 0xFF;
+
+  xorCrypt(buffer + BRIDGE_MAGIC_SIZE, len + BRIDGE_CHECKSUM_SIZE);
+
+  uint8_t broadcastAddress[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  if (esp_now_send(broadcastAddress, buffer, frameOffset + len) != ESP_OK) {
+    BRIDGE_DEBUG_PRINTLN("TX stats FAILED!\n");
+  }
+}
+
 #endif
@@ -152,6 +152,15 @@ public:
    * @param packet The mesh packet to transmit
    */
   void sendPacket(mesh::Packet *packet) override;
+
+  /**
+   * Broadcasts a stats push frame via ESP-NOW
+   * Uses the same framing and encryption as packets, but with BRIDGE_STATS_MAGIC
+   *
+   * @param frame The stats frame
+   * @param len Length of the frame in bytes
+   */
+  void sendStats(const uint8_t *frame, int len) override;
 };
 
 #endif
@@ -148,4 +148,28 @@ void RS232Bridge::onPacketReceived(mesh::Packet *packet) {
   handleReceivedPacket(packet);
 }
 
+void RS232Bridge::sendStats(const uint8_t *frame, int len) {
+  // Guard against uninitialized state
+  if (_initialized == false) {
+    return;
+  }
+  if (len > (MAX_TRANS_UNIT + 1)) {
+    BRIDGE_DEBUG_PRINTLN("TX stats frame too large (len=%d)\n", len);
+    return;
+  }
+
+  uint8_t buffer[MAX_SERIAL_PACKET_SIZE];
+  buffer[0] = (BRIDGE_STATS_MAGIC >> 8) & 0xFF;
+  buffer[1] = BRIDGE_STATS_MAGIC & 0xFF;
+  buffer[2] = (len >> 8) & 0xFF;
+  buffer[3] = len & 0xFF;
+  memcpy(buffer + 4, frame, len);
+
+  uint16_t checksum = fletcher16(buffer + 4, len);
+  buffer[4 + len] = (checksum >> 8) & 0xFF;
+  buffer[5 + len] = checksum & 0xFF;
+
+  _serial->write(buffer, len + SERIAL_OVERHEAD);
+}
+
 #endif
@@ -110,6 +110,17 @@ public:
    */
   void onPacketReceived(mesh::Packet *packet) override;
 
+  /**
+   * @brief Sends a stats push frame over serial
+   *
+   * Uses the same framing as packets, but with BRIDGE_STATS_MAGIC instead, so the
+   * frames are ignored by a peer RS232Bridge and can be picked out by a host collector.
+   *
+   * @param frame The stats frame
+   * @param len Length of the frame in bytes
+   */
+  void sendStats(const uint8_t *frame, int len) override;
+
 private:
   /**
    * RS232 Protocol Structure:
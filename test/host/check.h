@@ -0,0 +1,9 @@
+#pragma once
+
+// Shared by the host tests: counts failed checks, printing a printf style message for each.
+
+#include <stdio.h>
+
+static int errors = 0;
+
+#define CHECK(cond, ...)  do { if (!(cond)) { printf("FAIL: " __VA_ARGS__); printf("\n"); errors++; } } while (0)
@@ -0,0 +1,17 @@
+#pragma once
+
+// Counts ECDH calls (LocalIdentity::calcSharedSecret() and anything else using the ed25519 lib's key exchange), for
+// tests linked with -Wl,--wrap=ed25519_key_exchange. Include from one source file per test.
+
+#include <stdint.h>
+
+static uint32_t num_ecdh = 0;
+
+extern "C" void __real_ed25519_key_exchange(unsigned char* shared_secret, const unsigned char* public_key,
+                                            const unsigned char* private_key);
+
+extern "C" void __wrap_ed25519_key_exchange(unsigned char* shared_secret, const unsigned char* public_key,
+                                            const unsigned char* private_key) {
+  num_ecdh++;
+  __real_ed25519_key_exchange(shared_secret, public_key, private_key);
+}
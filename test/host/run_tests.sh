@@ -0,0 +1,83 @@
+#!/usr/bin/env bash
+
+# Builds and runs the host tests (no board needed), eg. from the repo root:
+#   sh test/host/run_tests.sh
+# Needs gcc/g++ with the Thread and Address sanitizers. Test binaries go in test/host/.build/
+#
+# sims/ holds the (python3) models used to evaluate some changes. They print tables, and aren't run here.
+
+cd "$(dirname "$0")" || exit 1
+
+CC=${CC:-gcc}
+CXX=${CXX:-g++}
+CXXFLAGS="-std=gnu++17 -g -O1 -Istubs -I../../src -I../../lib/ed25519"
+BUILD_DIR=.build
+mkdir -p $BUILD_DIR/ed25519
+
+failed=0
+
+# the core, for tests which need Identity/Utils (crypto is stubbed, see stubs/)
+for f in ../../lib/ed25519/*.c; do
+  $CC -c -O1 "$f" -o $BUILD_DIR/ed25519/$(basename "$f" .c).o || exit 1
+done
+CORE_SRCS="../../src/Utils.cpp ../../src/Identity.cpp $BUILD_DIR/ed25519/*.o"
+
+# run_test <name> <extra flags> <sources...>
+run_test() {
+  local name=$1
+  local flags=$2
+  shift 2
+  echo "== $name"
+  if ! $CXX $CXXFLAGS $flags "$@" -o $BUILD_DIR/$name -lpthread; then
+    echo "FAIL: $name did not build"
+    failed=1
+    return
+  fi
+  if ! $BUILD_DIR/$name; then
+    echo "FAIL: $name"
+    failed=1
+  fi
+}
+
+run_test test_geo_index "-fsanitize=address,undefined" test_geo_index.cpp
+run_test test_rate_limiter "-fsanitize=address,undefined -I../../examples/simple_repeater" test_rate_limiter.cpp
+run_test test_region_map "-DESP32 -fsanitize=address,undefined" test_region_map.cpp ../../src/helpers/RegionMap.cpp \
+  ../../src/helpers/TransportKeyStore.cpp ../../src/helpers/TxtDataHelpers.cpp $CORE_SRCS
+run_test test_transport_keys "-DESP32 -DMAX_TKS_ENTRIES=16 -DMAX_REGION_ENTRIES=128 -fsanitize=address,undefined" \
+  test_transport_keys.cpp ../../src/helpers/RegionMap.cpp ../../src/helpers/TransportKeyStore.cpp \
+  ../../src/helpers/TxtDataHelpers.cpp \
+  ../../src/Packet.cpp $CORE_SRCS
+run_test test_contacts "-DESP32 -DMAX_CONTACTS=5000 -fsanitize=address,undefined" test_contacts.cpp \
+  ../../src/helpers/BaseChatMesh.cpp ../../src/Mesh.cpp ../../src/Dispatcher.cpp ../../src/Packet.cpp \
+  ../../src/helpers/AdvertDataHelpers.cpp ../../src/helpers/TxtDataHelpers.cpp \
+  ../../src/helpers/StaticPoolPacketManager.cpp $CORE_SRCS
+run_test test_contacts_store "-DESP32 -fsanitize=address,undefined -I../../examples/companion_radio" \
+  test_contacts_store.cpp ../../examples/companion_radio/DataStore.cpp ../../src/helpers/IdentityStore.cpp $CORE_SRCS
+BLOB_STORE_SRCS="test_blob_store.cpp ../../examples/companion_radio/DataStore.cpp ../../src/helpers/IdentityStore.cpp \
+  ../../src/helpers/BaseChatMesh.cpp ../../src/Mesh.cpp ../../src/Dispatcher.cpp ../../src/Packet.cpp \
+  ../../src/helpers/AdvertDataHelpers.cpp ../../src/helpers/TxtDataHelpers.cpp \
+  ../../src/helpers/StaticPoolPacketManager.cpp $CORE_SRCS"
+run_test test_blob_store "-DESP32 -DMAX_CONTACTS=200 -fsanitize=address,undefined -I../../examples/companion_radio" \
+  $BLOB_STORE_SRCS
+run_test test_blob_store_1000 "-DESP32 -DMAX_CONTACTS=1000 -fsanitize=address,undefined -I../../examples/companion_radio" \
+  $BLOB_STORE_SRCS
+run_test test_offline_queue "-DESP32 -fsanitize=address,undefined -I../../examples/companion_radio" \
+  test_offline_queue.cpp ../../examples/companion_radio/OfflineQueue.cpp $CORE_SRCS
+run_test test_client_acl "-DESP32 -DMAX_CLIENTS=32 -fsanitize=address,undefined -Wl,--wrap=ed25519_key_exchange" \
+  test_client_acl.cpp ../../src/helpers/ClientACL.cpp $CORE_SRCS
+run_test test_anon_requests "-DESP32 -fsanitize=address,undefined -I../../examples/simple_repeater \
+  -Wl,--wrap=ed25519_key_exchange" test_anon_requests.cpp ../../src/helpers/ClientACL.cpp ../../src/Mesh.cpp \
+  ../../src/Dispatcher.cpp ../../src/Packet.cpp ../../src/helpers/StaticPoolPacketManager.cpp $CORE_SRCS
+run_test test_packet_log "-DESP32 -fsanitize=address,undefined -I../../examples/simple_repeater" test_packet_log.cpp \
+  ../../examples/simple_repeater/PacketLog.cpp ../../src/Packet.cpp $CORE_SRCS
+run_test test_queued_radio "-fsanitize=thread" test_queued_radio.cpp ../../src/helpers/QueuedRadio.cpp
+run_test test_post_store "-DESP32 -DMAX_STORED_POSTS=256 -fsanitize=address,undefined -I../../examples/simple_room_server" \
+  test_post_store.cpp ../../examples/simple_room_server/PostStore.cpp $CORE_SRCS
+run_test test_post_store_small "-DESP32 -DMAX_STORED_POSTS=64 -DPOST_LOG_MAX_BYTES=8192 -fsanitize=address,undefined \
+  -I../../examples/simple_room_server" test_post_store.cpp ../../examples/simple_room_server/PostStore.cpp $CORE_SRCS
+
+if [ $failed -ne 0 ]; then
+  echo "Some tests FAILED"
+  exit 1
+fi
+echo "All tests passed"
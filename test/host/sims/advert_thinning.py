@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Flood advert thinning model (examples/simple_repeater/AdvertThinning.h).
+
+Event-driven flood over clustered random geometric graphs: half the nodes
+gaussian around the centre, half uniform, on a 20x20 km area with 3.5 km
+range. One random node originates an advert. Each node which hears it for
+the first time decides to rebroadcast with probability target/degree (never
+below the floor), always if heard straight from the originator. A retransmit
+is scheduled 1 airtime + 0-4 half airtimes later. With 'rescue', a thinned
+node still queues the packet tentatively, and cancels it only if it hears
+another copy before its slot. There are no collisions or losses.
+
+Coverage is relative to the originator's connected component, and tx/node
+is transmissions per reachable node (1.00 = plain flooding).
+
+Usage:  python3 advert_thinning.py [--trials N] [--seed S]
+
+With the defaults (300 trials, seed 1) this gives the figures quoted in the
+commit: target 8 with rescue keeps ~99.2-99.4% coverage with 8%/23%/30%
+fewer transmissions at 40/80/120 nodes, vs 97.4% at 120 without rescue.
+"""
+import argparse, heapq, math, random
+
+AIR = 2   # airtime in half-airtime slots
+
+def run(N, size, range_km, target, pmin, rescue, trials, seed):
+  random.seed(seed)
+  cov = tx = full = 0
+  for _ in range(trials):
+    pts = [(random.gauss(size/2, size/10), random.gauss(size/2, size/10)) if i < N//2
+             else (random.uniform(0, size), random.uniform(0, size)) for i in range(N)]
+    nb = [[j for j in range(N) if j != i and math.dist(pts[i], pts[j]) < range_km] for i in range(N)]
+    o = random.randrange(N)
+
+    comp = {o}; st = [o]
+    while st:
+      u = st.pop()
+      for v in nb[u]:
+        if v not in comp: comp.add(v); st.append(v)
+
+    copies = [0]*N; got = {o}; ntx = 0
+    ev = [(0.0, 0, o, 'tx')]   # (time, seq, node, kind)
+    seq = 1; decided = {}
+    while ev:
+      tm, _, u, kind = heapq.heappop(ev)
+      if kind == 'tx':
+        ntx += 1
+        for v in nb[u]:
+          copies[v] += 1
+          if v in got: continue
+          got.add(v)
+          D = len(nb[v])
+          p = 1.0 if target == 0 or D <= target else max(pmin, target/D)
+          if u == o or random.random() < p:   # path_len 0 always rebroadcast
+            decided[v] = 'fwd'
+          else:
+            decided[v] = 'tentative' if rescue else 'drop'
+          if decided[v] != 'drop':
+            heapq.heappush(ev, (tm + AIR + random.randrange(5), seq, v, 'check')); seq += 1
+      else:   # retransmit slot reached
+        if decided[u] == 'tentative' and copies[u] >= 2: continue   # relayed by another, cancel
+        heapq.heappush(ev, (tm, seq, u, 'tx')); seq += 1
+    cov += len(got)/len(comp); tx += ntx/len(comp); full += len(got) == len(comp)
+  return cov/trials, tx/trials, full/trials
+
+def main():
+  ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+  ap.add_argument('--trials', type=int, default=300)
+  ap.add_argument('--seed', type=int, default=1)
+  args = ap.parse_args()
+
+  for N in (40, 80, 120):
+    print("nodes=%d" % N)
+    for target, pmin, rescue in [(0, 0, 0), (8, .25, 0), (4, .125, 1), (6, .125, 1), (8, .125, 1), (8, .25, 1)]:
+      c, t, f = run(N, 20, 3.5, target, pmin, rescue, args.trials, args.seed)
+      print("  target=%d floor=%.3f rescue=%d  coverage=%.3f  tx/node=%.2f  full=%.2f"
+              % (target, pmin, rescue, c, t, f))
+
+if __name__ == '__main__':
+  main()
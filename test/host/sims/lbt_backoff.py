@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""
+Listen-before-talk backoff model (Dispatcher::checkSend(), Mesh::getCADFailRetryDelay()
+and Mesh::getTxDeferDelay()).
+
+N nodes in one collision domain, 330 ms packets, 25 ms preamble detect (a
+receiver's isReceiving() only sees a transmission after this), 10 ms turnaround.
+Each node originates packets at 'load' per minute (priority 0,0,1,1,3), and
+every node which cleanly hears a packet for the first time relays it with
+probability q, 0-4 x airtime/2 later (priority 1). A reception is clean if no
+other transmission overlaps it. A node whose channel has been busy for over
+4 s sends anyway (a forced send).
+
+  old:  busy -> retry in 1-3 slots of 120 ms
+  new:  busy -> retry in 1..2^(e+attempt) slots, e = 1/2/3 by priority class,
+        capped at --max-exp; once clear after a backoff, send with
+        probability 1, 3/4 or 1/2 (by class), else defer a slot
+
+Prints the clean-reception ratio, transmissions, forced sends, busy ratio,
+deferrals and p50/p95 queue latency (ms), averaged over seeds 0..--seeds-1 of
+10 simulated minutes each.
+
+Usage:  python3 lbt_backoff.py [--seeds N] [--max-exp E] [--no-persist]
+
+The defaults give the figures quoted in the commit (0.68 -> 0.77, 0.45 -> 0.53,
+0.35 -> 0.41); --no-persist shows how much of that the p-persistence adds.
+"""
+import argparse, heapq, random
+
+AIR = 330.0      # ms, ~40 byte packet
+DETECT = 25.0    # ms before a receiver sees a new transmission
+TURN = 10.0      # ms from decision to on-air
+SLOT = 120       # LBT_SLOT_MILLIS
+MAX_BUSY = 4000  # Dispatcher::getCADFailMaxDuration()
+
+def run(policy, N, load_per_min, q, seed, max_exp, persistence, T=600000):
+  rng = random.Random(seed)
+  ev = []; seqn = [0]
+  def push(t, kind, *a):
+    seqn[0] += 1; heapq.heappush(ev, (t, seqn[0], kind, a))
+  txs = []                          # (start, end, node)
+  queue = [[] for _ in range(N)]    # (due, pri, pid, created)
+  state = [dict(next_tx=0, busy_start=0, att=0, sending_until=-1) for _ in range(N)]
+  seen = [set() for _ in range(N)]
+  stats = dict(tx=0, ok=0, coll=0, forced=0, checks=0, busy=0, defer=0, lat=[])
+  pid = [0]
+  for n in range(N):
+    push(rng.expovariate(load_per_min/60000.0), 'gen', n)
+
+  def busy(n, t):
+    return any(m != n and s + DETECT <= t < e for (s, e, m) in txs)
+  def cls(pri): return 0 if pri == 0 else (1 if pri <= 2 else 2)
+  def retry(pri, att):
+    if policy == 'old': return rng.randint(1, 3)*SLOT
+    e = min(cls(pri) + 1 + att, max_exp)
+    return rng.randint(1, 1 << e)*SLOT
+
+  def check(n, t):
+    st = state[n]
+    if st['sending_until'] > t: return
+    due = [x for x in queue[n] if x[0] <= t]
+    if not due or t < st['next_tx']: return
+    pri = min(x[1] for x in due)
+    stats['checks'] += 1
+    if busy(n, t):
+      stats['busy'] += 1
+      if st['busy_start'] == 0: st['busy_start'] = t
+      if t - st['busy_start'] > MAX_BUSY:
+        stats['forced'] += 1
+      else:
+        st['next_tx'] = t + retry(pri, st['att']); st['att'] += 1
+        push(st['next_tx'], 'chk', n); return
+    elif st['att'] > 0 and policy != 'old':
+      if rng.randrange(256) >= persistence[cls(pri)]:
+        stats['defer'] += 1
+        st['busy_start'] = 0   # a clear check restarts the max-duration timer
+        st['next_tx'] = t + SLOT; push(st['next_tx'], 'chk', n); return
+    st['busy_start'] = 0; st['att'] = 0
+    due.sort(key=lambda x: (x[1], x[0])); item = due[0]; queue[n].remove(item)
+    s = t + TURN; e = s + AIR
+    txs.append((s, e, n)); st['sending_until'] = e
+    stats['tx'] += 1; stats['lat'].append(s - item[3])
+    push(e, 'end', n, s, item[2])
+    st['next_tx'] = e
+
+  def enqueue(n, t, pri, p, created_t, delay=0):
+    queue[n].append((t + delay, pri, p, created_t)); push(t + delay, 'chk', n)
+
+  while ev:
+    t, _, kind, a = heapq.heappop(ev)
+    if t > T: break
+    txs = [x for x in txs if x[1] > t - 2*AIR]
+    if kind == 'gen':
+      n = a[0]; pid[0] += 1; p = pid[0]; seen[n].add(p)
+      enqueue(n, t, rng.choice([0, 0, 1, 1, 3]), p, t)
+      push(t + rng.expovariate(load_per_min/60000.0), 'gen', n)
+    elif kind == 'chk':
+      check(a[0], t)
+    elif kind == 'end':
+      n, s, p = a
+      for m in range(N):
+        if m == n: continue
+        ok = not any(o != n and os < t and oe > s for (os, oe, o) in txs)
+        stats['ok' if ok else 'coll'] += 1
+        if ok and p not in seen[m]:
+          seen[m].add(p)
+          if rng.random() < q:
+            enqueue(m, t, 1, p, t, rng.randint(0, 4)*AIR*0.52)
+      check(n, t)
+
+  lat = sorted(stats['lat'])
+  return dict(pdr=stats['ok']/max(1, stats['ok'] + stats['coll']), tx=stats['tx'], forced=stats['forced'],
+              busyr=stats['busy']/max(1, stats['checks']), defer=stats['defer'],
+              p50=lat[len(lat)//2] if lat else 0, p95=lat[int(len(lat)*.95)] if lat else 0)
+
+def main():
+  ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+  ap.add_argument('--seeds', type=int, default=4)
+  ap.add_argument('--max-exp', type=int, default=4, help='LBT_MAX_BACKOFF_EXP')
+  ap.add_argument('--no-persist', action='store_true', help='always send once clear (no p-persistence)')
+  args = ap.parse_args()
+  persistence = (256, 256, 256) if args.no_persist else (256, 192, 128)
+
+  for N, load, q in [(10, 0.5, 0.3), (20, 0.5, 0.3), (20, 1, 0.3), (30, 1, 0.25), (40, 1, 0.2)]:
+    for pol in ('old', 'new'):
+      rs = [run(pol, N, load, q, s, args.max_exp, persistence) for s in range(args.seeds)]
+      avg = lambda k: sum(r[k] for r in rs)/len(rs)
+      print("N=%d load=%g/min q=%g %s: clean=%.3f tx=%.0f forced=%.1f busy=%.2f defer=%.0f p50=%.0f p95=%.0f"
+              % (N, load, q, pol, avg('pdr'), avg('tx'), avg('forced'), avg('busyr'), avg('defer'), avg('p50'), avg('p95')))
+
+if __name__ == '__main__':
+  main()
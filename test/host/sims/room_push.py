@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""
+Room server push scheduling model (examples/simple_room_server/MyMesh.cpp).
+
+Discrete-event model of the server's collision domain. SF10/BW250 airtimes, a
+Dispatcher airtime factor of 1.0, clients on direct paths of 0-3 hops, with
+per-hop loss outside the server's domain, and a half duplex server which
+misses ACKs arriving while it transmits. Clients reset their push failures
+every minute, as keep-alives do.
+
+  old:  one push every 1.2 s, round robin, one pending ACK per client
+  new:  MAX_PUSHES_IN_FLIGHT (32) slots, up to 'w' posts awaiting ACK per
+        client, timed-out slots re-pushed first (the previous ACK is still
+        accepted), windows filled while the outbound queue holds < 2 packets.
+        A client reaching 3 push failures has its slots released.
+
+Prints the time until every (online) client has all its posts, the median
+client, and the number of pushes sent, averaged over seeds 0-4.
+
+Usage:  python3 room_push.py [--loss L] [--offline K] [--no-release]
+
+  --offline K    the first K clients never receive anything (eg. gone away)
+  --no-release   keep the slots of clients at the failure limit (until their
+                 next keep-alive), as before they were released
+
+With --no-release (the model at the time) this gives the figures quoted in
+the commit: 79s -> 39s, 224s -> 184s and 816s -> 702s at 3% loss, and
+1122s -> 942s for 20 clients at --loss 0.1. Releasing the slots costs a few
+percent here (189s, 708s, and 1023s at 10% loss), as a client on a lossy path
+hits the limit and is re-pushed from its oldest unacknowledged post. But with
+--offline 40 and 1 online client, that client syncs in ~160s with the release,
+and never without it, as the offline clients hold every slot.
+"""
+import argparse, heapq, math, random
+
+def airtime(n, sf=10, bw=250e3, cr=1, pre=16):
+    ts = (2**sf)/bw
+    de = 0
+    nsym = 8 + max(math.ceil((8*n - 4*sf + 28 + 16)/(4*(sf-2*de)))*(cr+4), 0)
+    return int(((pre+4.25) + nsym) * ts * 1000)
+
+A_PUSH = airtime(72); A_ACK = airtime(12)
+LOSS = 0.03   # per hop, outside server's domain (--loss)
+
+class Sim:
+    def __init__(s, mode, nclients, nposts, seed, window=4, factor=1.0, offline=0, release=True):
+        random.seed(seed)
+        s.mode, s.window, s.factor, s.release = mode, window, factor, release
+        s.now = 0
+        s.ev = []; s.seq = 0
+        s.chan = []          # (start, end, id) in server's collision domain
+        s.clients = []
+        for i in range(nclients):
+            s.clients.append(dict(path=random.choice([0,1,1,2,2,3]), r1=random.randrange(3),
+                                  todo=list(range(1, nposts+1)), got=set(), since=0, frontier=0,
+                                  pending=None, ptime=0, pts=0, fails=0, done_at=None, nposts=nposts))
+        s.offline = s.clients[:offline]
+        s.online = s.clients[offline:]
+        s.slots = {}         # new mode: ack -> [client, post, timeout(0=retry), prev_ack]
+        s.queue = []         # server outbound (packets)
+        s.next_tx = 0; s.busy_until = 0
+        s.next_push = 0; s.rr = 0
+        s.acks = 0; s.n_push = 0
+    def at(s, t, fn, *a):
+        s.seq += 1; heapq.heappush(s.ev, (t, s.seq, fn, a))
+    def chan_idle(s):
+        return all(e <= s.now for (_, e, _) in s.chan)
+    def domain_tx(s, dur, on_ok, tag):
+        # transmission in server's domain, success iff no overlap
+        st, en = s.now, s.now + dur
+        rec = [st, en, tag]
+        s.chan.append(rec)
+        s.at(en, s.domain_done, rec, on_ok)
+    def domain_done(s, rec, on_ok):
+        ok = not any(r is not rec and r[0] < rec[1] and r[1] > rec[0] for r in s.chan)
+        s.chan = [r for r in s.chan if r[1] > s.now - 5000]
+        if ok and on_ok: on_ok()
+    def relay_lbt(s, dur, on_ok, tag):   # repeater/client in domain, with LBT + random delay
+        def go():
+            if not s.chan_idle():
+                s.at(s.now + random.randint(50, 400), go); return
+            s.domain_tx(dur, on_ok, tag)
+        s.at(s.now + random.randint(0, A_PUSH), go)
+    # --- server dispatcher ---
+    def dispatch(s):
+        if s.queue and s.now >= s.next_tx and s.now >= s.busy_until and s.chan_idle():
+            pkt = s.queue.pop(0)
+            dur = A_PUSH
+            s.busy_until = s.now + dur
+            s.next_tx = s.now + dur + int(dur * s.factor)
+            s.domain_tx(dur, lambda p=pkt: s.push_out(p), 'S')
+        s.at(s.now + 10, s.dispatch)
+    def push_out(s, pkt):
+        c, post, ack = pkt
+        if c in s.offline: return
+        hops = c['path']
+        t = s.now
+        if hops == 0:
+            s.client_rx(c, post, ack); return
+        # r1 forwards in domain
+        def fwd():
+            if random.random() < LOSS: return
+            dly = sum(A_PUSH + random.randint(0, A_PUSH) for _ in range(hops - 1))
+            if any(random.random() < LOSS for _ in range(hops - 1)): return
+            s.at(s.now + dly, s.client_rx, c, post, ack)
+        s.relay_lbt(A_PUSH, fwd, 'R')
+    def client_rx(s, c, post, ack):
+        c['got'].add(post)
+        hops = c['path']
+        def ack_back():
+            if hops == 0:
+                s.relay_lbt(A_ACK, lambda: s.server_ack(ack), 'C'); return
+            dly = sum(A_ACK + random.randint(0, A_ACK) for _ in range(hops - 1))
+            if any(random.random() < LOSS for _ in range(hops)): return
+            s.at(s.now + dly, lambda: s.relay_lbt(A_ACK, lambda: s.server_ack(ack), 'R'))
+        s.at(s.now + 200, ack_back)
+    def server_ack(s, ack):
+        if s.busy_until > s.now - A_ACK:   # half duplex: was transmitting
+            return
+        s.acks += 1
+        if s.mode == 'old':
+            for c in s.clients:
+                if c['pending'] == ack:
+                    c['pending'] = None; c['fails'] = 0; c['since'] = c['pts']
+                    s.check_done(c)
+        else:
+            for k, sl in list(s.slots.items()):
+                if k == ack or sl[3] == ack:
+                    del s.slots[k]
+                    c = sl[0]; c['fails'] = 0
+                    outs = [x[1] for x in s.slots.values() if x[0] is c]
+                    c['since'] = min(outs) - 1 if outs else c['frontier']
+                    s.check_done(c)
+                    break
+    def check_done(s, c):
+        if c['since'] >= c['nposts'] and c['done_at'] is None: c['done_at'] = s.now
+    def timeout_for(s, c, ahead=0):
+        if c['path'] < 0: return 12000
+        return 4000 + 2000 * (c['path'] + 1) + ahead * (c['path'] + 1) * A_PUSH
+    def newack(s):
+        s.seq += 1; return s.seq
+    # --- schedulers ---
+    def old_loop(s):
+        if s.now >= s.next_push:
+            for c in s.clients:
+                if c['pending'] and s.now >= c['ptime']:
+                    c['fails'] += 1; c['pending'] = None
+            c = s.clients[s.rr]; did = False
+            if c['pending'] is None and c['fails'] < 3 and c['since'] < c['nposts']:
+                post = c['since'] + 1
+                ack = s.newack(); c['pending'] = ack; c['pts'] = post; c['ptime'] = s.now + s.timeout_for(c)
+                s.queue.append((c, post, ack)); s.n_push += 1; did = True
+            s.rr = (s.rr + 1) % len(s.clients)
+            s.next_push = s.now + (1200 if did else 150)
+        s.at(s.now + 10, s.old_loop)
+    def new_push(s, c):
+        if c['fails'] >= 3: return False
+        live = [k for k, x in s.slots.items() if x[0] is c and x[2]]
+        if len(live) >= s.window: return False
+        retry = [k for k, x in s.slots.items() if x[0] is c and not x[2]]
+        if retry:
+            k = min(retry, key=lambda k: s.slots[k][1]); sl = s.slots.pop(k)
+            ack = s.newack(); sl[3] = k; sl[2] = s.now + s.timeout_for(c, len(live)); s.slots[ack] = sl
+            s.queue.append((c, sl[1], ack)); s.n_push += 1; return True
+        if len(s.slots) >= 32 or c['frontier'] >= c['nposts']: return False
+        post = c['frontier'] + 1; c['frontier'] = post
+        ack = s.newack(); s.slots[ack] = [c, post, s.now + s.timeout_for(c, len(live)), 0]
+        s.queue.append((c, post, ack)); s.n_push += 1; return True
+    def new_loop(s):
+        if s.now >= s.next_push:
+            for k, sl in list(s.slots.items()):
+                if k not in s.slots: continue   # released below
+                if sl[2] and s.now >= sl[2]:
+                    c = sl[0]; sl[2] = 0; c['fails'] += 1
+                    if c['fails'] >= 3 and s.release:   # releasePushes()
+                        for k2 in [k2 for k2, x in s.slots.items() if x[0] is c]: del s.slots[k2]
+                        c['frontier'] = c['since']
+            n = len(s.clients); idle = 0
+            while idle < n and len(s.queue) < 2:
+                if s.new_push(s.clients[s.rr]): idle = 0
+                else: idle += 1
+                s.rr = (s.rr + 1) % n
+            s.next_push = s.now + 150
+        s.at(s.now + 10, s.new_loop)
+    def keepalive(s):   # clients reset push_failures periodically (as keep-alives do)
+        for c in s.online: c['fails'] = 0
+        s.at(s.now + 60000, s.keepalive)
+    def run(s, limit=3600*1000):
+        s.at(0, s.dispatch); s.at(0, s.old_loop if s.mode == 'old' else s.new_loop); s.at(60000, s.keepalive)
+        while s.ev:
+            t, _, fn, a = heapq.heappop(s.ev)
+            if t > limit: break
+            s.now = t; fn(*a)
+            if all(c['done_at'] is not None for c in s.online): break
+        d = [c['done_at'] if c['done_at'] is not None else limit for c in s.online]
+        return max(d) / 1000, sorted(d)[len(d)//2] / 1000, s.n_push, sum(c['done_at'] is None for c in s.online)
+
+def main():
+    global LOSS
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument('--loss', type=float, default=0.03, help='loss per hop')
+    ap.add_argument('--offline', type=int, default=0)
+    ap.add_argument('--no-release', action='store_true')
+    args = ap.parse_args()
+    LOSS = args.loss
+
+    print("airtime push=%dms ack=%dms, loss/hop=%.2f, offline=%d" % (A_PUSH, A_ACK, LOSS, args.offline))
+    for nc, npo in [(1, 30), (5, 30), (20, 30)]:
+        nc += args.offline
+        for mode, w in [('old', 1), ('new', 1), ('new', 2), ('new', 4)]:
+            r = [Sim(mode, nc, npo, seed, window=w, offline=args.offline, release=not args.no_release).run() for seed in range(5)]
+            mx = sum(x[0] for x in r)/len(r); md = sum(x[1] for x in r)/len(r); np_ = sum(x[2] for x in r)/len(r); nd = sum(x[3] for x in r)
+            print("clients=%2d posts=%d %s w=%d: all synced %6.0fs  median client %6.0fs  pushes %5.0f (min %d)  unfinished %d"
+                  % (nc, npo, mode, w, mx, md, np_, (nc - args.offline)*npo, nd))
+
+if __name__ == '__main__':
+    main()
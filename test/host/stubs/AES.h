@@ -0,0 +1,24 @@
+#pragma once
+
+// Host build stand-in for the Crypto library's AES128. NOT a real cipher (just XOR with the key), so host tests
+// must not depend on actual ciphertext.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+class AES128 {
+  uint8_t k[16];
+public:
+  bool setKey(const uint8_t* key, size_t len) {
+    memset(k, 0, sizeof(k));
+    memcpy(k, key, len < sizeof(k) ? len : sizeof(k));
+    return true;
+  }
+  void encryptBlock(uint8_t* output, const uint8_t* input) {
+    for (int i = 0; i < 16; i++) output[i] = input[i] ^ k[i];
+  }
+  void decryptBlock(uint8_t* output, const uint8_t* input) {
+    for (int i = 0; i < 16; i++) output[i] = input[i] ^ k[i];
+  }
+};
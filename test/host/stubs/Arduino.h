@@ -0,0 +1,20 @@
+#pragma once
+
+// Host build stand-in for the Arduino core, just enough for the code under test.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <Stream.h>
+
+unsigned long millis();
+
+inline char* ltoa(long value, char* str, int base) {   // only base 10 is used
+  sprintf(str, "%ld", value);
+  return str;
+}
+
+#define constrain(amt, low, high)  ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
@@ -0,0 +1,11 @@
+#pragma once
+
+// Host build stand-in for the Crypto library's Ed25519. Signatures are NOT checked.
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Ed25519 {
+public:
+  static bool verify(const uint8_t* signature, const uint8_t* public_key, const void* message, size_t len) { return true; }
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+// Host build stand-in for the ESP32 FS library: an in-memory filesystem. Files are shared byte vectors, so an open
+// File still sees later writes, and tests can reach in (via memfs_files()) to corrupt or truncate them.
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::shared_ptr<std::vector<uint8_t>> MemFileData;
+
+inline std::map<std::string, MemFileData>& memfs_files() {
+  static std::map<std::string, MemFileData> files;
+  return files;
+}
+
+// I/O counts, so tests can report flash traffic, a capacity (0 = unlimited) so they can fill the filesystem, and
+// a write() call to fail (once, when num_writes reaches fail_write)
+struct MemFSStats {
+  size_t bytes_read, bytes_written, num_opens, num_writes;
+  size_t capacity;
+  size_t fail_write;
+};
+
+inline MemFSStats& memfs_stats() {
+  static MemFSStats stats;
+  return stats;
+}
+
+inline size_t memfs_used() {
+  size_t n = 0;
+  for (auto& f : memfs_files()) n += f.second->size();
+  return n;
+}
+
+class File : public Stream {
+  MemFileData d;
+  size_t pos = 0;
+public:
+  File() { }
+  File(MemFileData data, size_t start) : d(data), pos(start) { }
+
+  operator bool() const { return d != nullptr; }
+  size_t read(uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len && pos < d->size()) buf[n++] = (*d)[pos++];
+    memfs_stats().bytes_read += n;
+    return n;
+  }
+  int read() override {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  size_t write(const uint8_t* buf, size_t len) override {
+    if (++memfs_stats().num_writes == memfs_stats().fail_write) return 0;
+    size_t cap = memfs_stats().capacity;
+    size_t used = cap ? memfs_used() : 0;
+    size_t i;
+    for (i = 0; i < len; i++, pos++) {
+      if (pos >= d->size()) {
+        if (cap && used >= cap) break;   // full
+        d->push_back(buf[i]);
+        used++;
+      } else {
+        (*d)[pos] = buf[i];
+      }
+    }
+    memfs_stats().bytes_written += i;
+    return i;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  int available() override { return d->size() - pos; }
+  int peek() override { return pos < d->size() ? (*d)[pos] : -1; }
+  bool seek(uint32_t p) {
+    if (p > d->size()) return false;
+    pos = p;
+    return true;
+  }
+  size_t position() const { return pos; }
+  size_t size() const { return d->size(); }
+  void close() { d = nullptr; }
+
+  // no directories here
+  bool isDirectory() const { return false; }
+  File openNextFile() { return File(); }
+  const char* name() const { return ""; }
+};
+
+namespace fs {
+
+class FS {
+public:
+  File open(const char* path, const char* mode = "r", bool create = false) {
+    auto& files = memfs_files();
+    auto it = files.find(path);
+    memfs_stats().num_opens++;
+    if (mode[0] == 'w' || (mode[0] == 'a' && it == files.end())) {
+      auto d = std::make_shared<std::vector<uint8_t>>();
+      files[path] = d;
+      return File(d, 0);
+    }
+    if (it == files.end()) return File();
+    return File(it->second, mode[0] == 'a' ? it->second->size() : 0);
+  }
+  bool exists(const char* path) { return memfs_files().count(path) > 0; }
+  bool remove(const char* path) { return memfs_files().erase(path) > 0; }
+  bool rename(const char* from, const char* to) {
+    auto& files = memfs_files();
+    auto it = files.find(from);
+    if (it == files.end()) return false;
+    files[to] = it->second;
+    files.erase(from);
+    return true;
+  }
+  bool mkdir(const char* path) { return true; }
+  bool rmdir(const char* path) { return true; }
+};
+
+}
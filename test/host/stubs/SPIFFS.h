@@ -0,0 +1,21 @@
+#pragma once
+
+// Host build stand-in for the ESP32 SPIFFS filesystem, over the in-memory one in FS.h
+
+#include <FS.h>
+
+namespace fs {
+
+class SPIFFSFS : public FS {
+public:
+  bool format() {
+    memfs_files().clear();
+    return true;
+  }
+  size_t usedBytes() { return memfs_used(); }
+  size_t totalBytes() { return memfs_stats().capacity ? memfs_stats().capacity : 1024*1024; }
+};
+
+}
+
+inline fs::SPIFFSFS SPIFFS;
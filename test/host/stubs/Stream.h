@@ -0,0 +1,43 @@
+#pragma once
+
+// Host build stand-in for the Arduino Print/Stream classes, just enough for the code under test.
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class Stream {
+public:
+  virtual ~Stream() { }
+
+  virtual size_t write(uint8_t c) { return 1; }
+  virtual size_t write(const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len && write(buf[n])) n++;
+    return n;
+  }
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  virtual void flush() { }
+
+  size_t readBytes(uint8_t* buf, size_t len) {
+    size_t n = 0;
+    int c;
+    while (n < len && (c = read()) >= 0) buf[n++] = c;
+    return n;
+  }
+  size_t print(const char* s) { return write((const uint8_t *) s, strlen(s)); }
+  size_t print(char c) { return write((uint8_t) c); }
+  size_t println(const char* s = "") { return print(s) + print('\n'); }
+  size_t printf(const char* format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    return print(buf);
+  }
+};
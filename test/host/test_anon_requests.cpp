@@ -0,0 +1,194 @@
+// The repeater's checks on anonymous requests (AnonRequestFilter), driven through Mesh::onRecvPacket(). Checks they
+// run before the ECDH, that requests spoofed in an admin's name are dropped without one (and don't lock the admin
+// out), and that a flood of requests from random keys is held to a bounded number of ECDH calls, and CPU time.
+
+#include <Mesh.h>
+#include <helpers/SimpleMeshTables.h>
+#include <helpers/StaticPoolPacketManager.h>
+#include "AnonRequestFilter.h"
+#include "check.h"
+#include "ecdh_count.h"
+#include <chrono>
+#include <stdlib.h>
+
+#define SENDER_SECS    30   // as simple_repeater's anon_limiter
+#define SENDER_BURST   3
+#define GLOBAL_SECS    15
+#define GLOBAL_BURST   4
+
+#define FLOOD_MINS     5
+#define REQ_INTERVAL   60   // millis, ie. 1000/min
+
+class NullRadio : public mesh::Radio {
+public:
+  int recvRaw(uint8_t* bytes, int sz) override { return 0; }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return len_bytes; }
+  float packetScore(float snr, int packet_len) override { return 1.0f; }
+  bool startSendRaw(const uint8_t* bytes, int len) override { return true; }
+  bool isSendComplete() override { return true; }
+  void onSendFinished() override { }
+  bool isInRecvMode() const override { return true; }
+};
+
+class TestClock : public mesh::MillisecondClock {
+public:
+  unsigned long now = 1000;
+  unsigned long getMillis() override { return now; }
+};
+
+class TestRTC : public mesh::RTCClock {
+public:
+  uint32_t getCurrentTime() override { return 1715770351; }
+  void setCurrentTime(uint32_t time) override { }
+};
+
+class TestRNG : public mesh::RNG {
+public:
+  void random(uint8_t* dest, size_t sz) override {
+    for (size_t i = 0; i < sz; i++) dest[i] = rand() & 0xFF;
+  }
+};
+
+static NullRadio radio;
+static TestClock ms;
+static TestRTC rtc;
+static TestRNG rng;
+static StaticPoolPacketManager pkt_mgr(4);
+
+// a repeater's Mesh, as far as anonymous requests go. With no filter, every request for us gets an ECDH (as before).
+class TestMesh : public mesh::Mesh {
+  SimpleMeshTables tables;
+  ClientACL* _acl;
+  SenderRateLimiter limiter;
+  AnonRequestFilter filter;
+  bool _filtering;
+
+protected:
+  bool allowAnonRequest(const mesh::Packet* packet, const uint8_t* sender_pub_key) override {
+    num_allow_calls++;
+    ecdh_at_allow = num_ecdh;
+    return !_filtering || filter.allow(packet, sender_pub_key, _ms->getMillis());
+  }
+  void onAnonDataRecv(mesh::Packet* packet, const uint8_t* secret, const mesh::Identity& sender, uint8_t* data, size_t len) override {
+    num_recv++;
+    if (_acl->getClient(sender.pub_key, PUB_KEY_SIZE)) num_client_recv++;
+  }
+
+public:
+  uint32_t num_allow_calls = 0, ecdh_at_allow = 0, num_recv = 0, num_client_recv = 0;
+
+  TestMesh(ClientACL& acl, bool filtering)
+    : mesh::Mesh(radio, ms, rng, rtc, pkt_mgr, tables), _acl(&acl),
+      limiter(SENDER_SECS, SENDER_BURST, GLOBAL_SECS, GLOBAL_BURST), filter(acl, limiter), _filtering(filtering) { }
+
+  void recv(mesh::Packet* pkt) { onRecvPacket(pkt); }
+};
+
+// an ANON_REQ for 'self': encrypted with 'secret', or just junk (ie. MAC won't match) if NULL
+static void makeRequest(mesh::Packet& pkt, const mesh::LocalIdentity& self, const uint8_t* sender_pub_key,
+                        const uint8_t* secret) {
+  pkt.header = ROUTE_TYPE_FLOOD | (PAYLOAD_TYPE_ANON_REQ << PH_TYPE_SHIFT);
+  pkt.path_len = 0;
+  int i = self.copyHashTo(pkt.payload);
+  memcpy(&pkt.payload[i], sender_pub_key, PUB_KEY_SIZE); i += PUB_KEY_SIZE;
+  uint8_t data[16];
+  rng.random(data, sizeof(data));   // (timestamp, password, etc)
+  if (secret) {
+    i += mesh::Utils::encryptThenMAC(secret, &pkt.payload[i], data, sizeof(data));
+  } else {
+    rng.random(&pkt.payload[i], CIPHER_MAC_SIZE + sizeof(data));
+    i += CIPHER_MAC_SIZE + sizeof(data);
+  }
+  pkt.payload_len = i;
+}
+
+// through Mesh::onRecvPacket(): allowAnonRequest() is asked first, and the ECDH only follows if it allows
+static bool recv(TestMesh& m, mesh::Packet& pkt) {
+  uint32_t ecdh = num_ecdh, allow_calls = m.num_allow_calls, recvd = m.num_recv;
+  m.recv(&pkt);
+  bool allowed = num_ecdh > ecdh;
+  CHECK(m.num_allow_calls == allow_calls + 1, "allowAnonRequest() called %d times", m.num_allow_calls - allow_calls);
+  CHECK(m.ecdh_at_allow == ecdh, "ECDH before allowAnonRequest()");
+  CHECK(num_ecdh - ecdh <= 1, "%d ECDH for one request", num_ecdh - ecdh);
+  return allowed && m.num_recv > recvd;
+}
+
+static double elapsedMillis(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+int main() {
+  srand(1);
+  ClientACL acl;
+  TestMesh repeater(acl, true);
+  repeater.self_id = mesh::LocalIdentity(&rng);
+  mesh::LocalIdentity admin(&rng), attacker(&rng);
+  acl.applyPermissions(repeater.self_id, admin.pub_key, PUB_KEY_SIZE, PERM_ACL_ADMIN);
+  uint8_t admin_secret[PUB_KEY_SIZE], attacker_secret[PUB_KEY_SIZE];
+  admin.calcSharedSecret(admin_secret, repeater.self_id.pub_key);
+  attacker.calcSharedSecret(attacker_secret, repeater.self_id.pub_key);
+
+  mesh::Packet pkt;
+  makeRequest(pkt, repeater.self_id, admin.pub_key, admin_secret);
+  CHECK(recv(repeater, pkt), "admin's request dropped");
+
+  // requests in the admin's name (junk, or encrypted with another key): no ECDH, and not charged to the admin
+  uint32_t ecdh = num_ecdh;
+  int spoofs_allowed = 0;
+  for (int i = 0; i < 1000; i++, ms.now += REQ_INTERVAL) {
+    makeRequest(pkt, repeater.self_id, admin.pub_key, i % 2 ? attacker_secret : NULL);
+    spoofs_allowed += recv(repeater, pkt);
+  }
+  CHECK(spoofs_allowed == 0 && num_ecdh == ecdh, "spoofed admin: %d allowed, %d ECDH", spoofs_allowed,
+        num_ecdh - ecdh);
+  int admin_allowed = 0;
+  for (int i = 0; i < SENDER_BURST; i++) {
+    makeRequest(pkt, repeater.self_id, admin.pub_key, admin_secret);
+    admin_allowed += recv(repeater, pkt);
+  }
+  CHECK(admin_allowed == SENDER_BURST, "admin locked out by spoofs: %d of %d allowed", admin_allowed, SENDER_BURST);
+
+  // a flood from random keys (1000/min), while the admin logs in once a minute. And the same, without the filter.
+  TestMesh unfiltered(acl, false);
+  unfiltered.self_id = repeater.self_id;
+  uint32_t ecdh_filtered = 0, ecdh_unfiltered = 0;
+  double ms_filtered = 0, ms_unfiltered = 0;
+  int admin_tries = 0;
+  admin_allowed = 0;
+  ms.now += SENDER_SECS*SENDER_BURST*1000;   // (admin's bucket refilled)
+  unsigned long end = ms.now + FLOOD_MINS*60000UL;
+  for (int i = 0; ms.now < end; i++, ms.now += REQ_INTERVAL) {
+    bool is_admin = i % (60000 / REQ_INTERVAL) == 0;
+    uint8_t key[PUB_KEY_SIZE];
+    rng.random(key, sizeof(key));
+    makeRequest(pkt, repeater.self_id, is_admin ? admin.pub_key : key, is_admin ? admin_secret : NULL);
+    mesh::Packet copy = pkt;
+
+    ecdh = num_ecdh;
+    auto t = std::chrono::steady_clock::now();
+    bool recvd = recv(repeater, pkt);
+    ms_filtered += elapsedMillis(t);
+    ecdh_filtered += num_ecdh - ecdh;
+    if (is_admin) {
+      admin_tries++;
+      admin_allowed += recvd;
+    }
+
+    ecdh = num_ecdh;
+    t = std::chrono::steady_clock::now();
+    recv(unfiltered, copy);
+    ms_unfiltered += elapsedMillis(t);
+    ecdh_unfiltered += num_ecdh - ecdh;
+  }
+  uint32_t max_ecdh = GLOBAL_BURST + FLOOD_MINS*60 / GLOBAL_SECS + admin_tries;
+  CHECK(ecdh_filtered <= max_ecdh, "flood: %d ECDH, expected at most %d", ecdh_filtered, max_ecdh);
+  CHECK(admin_allowed == admin_tries, "flood: admin allowed %d of %d", admin_allowed, admin_tries);
+  CHECK(ms_filtered * 4 < ms_unfiltered, "flood: %.1f ms CPU, vs %.1f ms without the filter", ms_filtered,
+        ms_unfiltered);
+  printf("%d mins of 1000 anon requests/min: %d ECDH (at most %d), %.1f ms CPU; without the filter: %d ECDH, "
+         "%.1f ms. Spoofed admin: 0 ECDH, admin allowed %d/%d\n", FLOOD_MINS, ecdh_filtered, max_ecdh, ms_filtered,
+         ecdh_unfiltered, ms_unfiltered, admin_allowed, admin_tries);
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
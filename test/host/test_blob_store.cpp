@@ -0,0 +1,369 @@
+// companion_radio's DataStore advert blobs: fixed-size records in /adv_blobs, found through an index (in RAM) of
+// each record's key and timestamp. Checks lookups, replacing and evicting the oldest, across a reboot, and reports
+// the file I/O per get/put against scanning the records (as before the index).
+// Also replays a day of adverts through BaseChatMesh (which skips unchanged ones) into the write-behind cache, for
+// the flash bytes written per day, and checks what a crash at any point loses.
+
+#include "DataStore.h"
+#include <helpers/BaseChatMesh.h>
+#include <helpers/SimpleMeshTables.h>
+#include <helpers/StaticPoolPacketManager.h>
+#include <SPIFFS.h>
+#include "check.h"
+#include <algorithm>
+#include <map>
+#include <stdlib.h>
+#include <vector>
+
+#define LAZY_BLOBS_WRITE_DELAY   30    // secs, as in MyMesh
+
+class TestRTC : public mesh::RTCClock {
+public:
+  uint32_t now = 1715770351;
+  uint32_t getCurrentTime() override { return now; }
+  void setCurrentTime(uint32_t time) override { now = time; }
+};
+
+class NullRadio : public mesh::Radio {
+public:
+  int recvRaw(uint8_t* bytes, int sz) override { return 0; }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return len_bytes; }
+  float packetScore(float snr, int packet_len) override { return 1.0f; }
+  bool startSendRaw(const uint8_t* bytes, int len) override { return true; }
+  bool isSendComplete() override { return true; }
+  void onSendFinished() override { }
+  bool isInRecvMode() const override { return true; }
+};
+
+class TestClock : public mesh::MillisecondClock {
+public:
+  unsigned long getMillis() override { return 0; }
+};
+
+class TestRNG : public mesh::RNG {
+public:
+  void random(uint8_t* dest, size_t sz) override {
+    for (size_t i = 0; i < sz; i++) dest[i] = rand() & 0xFF;
+  }
+};
+
+struct Blob {
+  uint8_t key[PUB_KEY_SIZE];
+  uint8_t data[MAX_ADVERT_PKT_LEN];
+  uint8_t len;
+};
+
+static TestRTC rtc;
+
+static void randomBlob(Blob& b) {
+  for (int i = 0; i < PUB_KEY_SIZE; i++) b.key[i] = rand();
+  b.len = PUB_KEY_SIZE + 4 + SIGNATURE_SIZE + rand() % (MAX_ADVERT_PKT_LEN - PUB_KEY_SIZE - 4 - SIGNATURE_SIZE + 1);
+  for (int i = 0; i < b.len; i++) b.data[i] = rand();
+}
+
+static bool hasBlob(DataStore& store, const Blob& b) {
+  uint8_t buf[255];
+  return store.getBlobByKey(b.key, PUB_KEY_SIZE, buf) == b.len && memcmp(buf, b.data, b.len) == 0;
+}
+
+static void put(DataStore& store, const Blob& b) {   // straight to flash
+  rtc.now++;
+  store.putBlobByKey(b.key, PUB_KEY_SIZE, b.data, b.len);
+  store.flushBlobs();
+}
+
+// the old lookup: read records from the start, until the key matches (or to the end, for the oldest to evict)
+static void scanRecords(const uint8_t key[], size_t rec_size) {
+  File file = SPIFFS.open("/adv_blobs", "r");
+  std::vector<uint8_t> rec(rec_size);
+  while (file.read(rec.data(), rec_size) == rec_size) {
+    if (memcmp(&rec[4], key, 7) == 0) break;
+  }
+  file.close();
+}
+
+static void testBlobs() {
+  memfs_files().clear();
+  DataStore store(SPIFFS, rtc);
+  store.begin();
+
+  std::vector<Blob> blobs(MAX_BLOBRECS);
+  for (auto& b : blobs) {
+    randomBlob(b);
+    put(store, b);
+  }
+  int missing = 0;
+  for (auto& b : blobs) missing += !hasBlob(store, b);
+  CHECK(missing == 0, "%d of %d blobs not found", missing, MAX_BLOBRECS);
+
+  Blob b;
+  randomBlob(b);   // same key, new advert
+  memcpy(b.key, blobs[5].key, PUB_KEY_SIZE);
+  blobs[5] = b;
+  put(store, blobs[5]);
+  CHECK(hasBlob(store, blobs[5]), "replaced blob not found");
+
+  Blob extra;
+  randomBlob(extra);
+  put(store, extra);   // file full, so the oldest (blobs[0]) goes
+  CHECK(hasBlob(store, extra) && !hasBlob(store, blobs[0]) && hasBlob(store, blobs[1]), "oldest blob not evicted");
+
+  CHECK(store.deleteBlobByKey(blobs[1].key, PUB_KEY_SIZE) && !hasBlob(store, blobs[1]), "deleted blob still found");
+
+  DataStore store2(SPIFFS, rtc);   // reboot, index rebuilt from the file
+  store2.begin();
+  missing = 0;
+  for (int i = 2; i < MAX_BLOBRECS; i++) missing += !hasBlob(store2, blobs[i]);
+  CHECK(missing == 0 && hasBlob(store2, extra) && !hasBlob(store2, blobs[1]), "after reboot: %d blobs not found",
+        missing);
+}
+
+static void benchmark() {
+  memfs_files().clear();
+  DataStore store(SPIFFS, rtc);
+  store.begin();
+  std::vector<Blob> blobs(MAX_BLOBRECS);
+  for (auto& b : blobs) {
+    randomBlob(b);
+    put(store, b);
+  }
+  size_t rec_size = memfs_files()["/adv_blobs"]->size() / MAX_BLOBRECS;
+
+  auto& stats = memfs_stats();
+  size_t read = stats.bytes_read, opens = stats.num_opens;
+  DataStore rebooted(SPIFFS, rtc);
+  rebooted.begin();
+  size_t boot_read = stats.bytes_read - read, boot_opens = stats.num_opens - opens;
+
+  // gets of a random stored blob
+  uint8_t buf[255];
+  read = stats.bytes_read;
+  opens = stats.num_opens;
+  for (int i = 0; i < 1000; i++) store.getBlobByKey(blobs[rand() % MAX_BLOBRECS].key, PUB_KEY_SIZE, buf);
+  double get_read = (stats.bytes_read - read) / 1000.0, get_opens = (stats.num_opens - opens) / 1000.0;
+
+  read = stats.bytes_read;
+  for (int i = 0; i < 1000; i++) scanRecords(blobs[rand() % MAX_BLOBRECS].key, rec_size);
+  double scan_read = (stats.bytes_read - read) / 1000.0;
+
+  // puts of a new key, evicting the oldest
+  read = stats.bytes_read;
+  opens = stats.num_opens;
+  size_t written = stats.bytes_written;
+  Blob b;
+  for (int i = 0; i < 1000; i++) {
+    randomBlob(b);
+    put(store, b);
+  }
+  double put_read = (stats.bytes_read - read) / 1000.0, put_opens = (stats.num_opens - opens) / 1000.0;
+  double put_written = (stats.bytes_written - written) / 1000.0;
+
+  CHECK(get_read == rec_size && get_opens == 1, "get: %.1f bytes read, %.1f opens", get_read, get_opens);
+  CHECK(put_read == 0 && put_written == rec_size, "put: %.1f bytes read, %.1f written", put_read, put_written);
+  printf("%d blob records of %d bytes: boot reads %d bytes (%d opens) for the index\n", MAX_BLOBRECS, (int) rec_size,
+         (int) boot_read, (int) boot_opens);
+  printf("  get: %6.0f bytes read, %.1f opens (scanning records: %6.0f bytes read)\n", get_read, get_opens, scan_read);
+  printf("  put: %6.0f bytes read, %6.0f written, %.1f opens (scanning records: %6d bytes read)\n", put_read,
+         put_written, put_opens, (int) (MAX_BLOBRECS * rec_size));
+}
+
+// blob storage as in companion_radio's MyMesh: write-behind, flushed once no blob has been put for a while
+class TestChatMesh : public BaseChatMesh {
+  DataStore* _store;
+  uint32_t dirty_blobs_expiry;
+protected:
+  void onDiscoveredContact(ContactInfo& contact, bool is_new, uint8_t path_len, const uint8_t* path) override { }
+  ContactInfo* processAck(const uint8_t *data) override { return NULL; }
+  void onContactPathUpdated(const ContactInfo& contact) override { }
+  void onMessageRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const char *text) override { }
+  void onCommandDataRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const char *text) override { }
+  void onSignedMessageRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const uint8_t *sender_prefix, const char *text) override { }
+  uint32_t calcFloodTimeoutMillisFor(uint32_t pkt_airtime_millis) const override { return 1000; }
+  uint32_t calcDirectTimeoutMillisFor(uint32_t pkt_airtime_millis, uint8_t path_len) const override { return 1000; }
+  void onSendTimeout() override { }
+  void onChannelMessageRecv(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t timestamp, const char *text) override { }
+  uint8_t onContactRequest(const ContactInfo& contact, uint32_t sender_timestamp, const uint8_t* data, uint8_t len, uint8_t* reply) override { return 0; }
+  void onContactResponse(const ContactInfo& contact, const uint8_t* data, uint8_t len) override { }
+
+  int getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) override {
+    return _store->getBlobByKey(key, key_len, dest_buf);
+  }
+  bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) override {
+    dirty_blobs_expiry = rtc.now + LAZY_BLOBS_WRITE_DELAY;
+    std::vector<uint8_t>& p = last_put[std::vector<uint8_t>(key, key + key_len)];
+    p.assign(src_buf, src_buf + len);
+    return _store->putBlobByKey(key, key_len, src_buf, len);
+  }
+
+public:
+  std::map<std::vector<uint8_t>, std::vector<uint8_t>> last_put;   // by key
+
+  TestChatMesh(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::PacketManager& mgr, mesh::MeshTables& tables)
+      : BaseChatMesh(radio, ms, rng, rtc, mgr, tables), _store(NULL), dirty_blobs_expiry(0) { }
+
+  void setStore(DataStore* store) {
+    _store = store;
+    dirty_blobs_expiry = 0;
+    last_put.clear();
+    resetContacts();
+  }
+
+  void idle() {   // as MyMesh::loop()
+    if (dirty_blobs_expiry && rtc.now >= dirty_blobs_expiry) {
+      _store->flushBlobs();
+      dirty_blobs_expiry = 0;
+    }
+  }
+
+  void recvAdvert(const uint8_t* pub_key, uint32_t timestamp, const uint8_t* app_data, int app_data_len) {
+    mesh::Packet pkt;   // as from Mesh, once verified
+    pkt.header = ROUTE_TYPE_FLOOD | (PAYLOAD_TYPE_ADVERT << PH_TYPE_SHIFT);
+    pkt.path_len = rand() % 4;
+    for (int i = 0; i < pkt.path_len; i++) pkt.path[i] = rand();
+    int i = 0;
+    memcpy(&pkt.payload[i], pub_key, PUB_KEY_SIZE); i += PUB_KEY_SIZE;
+    memcpy(&pkt.payload[i], &timestamp, 4); i += 4;
+    for (int j = 0; j < SIGNATURE_SIZE; j++) pkt.payload[i++] = rand();
+    memcpy(&pkt.payload[i], app_data, app_data_len); i += app_data_len;
+    pkt.payload_len = i;
+    onAdvertRecv(&pkt, mesh::Identity(pub_key), timestamp, app_data, app_data_len);
+  }
+};
+
+static NullRadio radio;
+static TestClock ms;
+static TestRNG rng;
+static StaticPoolPacketManager pkt_mgr(4);
+static SimpleMeshTables tables;
+static TestChatMesh the_mesh(radio, ms, rng, rtc, pkt_mgr, tables);
+
+// a node heard on the mesh, which re-adverts every 'interval' secs. Mobile ones have a new location each time.
+struct Node {
+  uint8_t pub_key[PUB_KEY_SIZE];
+  uint8_t type;
+  uint32_t interval, next;
+  bool mobile;
+  int fix;   // location
+};
+
+struct Advert {
+  uint32_t time;
+  int node;
+};
+
+static int encodeAppData(const Node& n, int idx, uint8_t app_data[]) {
+  char name[16];
+  snprintf(name, sizeof(name), "node%d", idx);
+  AdvertDataBuilder builder(n.type, name, -36.8 + n.fix * 0.001, 174.7);
+  return builder.encodeTo(app_data);
+}
+
+// 'num_nodes' adverting for 'days', with ~1 in 5 mobile. Repeaters advert every 12h, companions every 1-4h.
+static std::vector<Advert> makeTraffic(std::vector<Node>& nodes, int num_nodes, int days, uint32_t start) {
+  nodes.resize(num_nodes);
+  std::vector<Advert> traffic;
+  for (int i = 0; i < num_nodes; i++) {
+    Node& n = nodes[i];
+    for (int j = 0; j < PUB_KEY_SIZE; j++) n.pub_key[j] = rand();
+    n.type = i % 3 == 0 ? ADV_TYPE_REPEATER : ADV_TYPE_CHAT;
+    n.interval = n.type == ADV_TYPE_REPEATER ? 12*3600 : 3600 * (1 + rand() % 4);
+    n.mobile = n.type == ADV_TYPE_CHAT && rand() % 5 == 0;
+    n.fix = 0;
+    for (uint32_t t = start + rand() % n.interval; t < start + days*86400; t += n.interval) traffic.push_back({ t, i });
+  }
+  std::sort(traffic.begin(), traffic.end(), [](const Advert& a, const Advert& b) { return a.time < b.time; });
+  return traffic;
+}
+
+static bool sameBlob(DataStore& store, const std::vector<uint8_t>& key, const std::vector<uint8_t>& blob) {
+  uint8_t buf[255];
+  int len = store.getBlobByKey(key.data(), key.size(), buf);
+  return len == (int) blob.size() && memcmp(buf, blob.data(), len) == 0;
+}
+
+struct ReplayResult {
+  uint32_t bytes;      // blob bytes written, in the day
+  int rx_writes;       // of which, blob writes while handling an advert (so stalling the loop)
+  int max_lost;        // blobs lost, on a crash at the worst point
+};
+
+// one day's traffic, after a day to settle in. 'mode' 0 is every advert written straight to flash (as before),
+// 1 is skipping unchanged adverts, 2 adds the write-behind cache.
+static ReplayResult replay(int num_nodes, int mode, bool check_crash) {
+  srand(num_nodes);   // same traffic for each mode
+  memfs_files().clear();
+  uint32_t start = 1715770351;
+  std::vector<Node> nodes;
+  auto traffic = makeTraffic(nodes, num_nodes, 2, start);
+  rtc.now = start;
+  DataStore store(SPIFFS, rtc);
+  store.begin();
+  the_mesh.setStore(&store);
+
+  bool day2 = false;
+  uint32_t day1_bytes = 0;
+  ReplayResult res = { 0, 0, 0 };
+  uint8_t app_data[MAX_ADVERT_DATA_SIZE];
+  for (size_t i = 0; i < traffic.size(); i++) {
+    auto& a = traffic[i];
+    for ( ; rtc.now < a.time; rtc.now += 5) the_mesh.idle();
+    if (!day2 && a.time >= start + 86400) {
+      day2 = true;
+      day1_bytes = store.getBlobBytesWritten();
+    }
+
+    Node& n = nodes[a.node];
+    if (n.mobile) n.fix++;
+    int len = encodeAppData(n, a.node, app_data);
+    if (mode == 0) {
+      uint8_t blob[MAX_ADVERT_PKT_LEN];
+      memcpy(blob, n.pub_key, PUB_KEY_SIZE);   // (just as big, contents don't matter here)
+      store.putBlobByKey(n.pub_key, PUB_KEY_SIZE, blob, sizeof(blob) - MAX_ADVERT_DATA_SIZE + len);
+      store.flushBlobs();
+      continue;
+    }
+    uint32_t before = store.getBlobBytesWritten();
+    the_mesh.recvAdvert(n.pub_key, a.time, app_data, len);
+    if (mode == 1) store.flushBlobs();
+    if (day2 && store.getBlobBytesWritten() != before) res.rx_writes++;
+
+    if (check_crash && i % 7 == 0) {   // crash here: only the pending blobs (newest of each) are lost
+      DataStore rebooted(SPIFFS, rtc);
+      rebooted.begin();
+      int lost = 0;
+      for (auto& p : the_mesh.last_put) lost += !sameBlob(rebooted, p.first, p.second);
+      CHECK(lost <= BLOB_WRITE_CACHE_SIZE, "%d nodes: %d blobs lost on crash", num_nodes, lost);
+      if (lost > res.max_lost) res.max_lost = lost;
+    }
+  }
+  store.flushBlobs();   // (as before a reboot)
+
+  int stale = 0;
+  for (auto& p : the_mesh.last_put) stale += !sameBlob(store, p.first, p.second);
+  CHECK(stale == 0, "%d nodes: %d blobs not the latest", num_nodes, stale);
+  res.bytes = store.getBlobBytesWritten() - day1_bytes;
+  return res;
+}
+
+static void benchmarkTraffic(int num_nodes) {
+  auto every = replay(num_nodes, 0, false);
+  auto changed = replay(num_nodes, 1, false);
+  auto cached = replay(num_nodes, 2, true);
+  CHECK(changed.bytes < every.bytes && cached.bytes <= changed.bytes, "%d nodes: %u bytes/day, skipping unchanged %u, "
+        "write-behind %u", num_nodes, every.bytes, changed.bytes, cached.bytes);
+  CHECK(cached.rx_writes*4 <= changed.rx_writes, "%d nodes: %d blob writes while handling adverts", num_nodes,
+        cached.rx_writes);
+  printf("%3d nodes, blob bytes written per day: every advert %7u, unchanged skipped %6u (%d writes in the rx path), "
+         "and write-behind %6u (%d in the rx path). Crash loses at most %d (bound %d)\n", num_nodes, every.bytes,
+         changed.bytes, changed.rx_writes, cached.bytes, cached.rx_writes, cached.max_lost, BLOB_WRITE_CACHE_SIZE);
+}
+
+int main() {
+  srand(1);
+  testBlobs();
+  benchmark();
+  for (int n : { 20, 100 }) benchmarkTraffic(n);
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,317 @@
+// BaseChatMesh contacts: the pub_key index stays consistent through add, remove and overwrite (when full), and
+// lookups at 100, 1000 and 5000 contacts, against a linear scan of the table as before the index. Also the
+// recency list: loading (boot) time, and scanRecentContacts() for the most recent few, or all. And the RAM each
+// contact takes (for MAX_CONTACTS=1000 on nRF52).
+
+#include <helpers/BaseChatMesh.h>
+#include <helpers/SimpleMeshTables.h>
+#include <helpers/StaticPoolPacketManager.h>
+#include "check.h"
+#include <chrono>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_LOOKUPS   20000
+#define BENCH_SCANS     2000
+
+class NullRadio : public mesh::Radio {
+public:
+  int recvRaw(uint8_t* bytes, int sz) override { return 0; }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return len_bytes; }
+  float packetScore(float snr, int packet_len) override { return 1.0f; }
+  bool startSendRaw(const uint8_t* bytes, int len) override { return true; }
+  bool isSendComplete() override { return true; }
+  void onSendFinished() override { }
+  bool isInRecvMode() const override { return true; }
+};
+
+class TestClock : public mesh::MillisecondClock {
+public:
+  unsigned long getMillis() override { return 0; }
+};
+
+class TestRTC : public mesh::RTCClock {
+  uint32_t now = 1715770351;
+public:
+  uint32_t getCurrentTime() override { return now; }
+  void setCurrentTime(uint32_t time) override { now = time; }
+};
+
+class TestRNG : public mesh::RNG {
+public:
+  void random(uint8_t* dest, size_t sz) override {
+    for (size_t i = 0; i < sz; i++) dest[i] = rand() & 0xFF;
+  }
+};
+
+class TestChatMesh : public BaseChatMesh {
+  bool overwrite = false;
+protected:
+  bool shouldOverwriteWhenFull() const override { return overwrite; }
+  void onDiscoveredContact(ContactInfo& contact, bool is_new, uint8_t path_len, const uint8_t* path) override { }
+  ContactInfo* processAck(const uint8_t *data) override { return NULL; }
+  void onContactPathUpdated(const ContactInfo& contact) override { }
+  void onMessageRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const char *text) override { }
+  void onCommandDataRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const char *text) override { }
+  void onSignedMessageRecv(const ContactInfo& contact, mesh::Packet* pkt, uint32_t sender_timestamp, const uint8_t *sender_prefix, const char *text) override { }
+  uint32_t calcFloodTimeoutMillisFor(uint32_t pkt_airtime_millis) const override { return 1000; }
+  uint32_t calcDirectTimeoutMillisFor(uint32_t pkt_airtime_millis, uint8_t path_len) const override { return 1000; }
+  void onSendTimeout() override { }
+  void onChannelMessageRecv(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t timestamp, const char *text) override { }
+  uint8_t onContactRequest(const ContactInfo& contact, uint32_t sender_timestamp, const uint8_t* data, uint8_t len, uint8_t* reply) override { return 0; }
+  void onContactResponse(const ContactInfo& contact, const uint8_t* data, uint8_t len) override { }
+
+public:
+  TestChatMesh(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::PacketManager& mgr, mesh::MeshTables& tables)
+      : BaseChatMesh(radio, ms, rng, rtc, mgr, tables) { }
+
+  void reset() { resetContacts(); }
+  void setOverwrite(bool on) { overwrite = on; }
+  int peersByHash(uint8_t hash) { return searchPeersByHash(&hash); }
+
+  void recvAdvert(const uint8_t* pub_key, uint32_t timestamp) {   // as from Mesh, once verified
+    uint8_t app_data[MAX_ADVERT_DATA_SIZE];
+    char name[16];
+    snprintf(name, sizeof(name), "n%02X%02X", pub_key[0], pub_key[1]);
+    AdvertDataBuilder builder(ADV_TYPE_CHAT, name);
+    int len = builder.encodeTo(app_data);
+    mesh::Packet pkt;
+    pkt.header = ROUTE_TYPE_FLOOD | (PAYLOAD_TYPE_ADVERT << PH_TYPE_SHIFT);
+    pkt.path_len = 0;
+    pkt.payload_len = 0;
+    onAdvertRecv(&pkt, mesh::Identity(pub_key), timestamp, app_data, len);
+  }
+};
+
+static NullRadio radio;
+static TestClock ms;
+static TestRNG rng;
+static TestRTC rtc;
+static StaticPoolPacketManager pkt_mgr(4);
+static SimpleMeshTables tables;
+static TestChatMesh the_mesh(radio, ms, rng, rtc, pkt_mgr, tables);
+
+static void randomContact(ContactInfo& c, uint32_t timestamp) {
+  memset(&c, 0, sizeof(c));
+  uint8_t pub_key[PUB_KEY_SIZE];
+  rng.random(pub_key, sizeof(pub_key));
+  c.id = mesh::Identity(pub_key);
+  snprintf(c.name, sizeof(c.name), "c%02X%02X", pub_key[0], pub_key[1]);
+  c.type = ADV_TYPE_CHAT;
+  c.out_path_len = -1;
+  c.last_advert_timestamp = timestamp;
+}
+
+// what lookupContactByPubKey() and searchPeersByHash() did before the index
+static int linearLookup(const std::vector<ContactInfo>& table, const uint8_t* pub_key, int prefix_len) {
+  for (size_t i = 0; i < table.size(); i++) {
+    if (memcmp(table[i].id.pub_key, pub_key, prefix_len) == 0) return i;
+  }
+  return -1;
+}
+
+static int linearPeers(const std::vector<ContactInfo>& table, uint8_t hash) {
+  int n = 0;
+  for (size_t i = 0; i < table.size() && n < MAX_SEARCH_RESULTS; i++) {
+    if (table[i].id.isHashMatch(&hash)) n++;
+  }
+  return n;
+}
+
+static std::vector<ContactInfo> snapshot() {
+  std::vector<ContactInfo> table(the_mesh.getNumContacts());
+  for (size_t i = 0; i < table.size(); i++) the_mesh.getContactByIdx(i, table[i]);
+  return table;
+}
+
+// every contact is found at its own slot, and every 1-byte hash gives the same candidates as a linear scan
+static bool indexConsistent() {
+  auto table = snapshot();
+  for (size_t i = 0; i < table.size(); i++) {
+    for (int prefix_len : { 1, 6, PUB_KEY_SIZE }) {
+      ContactInfo* c = the_mesh.lookupContactByPubKey(table[i].id.pub_key, prefix_len);
+      if (c == NULL || !c->id.matches(table[linearLookup(table, table[i].id.pub_key, prefix_len)].id)) return false;
+    }
+  }
+  for (int h = 0; h < 256; h++) {
+    if (the_mesh.peersByHash(h) != linearPeers(table, h)) return false;
+  }
+  return true;
+}
+
+static void testConsistency() {
+  the_mesh.reset();
+  uint32_t timestamp = 1000;
+  std::vector<mesh::Identity> removed;
+  for (int step = 0; step < 4000; step++) {
+    int op = rand() % 10;
+    if (op < 5 && the_mesh.getNumContacts() < 300) {
+      ContactInfo c;
+      randomContact(c, timestamp++);
+      the_mesh.addContact(c);
+    } else if (op < 7 && the_mesh.getNumContacts() > 0) {
+      ContactInfo c;
+      the_mesh.getContactByIdx(rand() % the_mesh.getNumContacts(), c);
+      CHECK(the_mesh.removeContact(c), "removeContact() didn't find contact");
+      removed.push_back(c.id);
+    } else if (the_mesh.getNumContacts() > 0) {   // a re-advert
+      ContactInfo c;
+      the_mesh.getContactByIdx(rand() % the_mesh.getNumContacts(), c);
+      the_mesh.recvAdvert(c.id.pub_key, timestamp++);
+    }
+    if (step % 100 == 0 && !indexConsistent()) {
+      CHECK(false, "index inconsistent after step %d", step);
+      break;
+    }
+  }
+  for (auto& id : removed) {
+    CHECK(the_mesh.lookupContactByPubKey(id.pub_key, PUB_KEY_SIZE) == NULL, "removed contact still found");
+  }
+
+  // full, so new adverts overwrite the oldest contacts
+  while (the_mesh.getNumContacts() < MAX_CONTACTS) {
+    ContactInfo c;
+    randomContact(c, timestamp++);
+    the_mesh.addContact(c);
+  }
+  the_mesh.setOverwrite(true);
+  for (int i = 0; i < 500; i++) {
+    uint8_t pub_key[PUB_KEY_SIZE];
+    rng.random(pub_key, sizeof(pub_key));
+    rtc.setCurrentTime(rtc.getCurrentTime() + 1);
+    the_mesh.recvAdvert(pub_key, timestamp++);
+    CHECK(the_mesh.lookupContactByPubKey(pub_key, PUB_KEY_SIZE) != NULL, "overwriting contact not found");
+  }
+  the_mesh.setOverwrite(false);
+  CHECK(the_mesh.getNumContacts() == MAX_CONTACTS, "%d contacts after overwrites", the_mesh.getNumContacts());
+  CHECK(indexConsistent(), "index inconsistent after overwrites");
+}
+
+static double elapsedMicros(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - since).count();
+}
+
+static void benchmarkLookups(int num_contacts) {
+  the_mesh.reset();
+  for (int i = 0; i < num_contacts; i++) {
+    ContactInfo c;
+    randomContact(c, 1000 + i);
+    the_mesh.addContact(c);
+  }
+  auto table = snapshot();
+
+  // half known contacts (eg. a direct message), half unknown (eg. adverts from new nodes)
+  std::vector<mesh::Identity> keys(BENCH_LOOKUPS);
+  for (int i = 0; i < BENCH_LOOKUPS; i++) {
+    if (i % 2) {
+      keys[i] = table[rand() % table.size()].id;
+    } else {
+      rng.random(keys[i].pub_key, PUB_KEY_SIZE);
+    }
+  }
+
+  int found = 0, linear_found = 0, peers = 0, linear_peers = 0;
+  auto t = std::chrono::steady_clock::now();
+  for (auto& k : keys) found += the_mesh.lookupContactByPubKey(k.pub_key, PUB_KEY_SIZE) != NULL;
+  double index_us = elapsedMicros(t) / BENCH_LOOKUPS;
+  t = std::chrono::steady_clock::now();
+  for (auto& k : keys) linear_found += linearLookup(table, k.pub_key, PUB_KEY_SIZE) >= 0;
+  double linear_us = elapsedMicros(t) / BENCH_LOOKUPS;
+
+  t = std::chrono::steady_clock::now();
+  for (auto& k : keys) peers += the_mesh.peersByHash(k.pub_key[0]);
+  double hash_us = elapsedMicros(t) / BENCH_LOOKUPS;
+  t = std::chrono::steady_clock::now();
+  for (auto& k : keys) linear_peers += linearPeers(table, k.pub_key[0]);
+  double linear_hash_us = elapsedMicros(t) / BENCH_LOOKUPS;
+
+  CHECK(found == linear_found && found >= BENCH_LOOKUPS / 2, "%d contacts: found %d, linear %d", num_contacts, found,
+        linear_found);
+  CHECK(peers == linear_peers, "%d contacts: %d peers by hash, linear %d", num_contacts, peers, linear_peers);
+  printf("%4d contacts, per lookup: by pub_key %.3f us (linear %.3f us), by hash %.3f us (linear %.3f us)\n",
+         num_contacts, index_us, linear_us, hash_us, linear_hash_us);
+}
+
+class RecentChecker : public ContactVisitor {
+public:
+  int count = 0;
+  uint32_t prev_timestamp = 0xFFFFFFFF;
+  bool in_order = true;
+  void onContactVisit(const ContactInfo& contact) override {
+    if (contact.last_advert_timestamp > prev_timestamp) in_order = false;
+    prev_timestamp = contact.last_advert_timestamp;
+    count++;
+  }
+};
+
+static bool recentInOrder(int expected_count) {
+  RecentChecker checker;
+  the_mesh.scanRecentContacts(0, &checker);
+  return checker.in_order && checker.count == expected_count;
+}
+
+static void benchmarkRecent(int num_contacts) {
+  // as loaded at boot: in table order, not by advert time
+  std::vector<ContactInfo> table(num_contacts);
+  for (int i = 0; i < num_contacts; i++) randomContact(table[i], 1000 + rand() % (10*num_contacts));
+
+  the_mesh.reset();
+  auto t = std::chrono::steady_clock::now();
+  for (auto& c : table) the_mesh.addContact(c);
+  RecentChecker first;
+  the_mesh.scanRecentContacts(10, &first);
+  double load_ms = elapsedMicros(t) / 1000;
+  CHECK(recentInOrder(num_contacts), "%d contacts: recency list not in order after load", num_contacts);
+
+  // then adverts keep it in order
+  for (int i = 0; i < 200; i++) {
+    ContactInfo c;
+    the_mesh.getContactByIdx(rand() % num_contacts, c);
+    the_mesh.recvAdvert(c.id.pub_key, c.last_advert_timestamp + 1 + rand() % (10*num_contacts));
+  }
+  CHECK(recentInOrder(num_contacts), "%d contacts: recency list not in order after adverts", num_contacts);
+
+  int visited = 0;
+  t = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_SCANS; i++) {
+    RecentChecker checker;
+    the_mesh.scanRecentContacts(10, &checker);
+    visited += checker.count;
+  }
+  double recent_us = elapsedMicros(t) / BENCH_SCANS;
+  t = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_SCANS / 10; i++) {
+    RecentChecker checker;
+    the_mesh.scanRecentContacts(0, &checker);
+  }
+  double all_us = elapsedMicros(t) / (BENCH_SCANS / 10);
+  CHECK(visited == BENCH_SCANS*10, "%d contacts: scanned %d, expected %d", num_contacts, visited, BENCH_SCANS*10);
+  printf("%4d contacts: load (with first scan) %.2f ms, scan most recent 10 %.3f us, scan all %.1f us\n",
+         num_contacts, load_ms, recent_us, all_us);
+}
+
+// ContactInfo has no pointers, so it is the same size on the 32-bit boards
+static void reportRAM() {
+  size_t index = 3*sizeof(int16_t) + sizeof(GeoIndex<MAX_CONTACTS>) / MAX_CONTACTS;   // bucket chain, recency, geo
+  size_t per_contact = sizeof(ContactInfo) + index;
+  int num_secrets = 1000 / 8 > 16 ? 1000 / 8 : 16;   // CONTACT_SECRET_CACHE_SIZE for MAX_CONTACTS=1000
+  size_t total = 1000*per_contact + num_secrets*sizeof(CachedSecret);
+  printf("RAM per contact: %d bytes (ContactInfo %d, of which name %d and out_path %d, index %d), "
+         "at 1000 contacts %.1f KB with %d cached secrets\n", (int) per_contact, (int) sizeof(ContactInfo),
+         (int) sizeof(ContactInfo::name), (int) sizeof(ContactInfo::out_path), (int) index, total / 1024.0, num_secrets);
+}
+
+int main() {
+  srand(1);
+  reportRAM();
+  testConsistency();
+  for (int n : { 100, 1000, 5000 }) {
+    if (n <= MAX_CONTACTS) benchmarkLookups(n);
+  }
+  for (int n : { 100, 1000, 5000 }) {
+    if (n <= MAX_CONTACTS) benchmarkRecent(n);
+  }
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,198 @@
+// companion_radio's DataStore contacts: a snapshot plus a log of changes, compacted a few records per loop().
+// Checks what loads back after each step of a compaction (as if power was lost there), and after one that's
+// aborted part way, and reports the flash writes (and longest stall) of stepped compaction vs a full rewrite.
+
+#include "DataStore.h"
+#include <SPIFFS.h>
+#include "check.h"
+#include <chrono>
+#include <stdlib.h>
+#include <vector>
+
+class TestRTC : public mesh::RTCClock {
+public:
+  uint32_t getCurrentTime() override { return 1715770351; }
+  void setCurrentTime(uint32_t time) override { }
+};
+
+class TestHost : public DataStoreHost {
+public:
+  std::vector<ContactInfo> contacts;
+
+  int find(const uint8_t* pub_key) const {
+    for (size_t i = 0; i < contacts.size(); i++) {
+      if (memcmp(contacts[i].id.pub_key, pub_key, PUB_KEY_SIZE) == 0) return i;
+    }
+    return -1;
+  }
+  bool onContactLoaded(const ContactInfo& contact) override {
+    contacts.push_back(contact);
+    return true;
+  }
+  bool getContactForSave(uint32_t idx, ContactInfo& contact) override {
+    if (idx >= contacts.size()) return false;
+    contact = contacts[idx];
+    return true;
+  }
+  bool onContactLogUpdate(const ContactInfo& contact) override {
+    int i = find(contact.id.pub_key);
+    if (i < 0) {
+      contacts.push_back(contact);
+    } else {
+      contacts[i] = contact;
+    }
+    return true;
+  }
+  void onContactLogRemove(const uint8_t* pub_key) override {
+    int i = find(pub_key);
+    if (i >= 0) contacts.erase(contacts.begin() + i);
+  }
+  bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) override { return false; }
+  bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) override { return false; }
+};
+
+static TestRTC rtc;
+
+static void randomContact(ContactInfo& c) {
+  memset(&c, 0, sizeof(c));
+  for (int i = 0; i < PUB_KEY_SIZE; i++) c.id.pub_key[i] = rand();
+  snprintf(c.name, sizeof(c.name), "c%02X%02X", c.id.pub_key[0], c.id.pub_key[1]);
+  c.out_path_len = rand() % 8;
+  for (int i = 0; i < c.out_path_len; i++) c.out_path[i] = rand();
+  c.last_advert_timestamp = rand();
+}
+
+static bool sameContacts(const std::vector<ContactInfo>& a, const std::vector<ContactInfo>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {   // (same order, as both replayed the same way)
+    if (memcmp(a[i].id.pub_key, b[i].id.pub_key, PUB_KEY_SIZE) != 0 || strcmp(a[i].name, b[i].name) != 0 ||
+        a[i].out_path_len != b[i].out_path_len || a[i].last_advert_timestamp != b[i].last_advert_timestamp) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static std::vector<ContactInfo> reload() {   // as at next boot
+  DataStore store(SPIFFS, rtc);
+  TestHost host;
+  store.loadContacts(&host);
+  return host.contacts;
+}
+
+// a snapshot of 'num' contacts, then enough changes logged that compaction is due
+static void setup(DataStore& store, TestHost& host, int num) {
+  memfs_files().clear();
+  host.contacts.resize(num);
+  for (auto& c : host.contacts) randomContact(c);
+  store.saveContacts(&host);
+  while (!store.needsContactsCompaction(host.contacts.size())) {
+    ContactInfo& c = host.contacts[rand() % host.contacts.size()];
+    c.last_advert_timestamp++;
+    c.out_path_len = rand() % 8;
+    store.appendContact(c);
+  }
+}
+
+static void testPowerLoss(int num) {
+  DataStore store(SPIFFS, rtc);
+  TestHost host;
+  setup(store, host, num);
+  std::map<std::string, std::vector<uint8_t>> before;
+  for (auto& f : memfs_files()) before[f.first] = *f.second;
+
+  // stop after each step in turn, and boot from there
+  for (int stop = 0; ; stop++) {
+    memfs_files().clear();
+    for (auto& f : before) memfs_files()[f.first] = std::make_shared<std::vector<uint8_t>>(f.second);
+    DataStore s(SPIFFS, rtc);
+    TestHost h;
+    s.loadContacts(&h);
+    CHECK(sameContacts(h.contacts, host.contacts), "%d contacts: loaded wrong before compaction", num);
+
+    bool finished = false;
+    CHECK(s.startContactsCompaction(), "couldn't start compaction");
+    for (int i = 0; i < stop && !finished; i++) finished = s.stepContactsCompaction(&h, CONTACTS_COMPACT_STEP);
+    CHECK(sameContacts(reload(), host.contacts), "%d contacts: loaded wrong after %d steps%s", num, stop,
+          finished ? " (finished)" : "");
+    if (finished) {
+      CHECK(!memfs_files().count("/contacts3.log") && !memfs_files().count("/contacts3.tmp"), "log or tmp left");
+      break;
+    }
+  }
+}
+
+// contacts change part way, so the compaction is abandoned (as in MyMesh::loop()), and the log is kept
+static void testAbort(int num) {
+  DataStore store(SPIFFS, rtc);
+  TestHost host;
+  setup(store, host, num);
+  store.startContactsCompaction();
+  store.stepContactsCompaction(&host, CONTACTS_COMPACT_STEP);
+
+  uint8_t removed[PUB_KEY_SIZE];   // shifts the rest down, so the next step would skip one
+  memcpy(removed, host.contacts[0].id.pub_key, PUB_KEY_SIZE);
+  host.onContactLogRemove(removed);
+  store.appendContactRemoval(removed);
+  store.abortContactsCompaction();
+  CHECK(!store.isCompactingContacts() && !memfs_files().count("/contacts3.tmp"), "abort left compaction running");
+  CHECK(sameContacts(reload(), host.contacts), "%d contacts: loaded wrong after abort", num);
+
+  // and next time, it runs to the end
+  store.startContactsCompaction();
+  while (!store.stepContactsCompaction(&host, CONTACTS_COMPACT_STEP)) {
+    if (!store.isCompactingContacts()) break;
+  }
+  CHECK(sameContacts(reload(), host.contacts), "%d contacts: loaded wrong after compaction", num);
+  CHECK(!store.needsContactsCompaction(host.contacts.size()), "still needs compaction");
+}
+
+static double elapsedMicros(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - since).count();
+}
+
+static void benchmark(int num) {
+  DataStore store(SPIFFS, rtc);
+  TestHost host;
+  setup(store, host, num);
+
+  // all at once, as in loop() before
+  size_t written = memfs_stats().bytes_written;
+  auto t = std::chrono::steady_clock::now();
+  store.saveContacts(&host);
+  double full_us = elapsedMicros(t);
+  size_t full_bytes = memfs_stats().bytes_written - written;
+
+  setup(store, host, num);
+  size_t max_step_bytes = 0;
+  int steps = 0;
+  double max_step_us = 0;
+  written = memfs_stats().bytes_written;
+  size_t opens = memfs_stats().num_opens;
+  store.startContactsCompaction();
+  for (bool finished = false; !finished && store.isCompactingContacts(); steps++) {
+    size_t w = memfs_stats().bytes_written;
+    t = std::chrono::steady_clock::now();
+    finished = store.stepContactsCompaction(&host, CONTACTS_COMPACT_STEP);
+    double us = elapsedMicros(t);
+    if (us > max_step_us) max_step_us = us;
+    if (memfs_stats().bytes_written - w > max_step_bytes) max_step_bytes = memfs_stats().bytes_written - w;
+  }
+  size_t stepped_bytes = memfs_stats().bytes_written - written;
+  CHECK(stepped_bytes == full_bytes, "%d contacts: stepped compaction wrote %d bytes, full %d", num,
+        (int) stepped_bytes, (int) full_bytes);
+  CHECK(max_step_bytes <= CONTACTS_COMPACT_STEP*152, "%d contacts: a step wrote %d bytes", num, (int) max_step_bytes);
+  printf("%4d contacts: full rewrite %6d bytes in one loop() (%.0f us); stepped: %d loop()s, at most %d bytes "
+         "(%.0f us) each, %d file opens\n", num, (int) full_bytes, full_us, steps, (int) max_step_bytes, max_step_us,
+         (int) (memfs_stats().num_opens - opens));
+}
+
+int main() {
+  srand(1);
+  for (int n : { 1, 7, 8, 9, 100 }) testPowerLoss(n);
+  for (int n : { 20, 350 }) testAbort(n);
+  for (int n : { 100, 350, 1000 }) benchmark(n);
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+// GeoIndex: k-nearest queries against brute force, over 10k synthetic nodes, with moves and removals.
+
+#include <helpers/GeoIndex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#define NUM_ITEMS    10000
+#define NUM_QUERIES  2000
+
+static GeoIndex<NUM_ITEMS> geo;
+static int32_t lats[NUM_ITEMS], lons[NUM_ITEMS];
+static uint8_t tags[NUM_ITEMS];
+static int num_items = NUM_ITEMS;
+static double index_secs = 0, scan_secs = 0;
+
+static int32_t randRange(int32_t centre, int32_t spread) { return centre + (rand() % (2*spread + 1)) - spread; }
+
+// returns number of mismatches
+static int query(int32_t lat, int32_t lon, uint8_t tag, uint32_t max_dist, int k) {
+  int results[16];
+  uint32_t dists[16];
+  auto t0 = std::chrono::steady_clock::now();
+  int n = geo.findNearest(lat, lon, tag, max_dist, results, dists, k);
+  auto t1 = std::chrono::steady_clock::now();
+
+  float lon_scale = cosf((float)lat * (float)(M_PI / 180000000.0));   // same sums as GeoIndex
+  if (lon_scale < 0.01f) lon_scale = 0.01f;
+  std::vector<std::pair<uint32_t, int>> expected;
+  for (int i = 0; i < num_items; i++) {
+    if ((lats[i] == 0 && lons[i] == 0) || (tag && tags[i] != tag)) continue;
+    float dy = (float)(lats[i] - lat) * GEO_METRES_PER_UDEG;
+    float dx = (float)(lons[i] - lon) * GEO_METRES_PER_UDEG * lon_scale;
+    uint32_t d = (uint32_t) sqrtf(dx*dx + dy*dy);
+    if (max_dist == 0 || d <= max_dist) expected.push_back({ d, i });
+  }
+  std::sort(expected.begin(), expected.end());
+  auto t2 = std::chrono::steady_clock::now();
+  index_secs += std::chrono::duration<double>(t1 - t0).count();
+  scan_secs += std::chrono::duration<double>(t2 - t1).count();
+
+  int expected_n = std::min((int) expected.size(), k);
+  if (n != expected_n) {
+    printf("FAIL: query (%d, %d) tag=%d max=%u k=%d: %d results, expected %d\n", lat, lon, tag, max_dist, k, n, expected_n);
+    return 1;
+  }
+  for (int i = 0; i < n; i++) {   // compare distances (items at equal distance may come in either order)
+    if (dists[i] != expected[i].first) {
+      printf("FAIL: query (%d, %d) result %d: %u m, expected %u m\n", lat, lon, i, dists[i], expected[i].first);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int runQueries(const char* label) {
+  int errors = 0;
+  for (int q = 0; q < NUM_QUERIES; q++) {
+    int32_t lat = randRange(50000000, 1200000), lon = randRange(8000000, 1700000);
+    if (q % 50 == 0) {   // far from nearly everything, so falls back to full scan
+      lat = -33000000;
+      lon = 151000000;
+    }
+    uint32_t max_dist = (rand() % 3) == 0 ? 0 : rand() % 60000;
+    errors += query(lat, lon, rand() % 4, max_dist, 1 + rand() % 10);
+  }
+  printf("%s: %d errors, avg query %.3f ms (brute force %.3f ms)\n", label, errors,
+    index_secs * 1000 / NUM_QUERIES, scan_secs * 1000 / NUM_QUERIES);
+  index_secs = scan_secs = 0;
+  return errors;
+}
+
+int main() {
+  srand(1);
+  for (int i = 0; i < NUM_ITEMS; i++) {   // a dense region, plus a few far away
+    if (rand() % 10 == 0) {
+      lats[i] = -33000000;
+      lons[i] = 151000000 + rand() % 1000;
+    } else {
+      lats[i] = randRange(50000000, 1000000);
+      lons[i] = randRange(8000000, 1500000);
+    }
+    if (rand() % 50 == 0) lats[i] = lons[i] = 0;   // no location
+    tags[i] = 1 + rand() % 3;
+    geo.put(i, lats[i], lons[i], tags[i]);
+  }
+  int errors = runQueries("initial");
+
+  for (int m = 0; m < 500; m++) {   // moves, some to another cell
+    int i = rand() % NUM_ITEMS;
+    if (lats[i] == 0 && lons[i] == 0) continue;
+    lats[i] += randRange(0, 100000);
+    geo.put(i, lats[i], lons[i], tags[i]);
+  }
+  for (int m = 0; m < 100; m++) {   // location cleared
+    int i = rand() % NUM_ITEMS;
+    lats[i] = lons[i] = 0;
+    geo.put(i, 0, 0, tags[i]);
+  }
+  errors += runQueries("after moves");
+
+  for (int r = 0; r < 200; r++) {   // removals, with the table shifted down
+    int i = rand() % num_items;
+    geo.removeShift(i, num_items);
+    num_items--;
+    memmove(&lats[i], &lats[i + 1], (num_items - i) * sizeof(lats[0]));
+    memmove(&lons[i], &lons[i + 1], (num_items - i) * sizeof(lons[0]));
+    memmove(&tags[i], &tags[i + 1], (num_items - i) * sizeof(tags[0]));
+  }
+  errors += runQueries("after removals");
+
+  return errors ? 1 : 0;
+}
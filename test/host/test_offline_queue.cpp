@@ -0,0 +1,181 @@
+// companion_radio's OfflineQueue: frames waiting for the app, in RAM rings which spill to ring files in flash.
+// Checks the order (and contents) of frames across a clean reboot, what a crash loses or gives again, the retention
+// policies when full, and a torn header write. Reports the spill header writes while the app is offline and reconnects.
+
+#include "OfflineQueue.h"
+#include <SPIFFS.h>
+#include "check.h"
+#include <deque>
+#include <stdlib.h>
+#include <vector>
+
+#define RAM_FRAMES   (OFFLINE_QUEUE_SIZE / 2)
+
+static int next_id = 1;
+
+// frame contents made from an id, so what comes back can be checked
+static int makeFrame(uint8_t frame[], int id) {
+  int len = 4 + rand() % (MAX_FRAME_SIZE - 3);
+  memcpy(frame, &id, 4);
+  for (int i = 4; i < len; i++) frame[i] = id + i;
+  return len;
+}
+
+static int frameId(const uint8_t frame[], int len) {
+  int id;
+  if (len < 4) return -1;
+  memcpy(&id, frame, 4);
+  for (int i = 4; i < len; i++) {
+    if (frame[i] != (uint8_t) (id + i)) return -1;
+  }
+  return id;
+}
+
+static int add(OfflineQueue& q, bool is_channel) {
+  uint8_t frame[MAX_FRAME_SIZE];
+  int id = next_id++;
+  return q.add(frame, makeFrame(frame, id), is_channel) ? id : 0;
+}
+
+static int get(OfflineQueue& q) {
+  uint8_t frame[MAX_FRAME_SIZE];
+  int len = q.get(frame);
+  return len > 0 ? frameId(frame, len) : 0;
+}
+
+static std::vector<int> getAll(OfflineQueue& q) {
+  std::vector<int> ids;
+  while (q.count() > 0) ids.push_back(get(q));
+  return ids;
+}
+
+// both queues in use, some taken, then a clean reboot (as MyMesh flushes first), then more added
+static void testReboot() {
+  memfs_files().clear();
+  OfflineQueue q;
+  q.begin(&SPIFFS);
+  std::deque<int> expected;
+  for (int i = 0; i < 80; i++) expected.push_back(add(q, rand() % 2));
+  for (int i = 0; i < 15; i++) {
+    CHECK(get(q) == expected.front(), "reboot: wrong frame before");
+    expected.pop_front();
+  }
+  q.flush();
+
+  OfflineQueue q2;
+  q2.begin(&SPIFFS);
+  CHECK(q2.count() == (int) expected.size(), "reboot: %d frames after, expected %d", q2.count(), (int) expected.size());
+  for (int i = 0; i < 10; i++) expected.push_back(add(q2, rand() % 2));   // newer than those kept in flash
+  std::vector<int> ids = getAll(q2);
+  CHECK(ids == std::vector<int>(expected.begin(), expected.end()), "reboot: wrong frames after");
+}
+
+// no flush(): frames in RAM are lost, and frames taken since the last header write are given again
+static void testCrash() {
+  for (int taken = 0; taken <= 37; taken++) {   // (37, so the flash part isn't a whole number of batches)
+    memfs_files().clear();
+    OfflineQueue q;
+    q.begin(&SPIFFS);
+    std::vector<int> ids;
+    for (int i = 0; i < 37; i++) ids.push_back(add(q, false));
+    for (int i = 0; i < taken; i++) CHECK(get(q) == ids[i], "crash: wrong frame before");
+
+    OfflineQueue q2;
+    q2.begin(&SPIFFS);
+    std::vector<int> after = getAll(q2);
+    int spilled = 37 - RAM_FRAMES;   // the rest lost, with RAM
+    if (taken >= spilled) {
+      CHECK(after.empty(), "crash after %d taken: %d frames given again", taken, (int) after.size());
+      continue;
+    }
+    int again = after.size() - (spilled - taken);
+    CHECK(again >= 0 && again < OFFLINE_POP_BATCH, "crash after %d taken: %d given again", taken, again);
+    if (again >= 0) {
+      CHECK(after == std::vector<int>(ids.begin() + taken - again, ids.begin() + spilled),
+            "crash after %d taken: wrong frames", taken);
+    }
+
+    // and sequence carries on
+    int id = add(q2, false);
+    CHECK(q2.count() == 1 && get(q2) == id, "crash after %d taken: new frame not queued", taken);
+  }
+}
+
+// channel msgs drop the oldest, direct msgs refuse the newest
+static void testFull() {
+  memfs_files().clear();
+  OfflineQueue q;
+  q.begin(&SPIFFS);
+  std::vector<int> chan, direct;
+  for (int i = 0; i < 200; i++) chan.push_back(add(q, true));
+  for (int i = 0; i < 200; i++) {
+    int id = add(q, false);
+    if (id) direct.push_back(id);
+  }
+  CHECK(direct.size() == OFFLINE_SPILL_DIRECT + RAM_FRAMES, "%d direct frames kept", (int) direct.size());
+  q.flush();   // (drops more channel msgs, to make room)
+
+  OfflineQueue q2;
+  q2.begin(&SPIFFS);
+  std::vector<int> expected(chan.end() - OFFLINE_SPILL_CHANNEL, chan.end());
+  expected.insert(expected.end(), direct.begin(), direct.begin() + OFFLINE_SPILL_DIRECT);
+  CHECK(getAll(q2) == expected, "full: wrong frames after reboot");
+}
+
+// one header copy torn: the other is used (so frames may be given again, but none lost)
+static void testTornHeader() {
+  memfs_files().clear();
+  OfflineQueue q;
+  q.begin(&SPIFFS);
+  std::vector<int> ids;
+  for (int i = 0; i < 40; i++) ids.push_back(add(q, false));
+  for (int i = 0; i < 2*OFFLINE_POP_BATCH; i++) get(q);   // both copies written
+  q.flush();
+
+  for (int copy = 0; copy < 2; copy++) {
+    auto saved = *memfs_files()["/offq_direct"];
+    (*memfs_files()["/offq_direct"])[copy * 12 + 5] ^= 0xFF;
+    OfflineQueue q2;
+    q2.begin(&SPIFFS);
+    std::vector<int> after = getAll(q2);
+    int again = (int) after.size() - (40 - 2*OFFLINE_POP_BATCH);
+    CHECK(again == 0 || again == OFFLINE_POP_BATCH, "torn header %d: %d given again", copy, again);
+    CHECK(again < 0 || after == std::vector<int>(ids.begin() + 2*OFFLINE_POP_BATCH - again, ids.end()),
+          "torn header %d: wrong frames", copy);
+    *memfs_files()["/offq_direct"] = saved;
+  }
+}
+
+// app offline while 'burst' direct msgs arrive, then it reconnects and takes them all, 'rounds' times
+static void benchmark(int burst, int rounds) {
+  memfs_files().clear();
+  OfflineQueue q;
+  q.begin(&SPIFFS);
+  size_t writes = memfs_stats().num_writes, bytes = memfs_stats().bytes_written;
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < burst; i++) add(q, false);
+    getAll(q);
+  }
+  int spilled = rounds * (burst > RAM_FRAMES ? burst - RAM_FRAMES : 0);
+  int hdr_writes = memfs_stats().num_writes - writes - spilled;
+  int max_hdr_writes = rounds * ((spilled / rounds + OFFLINE_POP_BATCH - 1) / OFFLINE_POP_BATCH);
+  CHECK(hdr_writes <= max_hdr_writes, "burst of %d: %d header writes, expected at most %d", burst, hdr_writes,
+        max_hdr_writes);
+  printf("bursts of %2d msgs: %4d spilled, %3d header writes (was %4d, on every spill and take), %6d bytes written\n",
+         burst, spilled, hdr_writes, 2*spilled, (int) (memfs_stats().bytes_written - bytes));
+}
+
+int main() {
+  srand(1);
+  testReboot();
+  testCrash();
+  testFull();
+  testTornHeader();
+  for (int burst : { 8, 20, 50, 72 }) benchmark(burst, 20);
+  printf("spill files %d bytes (%d + %d frames of %d bytes); on a crash, at most %d frames per queue lost (in RAM), "
+         "%d given again\n", (int) memfs_used(), OFFLINE_SPILL_DIRECT, OFFLINE_SPILL_CHANNEL, (int) sizeof(QueuedFrame),
+         RAM_FRAMES, OFFLINE_POP_BATCH - 1);
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
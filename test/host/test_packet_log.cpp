@@ -0,0 +1,70 @@
+// PacketLog: records only once started, the file header, rotation, and a text log left by older firmware.
+
+#include "PacketLog.h"
+#include "check.h"
+#include <string>
+
+class StringStream : public Stream {
+public:
+  std::string text;
+  size_t write(uint8_t c) override { text += (char) c; return 1; }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+};
+
+static bool validHeader(const char* path) {
+  if (!memfs_files().count(path)) return false;
+  auto& d = *memfs_files()[path];
+  return d.size() >= 8 && memcmp(d.data(), "MCPL", 4) == 0 && d[4] == PACKET_LOG_VERSION && d[5] == sizeof(PacketLogRecord);
+}
+
+static size_t numRecords(const char* path) {
+  return memfs_files().count(path) ? (memfs_files()[path]->size() - 8) / sizeof(PacketLogRecord) : 0;
+}
+
+static PacketLog pkt_log;   // as in MyMesh, lives for the whole program
+
+int main() {
+  fs::FS fs;
+  mesh::Packet pkt;
+  pkt.header = PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT;
+  pkt.payload_len = 10;
+  pkt.path_len = 0;
+  memset(pkt.payload, 0x55, pkt.payload_len);
+
+  // a text log from older firmware
+  const char* text_log = "12:00:00 - 1/1/2025 U: RX, len=20 (type=2, route=F, payload_len=10)\n";
+  memfs_files()[PACKET_LOG_FILE] = std::make_shared<std::vector<uint8_t>>(text_log, text_log + strlen(text_log));
+
+  pkt_log.begin(&fs);
+  pkt_log.add(PKT_LOG_RX, &pkt, 20, 5.0f, -90, 0.5f, 1000);   // not started, so no RAM ring
+  CHECK(pkt_log.getPendingCount() == 0, "record added before start()");
+
+  pkt_log.start();
+  for (int i = 0; i < 10; i++) pkt_log.add(PKT_LOG_RX, &pkt, 20, 5.0f, -90, 0.5f, 1000 + i);
+  pkt_log.flush();
+  CHECK(validHeader(PACKET_LOG_FILE), "no header on new log");
+  CHECK(numRecords(PACKET_LOG_FILE) == 10, "%d records in log", (int) numRecords(PACKET_LOG_FILE));
+  CHECK(memfs_files().count(PACKET_LOG_OLD_FILE) && memfs_files()[PACKET_LOG_OLD_FILE]->size() == strlen(text_log),
+        "text log wasn't rotated out");
+
+  StringStream out;
+  pkt_log.dump(out);
+  int lines = 0;
+  for (char c : out.text) if (c == '\n') lines++;
+  CHECK(lines == 11, "dump: %d lines, expected header + 10 records", lines);   // text log skipped
+
+  // fill to rotation
+  int total = 10;
+  while (total < (int) (PACKET_LOG_MAX_FILE_SIZE / sizeof(PacketLogRecord)) + 20) {
+    for (int i = 0; i < PACKET_LOG_RAM_RECORDS / 2; i++, total++) pkt_log.add(PKT_LOG_TX, &pkt, 20, 0, 0, 0, 2000 + total);
+    pkt_log.flush();
+  }
+  CHECK(validHeader(PACKET_LOG_FILE) && validHeader(PACKET_LOG_OLD_FILE), "headers after rotation");
+  CHECK(memfs_files()[PACKET_LOG_FILE]->size() <= PACKET_LOG_MAX_FILE_SIZE, "log over max size");
+  CHECK(numRecords(PACKET_LOG_FILE) + numRecords(PACKET_LOG_OLD_FILE) == (size_t) total, "records lost in rotation");
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+// PostStore: index against a reference list, rebuild on boot, torn tails, and the sync backlog limit.
+
+#include "PostStore.h"
+#include "check.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+struct RefPost {
+  uint32_t timestamp;
+  int author;
+  std::string text;
+};
+
+static uint8_t keys[4][PUB_KEY_SIZE];
+static std::vector<RefPost> ref;   // every post added, oldest first
+
+static PostStore* store = NULL;
+
+static void boot(fs::FS* fs) {
+  delete store;
+  store = new PostStore();
+  store->begin(fs);
+}
+
+static void addPost(uint32_t timestamp, int author, const char* text) {
+  CHECK(store->add(mesh::Identity(keys[author]), timestamp, text), "add() failed");
+  ref.push_back({ timestamp, author, text });
+}
+
+#define MAX_RECORD_LEN   (4 + PUB_KEY_SIZE + 2 + MAX_POST_TEXT_LEN)
+
+static size_t fileSize(const char* path) {
+  return memfs_files().count(path) ? memfs_files()[path]->size() : 0;
+}
+
+// store must hold exactly the newest getNumPosts() posts: at least a full segment's worth, within the byte budget
+static void checkContents(const char* label) {
+  int n = store->getNumPosts();
+  int base = ref.size() - n;
+  int bytes = 0;
+  for (int i = base; i < (int) ref.size(); i++) bytes += 4 + PUB_KEY_SIZE + 2 + ref[i].text.length();
+  bool segment_full = n >= MAX_STORED_POSTS/2 || (POST_LOG_MAX_BYTES > 0 && bytes + 8 + MAX_RECORD_LEN > POST_LOG_MAX_BYTES/2);
+  CHECK(segment_full || base == 0, "%s: only %d posts kept", label, n);
+  size_t log_size = fileSize("/post_log0") + fileSize("/post_log1");
+  CHECK(POST_LOG_MAX_BYTES == 0 || log_size <= POST_LOG_MAX_BYTES, "%s: post log is %d bytes", label, (int) log_size);
+  for (int i = 0; i < n; i++) {
+    PostInfo post;
+    bool ok = store->read(i, post) && post.post_timestamp == ref[base + i].timestamp && ref[base + i].text == post.text
+          && memcmp(post.author.pub_key, keys[ref[base + i].author], PUB_KEY_SIZE) == 0;
+    CHECK(ok, "%s: post %d differs", label, i);
+    if (!ok) return;
+  }
+
+  for (int q = 0; q < 500; q++) {   // findNext() and countAfter(), against brute force
+    uint32_t since = ref[base].timestamp - 5 + rand() % (ref.back().timestamp - ref[base].timestamp + 10);
+    uint32_t until = since + rand() % 50;
+    int author = rand() % 4;
+    int expected = -1, count = 0;
+    for (int i = base; i < (int) ref.size(); i++) {
+      if (ref[i].timestamp <= since || ref[i].author == author) continue;
+      if (expected < 0 && ref[i].timestamp <= until) expected = i - base;
+      count++;
+    }
+    CHECK(store->findNext(since, until, keys[author]) == expected, "%s: findNext(%u, %u)", label, since, until);
+    CHECK(store->countAfter(since, keys[author], 0xFFFF) == count, "%s: countAfter(%u)", label, since);
+  }
+}
+
+int main() {
+  for (int i = 0; i < 4; i++) memset(keys[i], 0x10*i + 1, PUB_KEY_SIZE);
+  fs::FS fs;
+
+  boot(&fs);
+  uint32_t timestamp = 1700000000;
+  char text[MAX_POST_TEXT_LEN+1];
+  for (int i = 0; i < MAX_STORED_POSTS*2 + MAX_STORED_POSTS/3; i++) {   // segments rotate a few times
+    timestamp += 1 + (i % 3);
+    snprintf(text, sizeof(text), "post %d %s", i, std::string(100 + i % 51, 'x').c_str());   // up to full length
+    addPost(timestamp, (i*7) % 4, text);
+  }
+  checkContents("live");
+  boot(&fs);
+  checkContents("rebooted");
+  int num_before = store->getNumPosts();
+
+  // torn tail: power lost mid-append to current segment
+  uint32_t gen[2];
+  memcpy(&gen[0], memfs_files()["/post_log0"]->data() + 4, 4);
+  memcpy(&gen[1], memfs_files()["/post_log1"]->data() + 4, 4);
+  const char* curr_file = gen[1] > gen[0] ? "/post_log1" : "/post_log0";
+  auto curr = memfs_files()[curr_file];
+  curr->resize(curr->size() - 10);
+  ref.pop_back();
+  boot(&fs);
+  checkContents("torn tail");
+  CHECK(store->getNumPosts() == num_before - 1, "torn tail: %d posts, expected %d", store->getNumPosts(), num_before - 1);
+
+  addPost(timestamp += 5, 1, "after torn tail");
+  CHECK(store->getNumPosts() == num_before, "add after torn tail: oldest segment was erased");
+  boot(&fs);
+  checkContents("add after torn tail, rebooted");
+
+  // trim interrupted after removing the segment, before renaming the copy into place
+  curr = memfs_files()[curr_file];   // trim replaced the file
+  curr->resize(curr->size() - 3);
+  ref.pop_back();
+  boot(&fs);   // trims
+  boot(&fs);
+  checkContents("torn tail, rebooted twice");
+  std::string tmp_file = std::string(curr_file) + ".tmp";
+  memfs_files()[tmp_file] = memfs_files()[curr_file];
+  memfs_files().erase(curr_file);
+  boot(&fs);
+  checkContents("interrupted trim");
+  CHECK(!fs.exists(tmp_file.c_str()), "interrupted trim: copy left behind");
+
+  // sync backlog limit
+  uint32_t newest = ref.back().timestamp;
+  int expected = store->countAfter(0, keys[0], 32);   // fewer, if store is small
+  uint32_t since = store->limitBacklog(0, keys[0], 32);
+  int count = store->countAfter(since, keys[0], 0xFFFF);
+  CHECK(count == expected, "limitBacklog(0): %d posts after, expected %d", count, expected);
+  since = store->limitBacklog(newest - 10, keys[0], 32);
+  CHECK(since == newest - 10, "limitBacklog(): moved a short backlog");
+
+  store->clear();
+  boot(&fs);
+  CHECK(store->getNumPosts() == 0, "clear(): %d posts after reboot", store->getNumPosts());
+
+  delete store;
+  printf("%s (%d posts, %d bytes max)\n", errors ? "FAILED" : "OK", MAX_STORED_POSTS, POST_LOG_MAX_BYTES);
+  return errors ? 1 : 0;
+}
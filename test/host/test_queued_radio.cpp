@@ -0,0 +1,123 @@
+// QueuedRadio under ThreadSanitizer: a fake inner radio in the radio task, and this thread as the app task,
+// polling it the way the Dispatcher does.
+
+#include <helpers/QueuedRadio.h>
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+#define TEST_SECS   4
+#define NUM_RX      3000
+
+class FakeRadio : public mesh::Radio {
+  int tick = 0, send_ticks = 0;
+  bool sending = false;
+  uint8_t seq = 0;
+public:
+  int n_recv = 0, n_started = 0, n_finished = 0;   // like the driver's packet counters, only read under lock()
+
+  int recvRaw(uint8_t* bytes, int sz) override {
+    if (sending || (++tick % 3) != 0 || n_recv >= NUM_RX) return 0;
+    bytes[0] = seq++;
+    bytes[1] = 0xAA;
+    n_recv++;
+    return 2;
+  }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return 5; }
+  float packetScore(float snr, int packet_len) override { return 1; }
+  bool startSendRaw(const uint8_t* bytes, int len) override {
+    n_started++;
+    sending = true;
+    send_ticks = 2;
+    return (n_started % 50) != 0;   // some fail to start
+  }
+  bool isSendComplete() override { return sending && --send_ticks <= 0; }
+  void onSendFinished() override {
+    if (sending) n_finished++;
+    sending = false;
+  }
+  bool isInRecvMode() const override { return !sending; }
+  bool isReceiving() override { return (tick % 7) == 0; }
+  float getLastSNR() const override { return tick; }
+};
+
+static unsigned long elapsedMillis(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count();
+}
+
+// with_tx: also sends, between receives. slow_usecs: how long the app task sometimes takes (eg. a flash write)
+static int runTest(bool with_tx, int slow_usecs) {
+  FakeRadio fake;
+  QueuedRadio radio(fake, 0);
+  radio.begin();
+
+  int n_got = 0, n_missing = 0, n_sent = 0, n_timeouts = 0, n_reads = 0;
+  uint8_t expected = 0;
+  bool sending = false;
+  auto start = std::chrono::steady_clock::now();
+  auto send_start = start;
+  while (elapsedMillis(start) < TEST_SECS*1000) {
+    uint8_t buf[MAX_TRANS_UNIT+1];
+    if (radio.recvRaw(buf, MAX_TRANS_UNIT) > 0) {
+      n_missing += (uint8_t)(buf[0] - expected);   // skipped sequence numbers
+      expected = buf[0] + 1;
+      n_got++;
+    }
+    if (sending) {
+      if (radio.isSendComplete()) {
+        radio.onSendFinished();
+        n_sent++;
+        sending = false;
+      } else if (elapsedMillis(send_start) > 20) {   // send timeout, abort it
+        radio.onSendFinished();
+        n_timeouts++;
+        sending = false;
+      }
+    } else if (with_tx && !radio.isReceiving()) {
+      uint8_t pkt[40] = { 1, 2, 3 };
+      if (radio.startSendRaw(pkt, sizeof(pkt))) {
+        sending = true;
+        send_start = std::chrono::steady_clock::now();
+      }
+    }
+    if ((n_got % 50) == 0) {   // read driver stats, like the repeater's status reply
+      radio.lock();
+      n_reads += fake.n_recv >= 0;
+      radio.unlock();
+    }
+    (void) radio.getNoiseFloor();
+    (void) radio.isInRecvMode();
+    std::this_thread::sleep_for(std::chrono::microseconds((n_got % 5) == 0 ? slow_usecs : 200));
+  }
+  radio.end();
+
+  printf("rx: got=%d missing=%d dropped=%u, tx: sent=%d timeouts=%d (started=%d finished=%d), stats reads=%d\n",
+    n_got, n_missing, radio.getNumRxDropped(), n_sent, n_timeouts, fake.n_started, fake.n_finished, n_reads);
+
+  int errors = 0;
+  if (n_got == 0 || (with_tx && n_sent == 0)) {
+    printf("FAIL: no packets received or sent\n");
+    errors++;
+  }
+  // every packet from the chip is either delivered, counted as dropped, or still queued
+  int n_accounted = n_got + radio.getNumRxDropped() + radio.getRxQueueLen();
+  if (n_missing > (int) radio.getNumRxDropped() || n_accounted != fake.n_recv) {
+    printf("FAIL: %d received by radio, but %d accounted for (%d missing)\n", fake.n_recv, n_accounted, n_missing);
+    errors++;
+  }
+  if (n_sent + n_timeouts > fake.n_started) {
+    printf("FAIL: more sends completed than were started\n");
+    errors++;
+  }
+  if (fake.n_finished > fake.n_started) {
+    printf("FAIL: onSendFinished() called more than once per send\n");
+    errors++;
+  }
+  return errors;
+}
+
+int main() {
+  int errors = runTest(true, 3000);
+  errors += runTest(false, 20000);   // app task too slow to keep up, so some received packets are dropped
+  return errors ? 1 : 0;
+}
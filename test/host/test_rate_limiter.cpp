@@ -0,0 +1,72 @@
+// SenderRateLimiter, with the repeater's settings: a replay of 1000 anon requests/min for 10 minutes (one abusive
+// key, plus random keys), while an admin in the ACL tries to log in once a minute.
+
+#include "RateLimiter.h"
+#include "check.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SENDER_SECS    30   // as simple_repeater's anon_limiter
+#define SENDER_BURST   3
+#define GLOBAL_SECS    15
+#define GLOBAL_BURST   4
+
+#define TEST_MINS      10
+#define REQ_INTERVAL   60   // millis, ie. 1000/min
+
+int main() {
+  SenderRateLimiter limiter(SENDER_SECS, SENDER_BURST, GLOBAL_SECS, GLOBAL_BURST);
+  uint8_t abuser[32] = { 0xAA, 1, 2, 3 };
+  uint8_t admin[32] = { 0x42, 9, 9, 9 };
+  int n_unknown_allowed = 0, n_abuser_allowed = 0, n_admin_allowed = 0, n_admin_tries = 0;
+
+  srand(1);
+  unsigned long start = 1000;
+  unsigned long end = start + TEST_MINS*60000UL;
+  for (unsigned long now = start; now < end; now += REQ_INTERVAL) {
+    uint8_t key[32];
+    bool is_abuser = rand() % 2;
+    if (is_abuser) {
+      memcpy(key, abuser, sizeof(key));
+    } else {
+      for (int i = 0; i < 32; i++) key[i] = rand();
+    }
+    if (limiter.allow(key, now, false)) {
+      n_unknown_allowed++;
+      if (is_abuser) n_abuser_allowed++;
+    }
+    if ((now - start) % 60000 < REQ_INTERVAL) {
+      n_admin_tries++;
+      if (limiter.allow(admin, now, true)) n_admin_allowed++;
+    }
+  }
+
+  int max_unknown = GLOBAL_BURST + TEST_MINS*60 / GLOBAL_SECS;
+  int max_abuser = SENDER_BURST + TEST_MINS*60 / SENDER_SECS;
+  printf("unknown allowed: %d (max %d), abusive key: %d (max %d), admin: %d/%d\n", n_unknown_allowed, max_unknown,
+    n_abuser_allowed, max_abuser, n_admin_allowed, n_admin_tries);
+  CHECK(n_unknown_allowed <= max_unknown, "global bucket let through too many");
+  CHECK(n_abuser_allowed <= max_abuser, "abusive key let through too many");
+  CHECK(n_admin_allowed == n_admin_tries, "admin was locked out");
+  CHECK(limiter.getNumAllowed() == (uint32_t)(n_unknown_allowed + n_admin_allowed), "getNumAllowed() is wrong");
+
+  // a known sender flooding is still held to its own bucket
+  SenderRateLimiter known(SENDER_SECS, SENDER_BURST, GLOBAL_SECS, GLOBAL_BURST);
+  int n_known_allowed = 0;
+  for (unsigned long now = start; now <= start + 60000; now += 100) {
+    if (known.allow(admin, now, true)) n_known_allowed++;
+  }
+  CHECK(n_known_allowed == SENDER_BURST + 60 / SENDER_SECS, "known sender: %d allowed in 1 min", n_known_allowed);
+
+  // a burst of new senders, then each one's repeat is still limited (while they fit in the table)
+  SenderRateLimiter many(SENDER_SECS, SENDER_BURST, 1, 255);
+  for (int s = 0; s < 8; s++) {
+    uint8_t key[32] = { (uint8_t)(s * 4), (uint8_t) s };
+    int n = 0;
+    for (int i = 0; i < 10; i++) n += many.allow(key, start + i, false);
+    CHECK(n == SENDER_BURST, "sender %d: %d allowed in a burst", s, n);
+  }
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}
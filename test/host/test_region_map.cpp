@@ -0,0 +1,154 @@
+// RegionMap file: migration from the old formats, save/load round trip, and fuzzing of corrupt files.
+
+#include <helpers/RegionMap.h>
+#include "check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define FUZZ_ITERATIONS   20000
+
+static void putFile(const char* path, const std::vector<uint8_t>& data) {
+  memfs_files()[path] = std::make_shared<std::vector<uint8_t>>(data);
+}
+
+static void append(std::vector<uint8_t>& v, const void* data, size_t len) {
+  v.insert(v.end(), (const uint8_t *) data, (const uint8_t *) data + len);
+}
+
+static void testLegacyMigration(fs::FS& fs, TransportKeyStore& keys) {
+  // /regions2: 5 reserved, home_id, wildcard flags, next_id, then entries of id, parent, name[31], flags, pad[128]
+  std::vector<uint8_t> file(5, 0);
+  uint16_t home_id = 2, next_id = 3;
+  uint8_t wildcard_flags = 0;
+  append(file, &home_id, 2);
+  append(file, &wildcard_flags, 1);
+  append(file, &next_id, 2);
+  for (uint16_t id = 1; id <= 2; id++) {
+    uint16_t parent = 0;
+    char name[31] = { 0 };
+    snprintf(name, sizeof(name), "#legacy%d", id);
+    uint8_t flags = id == 1 ? 0 : REGION_DENY_FLOOD;
+    uint8_t pad[128] = { 0 };
+    append(file, &id, 2);
+    append(file, &parent, 2);
+    append(file, name, sizeof(name));
+    append(file, &flags, 1);
+    append(file, pad, sizeof(pad));
+  }
+  putFile("/regions2", file);
+
+  RegionMap map(keys);
+  CHECK(map.load(&fs), "legacy: load failed");
+  CHECK(map.getCount() == 2, "legacy: %d regions", map.getCount());
+  CHECK(map.findByName("#legacy1") && map.findByName("#legacy1")->flags == 0, "legacy: #legacy1 missing or wrong");
+  CHECK(map.getHomeRegion() && strcmp(map.getHomeRegion()->name, "#legacy2") == 0, "legacy: wrong home region");
+  CHECK(!fs.exists("/regions2") && fs.exists("/regions3"), "legacy: not migrated to /regions3");
+
+  RegionMap reloaded(keys);
+  CHECK(reloaded.load(&fs) && reloaded.getCount() == 2, "legacy: migrated file doesn't load");
+  memfs_files().clear();
+}
+
+static void testVersion1(fs::FS& fs, TransportKeyStore& keys) {
+  // header (as RegionMap.cpp), then 36 byte entries (no policy), and no wildcard policy
+  uint8_t hdr[20] = { 0 };
+  uint32_t magic = 0x4752434D;
+  uint16_t num_regions = 3, home_id = 0, next_id = 4;
+  memcpy(hdr, &magic, 4);
+  hdr[4] = 1;    // version
+  hdr[5] = 36;   // entry size
+  memcpy(&hdr[6], &num_regions, 2);
+  memcpy(&hdr[8], &home_id, 2);
+  memcpy(&hdr[10], &next_id, 2);
+  std::vector<uint8_t> entries;
+  for (uint16_t id = 1; id <= num_regions; id++) {
+    uint8_t e[36] = { 0 };
+    uint16_t parent = id == 3 ? 1 : 0;
+    memcpy(e, &id, 2);
+    memcpy(&e[2], &parent, 2);
+    e[4] = 0;   // flags
+    snprintf((char *) &e[5], 31, "#v1-%d", id);
+    append(entries, e, sizeof(e));
+  }
+  uint32_t crc = mesh::Utils::crc32(entries.data(), entries.size(), mesh::Utils::crc32(hdr, 16));
+  memcpy(&hdr[16], &crc, 4);
+  std::vector<uint8_t> file(hdr, hdr + sizeof(hdr));
+  append(file, entries.data(), entries.size());
+  putFile("/regions3", file);
+
+  RegionMap map(keys);
+  CHECK(map.load(&fs), "v1: load failed");
+  CHECK(map.getCount() == 3, "v1: %d regions", map.getCount());
+  auto r = map.findByName("#v1-3");
+  CHECK(r && r->id == 3 && r->parent == 1 && r->policy.max_pkts == 0, "v1: #v1-3 missing or wrong");
+  memfs_files().clear();
+}
+
+static void testRoundTripAndFuzz(fs::FS& fs, TransportKeyStore& keys) {
+  RegionMap map(keys);
+  for (int i = 0; i < 20; i++) {
+    char name[20];
+    snprintf(name, sizeof(name), "#r%d", i);
+    auto r = map.putRegion(name, i % 3);
+    CHECK(r, "putRegion(%s) failed", name);
+    if (r == NULL) return;
+    r->flags = i & 1;
+    r->policy.max_pkts = i * 10;
+    r->policy.max_airtime = i;
+    r->policy.priority = i % 3;
+  }
+  map.setHomeRegion(map.findByName("#r7"));
+  map.getWildcard().policy.max_pkts = 500;
+  CHECK(map.save(&fs), "save failed");
+
+  RegionMap loaded(keys);
+  CHECK(loaded.load(&fs), "round trip: load failed");
+  CHECK(loaded.getCount() == map.getCount(), "round trip: %d regions, expected %d", loaded.getCount(), map.getCount());
+  for (int i = 0; i < map.getCount() && i < loaded.getCount(); i++) {
+    CHECK(memcmp(map.getByIdx(i), loaded.getByIdx(i), sizeof(RegionEntry)) == 0, "round trip: region %d differs", i);
+  }
+  CHECK(loaded.getHomeRegion() && strcmp(loaded.getHomeRegion()->name, "#r7") == 0, "round trip: wrong home region");
+  CHECK(loaded.getRoot()->policy.max_pkts == 500, "round trip: wildcard policy lost");
+  auto added = loaded.putRegion("#new", 0);
+  CHECK(added && map.findById(added->id) == NULL, "round trip: next_id reused an id");
+
+  // every corrupted or truncated file must be rejected (and never crash, under ASan)
+  std::vector<uint8_t> orig = *memfs_files()["/regions3"];
+  int accepted = 0;
+  srand(1);
+  for (int i = 0; i < FUZZ_ITERATIONS; i++) {
+    std::vector<uint8_t> data = orig;
+    switch (rand() % 3) {
+      case 0: data[rand() % data.size()] ^= 1 << (rand() % 8); break;   // single bit flip
+      case 1: data.resize(rand() % data.size()); break;                 // truncated
+      default:
+        for (auto& b : data) {
+          if (rand() % 50 == 0) b = rand();   // scattered garbage
+        }
+    }
+    if (data == orig) continue;
+    putFile("/regions3", data);
+
+    RegionMap fuzzed(keys);
+    if (fuzzed.load(&fs)) {
+      accepted++;
+    } else {
+      CHECK(fuzzed.getCount() == 0, "fuzz: rejected file left %d regions", fuzzed.getCount());
+    }
+  }
+  CHECK(accepted == 0, "fuzz: %d corrupt files accepted", accepted);
+  memfs_files().clear();
+}
+
+int main() {
+  fs::FS fs;
+  TransportKeyStore keys;
+
+  testLegacyMigration(fs, keys);
+  testVersion1(fs, keys);
+  testRoundTripAndFuzz(fs, keys);
+
+  printf("%s (%d fuzz iterations)\n", errors ? "FAILED" : "OK", FUZZ_ITERATIONS);
+  return errors ? 1 : 0;
+}
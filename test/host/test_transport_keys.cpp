@@ -0,0 +1,183 @@
+// Transport codes: SHA-256/HMAC against known vectors, TransportKeyHMAC (precomputed key blocks) against
+// TransportKey::calcTransportCode(), and the cost per flood packet of matching it against 32 and 128 region keys.
+// Also, RegionMap::findMatch() through the store's cache of key states, with 16, 32 and 128 regions.
+
+#include <helpers/RegionMap.h>
+#include "check.h"
+#include <chrono>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_PACKETS   2000
+
+static void fromHex(uint8_t* dest, const char* hex) {
+  for (int i = 0; hex[i*2]; i++) sscanf(&hex[i*2], "%2hhx", &dest[i]);
+}
+
+static void checkDigest(const char* label, const uint8_t* digest, const char* expected_hex) {
+  uint8_t expected[32];
+  fromHex(expected, expected_hex);
+  CHECK(memcmp(digest, expected, 32) == 0, "%s: wrong digest", label);
+}
+
+static void testVectors() {
+  uint8_t digest[32];
+  SHA256 sha;
+  sha.update("abc", 3);
+  sha.finalize(digest, 32);
+  checkDigest("SHA256(abc)", digest, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+  // RFC 4231, test cases 1 and 2
+  uint8_t key[20];
+  memset(key, 0x0B, sizeof(key));
+  sha.resetHMAC(key, sizeof(key));
+  sha.update("Hi There", 8);
+  sha.finalizeHMAC(key, sizeof(key), digest, 32);
+  checkDigest("RFC 4231 #1", digest, "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+
+  sha.resetHMAC("Jefe", 4);
+  sha.update("what do ya want for nothing?", 28);
+  sha.finalizeHMAC("Jefe", 4, digest, 32);
+  checkDigest("RFC 4231 #2", digest, "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+
+  // hashtag region key, and a transport code (first 2 bytes of HMAC-SHA256 of type + payload, little-endian)
+  TransportKeyStore store;
+  TransportKey k;
+  store.getAutoKeyFor(1, "test", k);
+  uint8_t expected_key[16];
+  fromHex(expected_key, "9cd8fcf22a47333b591d96a2b848b73f");
+  CHECK(memcmp(k.key, expected_key, 16) == 0, "auto key for #test");
+
+  mesh::Packet pkt;
+  pkt.header = PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT;
+  pkt.payload_len = 20;
+  for (int i = 0; i < 16; i++) k.key[i] = i;
+  for (int i = 0; i < pkt.payload_len; i++) pkt.payload[i] = 100 + i;
+  CHECK(k.calcTransportCode(&pkt) == 0xE6A8, "transport code %04X, expected E6A8", k.calcTransportCode(&pkt));
+  TransportKeyHMAC state;
+  state.init(k);
+  CHECK(state.calcTransportCode(&pkt) == 0xE6A8, "precomputed transport code %04X, expected E6A8", state.calcTransportCode(&pkt));
+}
+
+static void randomPacket(mesh::Packet& pkt) {
+  pkt.header = (rand() % 16) << PH_TYPE_SHIFT;
+  pkt.payload_len = rand() % (MAX_PACKET_PAYLOAD + 1);
+  for (int i = 0; i < pkt.payload_len; i++) pkt.payload[i] = rand();
+}
+
+static void testEquivalence() {
+  int diffs = 0;
+  for (int i = 0; i < 20000; i++) {
+    TransportKey k;
+    for (int j = 0; j < 16; j++) k.key[j] = rand();
+    TransportKeyHMAC state;
+    state.init(k);
+    mesh::Packet pkt;
+    randomPacket(pkt);
+    if (state.calcTransportCode(&pkt) != k.calcTransportCode(&pkt)) diffs++;
+  }
+  CHECK(diffs == 0, "TransportKeyHMAC differs from TransportKey in %d of 20000", diffs);
+}
+
+// a flood packet which matches none of the keys, so all are tried (the worst case, for each packet)
+static void benchmark(int num_keys) {
+  std::vector<TransportKey> keys(num_keys);
+  std::vector<TransportKeyHMAC> states(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    for (int j = 0; j < 16; j++) keys[i].key[j] = rand();
+    states[i].init(keys[i]);
+  }
+  std::vector<mesh::Packet> pkts(BENCH_PACKETS);
+  for (auto& p : pkts) {
+    randomPacket(p);
+    p.payload_len = 20 + rand() % 60;   // typical
+  }
+
+  uint32_t sum = 0;
+  uint32_t blocks = sha256_num_blocks();
+  auto t = std::chrono::steady_clock::now();
+  for (auto& p : pkts) {
+    for (auto& k : keys) sum += k.calcTransportCode(&p);
+  }
+  double plain_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count() / BENCH_PACKETS;
+  double plain_blocks = (double) (sha256_num_blocks() - blocks) / BENCH_PACKETS;
+
+  blocks = sha256_num_blocks();
+  t = std::chrono::steady_clock::now();
+  for (auto& p : pkts) {
+    for (auto& s : states) sum -= s.calcTransportCode(&p);
+  }
+  double hmac_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count() / BENCH_PACKETS;
+  double hmac_blocks = (double) (sha256_num_blocks() - blocks) / BENCH_PACKETS;
+
+  CHECK(sum == 0, "%d keys: codes differ", num_keys);
+  CHECK(plain_blocks - hmac_blocks > 2*num_keys - 0.01, "%d keys: %.1f blocks, vs %.1f (should save 2 per key)", num_keys,
+        hmac_blocks, plain_blocks);
+  printf("%3d keys, per packet: key each time %5.1f SHA256 blocks (%6.1f us), precomputed %5.1f blocks (%6.1f us)\n",
+         num_keys, plain_blocks, plain_us, hmac_blocks, hmac_us);
+}
+
+// each flood packet is tried against the regions in the same order, so having more regions than the cache holds
+// must not make every lookup a miss
+static void benchmarkRegions(int num_regions, bool matching) {
+  TransportKeyStore store, other;   // 'other' just to make the codes, without touching the cache under test
+  RegionMap map(store);
+  char name[16];
+  for (int i = 0; i < num_regions; i++) {
+    snprintf(name, sizeof(name), "#region%d", i);
+    map.putRegion(name, 0)->flags = 0;   // allow floods
+  }
+  mesh::Packet pkt;
+  pkt.header = ROUTE_TYPE_TRANSPORT_FLOOD | (PAYLOAD_TYPE_GRP_TXT << PH_TYPE_SHIFT);
+  pkt.payload_len = 40;
+
+  uint32_t misses = 0, blocks = 0;
+  double us = 0;
+  for (int i = -10; i < BENCH_PACKETS; i++) {   // (first few not counted, while the cache fills)
+    for (int j = 0; j < pkt.payload_len; j++) pkt.payload[j] = rand();
+    RegionEntry* expected = NULL;
+    if (matching) {   // from a random region, so the scan stops there
+      expected = (RegionEntry *) map.getByIdx(rand() % num_regions);
+      TransportKey k;
+      other.getAutoKeyFor(expected->id, expected->name, k);
+      pkt.transport_codes[0] = k.calcTransportCode(&pkt);
+    } else {
+      pkt.transport_codes[0] = 0;   // reserved, never matches
+    }
+
+    uint32_t m = store.getNumCacheMisses(), b = sha256_num_blocks();
+    auto t = std::chrono::steady_clock::now();
+    RegionEntry* match = map.findMatch(&pkt, REGION_DENY_FLOOD);
+    if (i >= 0) {
+      us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count();
+      misses += store.getNumCacheMisses() - m;
+      blocks += sha256_num_blocks() - b;
+    }
+    // (an earlier region's code could collide, 1 in 65536)
+    CHECK(match == expected || (matching && match && match->id < expected->id), "%d regions: wrong match", num_regions);
+  }
+  double misses_per = (double) misses / BENCH_PACKETS;
+  if (!matching) {   // a full scan: at most one miss per region beyond what the cache holds
+    int max_misses = num_regions < MAX_TKS_ENTRIES ? 0 : num_regions - MAX_TKS_ENTRIES + 1;
+    CHECK(misses_per <= max_misses, "%d regions: %.1f cache misses per packet, expected at most %d", num_regions,
+          misses_per, max_misses);
+  }
+  printf("%3d regions (cache %d), %s: %5.1f cache misses, %6.1f SHA256 blocks (%6.1f us) per packet\n", num_regions,
+         MAX_TKS_ENTRIES, matching ? "matching one" : "no match    ", misses_per, (double) blocks / BENCH_PACKETS,
+         us / BENCH_PACKETS);
+}
+
+int main() {
+  srand(1);
+  testVectors();
+  testEquivalence();
+  benchmark(32);
+  benchmark(128);
+  for (int n : { 16, 32, 128 }) {
+    benchmarkRegions(n, false);
+    benchmarkRegions(n, true);
+  }
+
+  printf("%s\n", errors ? "FAILED" : "OK");
+  return errors ? 1 : 0;
+}